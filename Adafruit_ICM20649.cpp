@@ -6,10 +6,28 @@
 #include "Adafruit_ICM20649.h"
 #include "Adafruit_ICM20X.h"
 
+// Multipliers to SI units for each `icm20649_accel_range_t` and
+// `icm20649_gyro_range_t`
+const icm20x_scale_table_t icm20649_scales = {
+    {SENSORS_GRAVITY_EARTH / 8192.0, SENSORS_GRAVITY_EARTH / 4096.0,
+     SENSORS_GRAVITY_EARTH / 2048.0, SENSORS_GRAVITY_EARTH / 1024.0},
+    {SENSORS_DPS_TO_RADS / 65.5, SENSORS_DPS_TO_RADS / 32.8,
+     SENSORS_DPS_TO_RADS / 16.4, SENSORS_DPS_TO_RADS / 8.2},
+    0,
+    {ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 8192.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 4096.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 2048.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 1024.0)},
+    {ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 65.5),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 32.8),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 16.4),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 8.2)},
+    0};
+
 /*!
  *    @brief  Instantiates a new ICM20649 class!
  */
-Adafruit_ICM20649::Adafruit_ICM20649(void) {}
+Adafruit_ICM20649::Adafruit_ICM20649(void) { scale_table = &icm20649_scales; }
 
 /*!
  *    @brief  Sets up the hardware and initializes I2C
@@ -36,45 +54,11 @@ bool Adafruit_ICM20649::begin_I2C(uint8_t i2c_address, TwoWire *wire,
     Serial.println("I2C begin Failed");
     return false;
   }
+  invalidateBankCache();
 
   return _init(sensor_id);
 }
 
-void Adafruit_ICM20649::scaleValues(void) {
-
-  icm20649_gyro_range_t gyro_range = (icm20649_gyro_range_t)current_gyro_range;
-  icm20649_accel_range_t accel_range =
-      (icm20649_accel_range_t)current_accel_range;
-  float accel_scale = 1.0;
-  float gyro_scale = 1.0;
-
-  if (gyro_range == ICM20649_GYRO_RANGE_500_DPS)
-    gyro_scale = 65.5;
-  if (gyro_range == ICM20649_GYRO_RANGE_1000_DPS)
-    gyro_scale = 32.8;
-  if (gyro_range == ICM20649_GYRO_RANGE_2000_DPS)
-    gyro_scale = 16.4;
-  if (gyro_range == ICM20649_GYRO_RANGE_4000_DPS)
-    gyro_scale = 8.2;
-
-  if (accel_range == ICM20649_ACCEL_RANGE_4_G)
-    accel_scale = 8192.0;
-  if (accel_range == ICM20649_ACCEL_RANGE_8_G)
-    accel_scale = 4096.0;
-  if (accel_range == ICM20649_ACCEL_RANGE_16_G)
-    accel_scale = 2048.0;
-  if (accel_range == ICM20649_ACCEL_RANGE_30_G)
-    accel_scale = 1024.0;
-
-  gyroX = rawGyroX / gyro_scale;
-  gyroY = rawGyroY / gyro_scale;
-  gyroZ = rawGyroZ / gyro_scale;
-
-  accX = rawAccX / accel_scale;
-  accY = rawAccY / accel_scale;
-  accZ = rawAccZ / accel_scale;
-}
-
 /**************************************************************************/
 /*!
     @brief Get the accelerometer's measurement range.
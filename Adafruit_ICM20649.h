@@ -38,6 +38,9 @@ typedef enum {
   ICM20649_GYRO_RANGE_4000_DPS,
 } icm20649_gyro_range_t;
 
+/** Scale factors for every ICM20649 range, used to replay recorded samples */
+extern const icm20x_scale_table_t icm20649_scales;
+
 /*!
  *    @brief  Class that stores state and functions for interacting with
  *            the ST ICM20649 6-DoF Accelerometer and Gyro
@@ -54,9 +57,6 @@ public:
 
   icm20649_gyro_range_t getGyroRange(void);
   void setGyroRange(icm20649_gyro_range_t new_gyro_range);
-
-private:
-  void scaleValues(void);
 };
 
 #endif
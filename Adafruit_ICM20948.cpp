@@ -6,11 +6,29 @@
 #include "Adafruit_ICM20948.h"
 #include "Adafruit_ICM20X.h"
 
+// Multipliers to SI units for each `icm20948_accel_range_t` and
+// `icm20948_gyro_range_t`
+const icm20x_scale_table_t icm20948_scales = {
+    {SENSORS_GRAVITY_EARTH / 16384.0, SENSORS_GRAVITY_EARTH / 8192.0,
+     SENSORS_GRAVITY_EARTH / 4096.0, SENSORS_GRAVITY_EARTH / 2048.0},
+    {SENSORS_DPS_TO_RADS / 131.0, SENSORS_DPS_TO_RADS / 65.5,
+     SENSORS_DPS_TO_RADS / 32.8, SENSORS_DPS_TO_RADS / 16.4},
+    ICM20948_UT_PER_LSB,
+    {ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 16384.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 8192.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 4096.0),
+     ICM20X_SCALE_Q(SENSORS_GRAVITY_EARTH / 2048.0)},
+    {ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 131.0),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 65.5),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 32.8),
+     ICM20X_SCALE_Q(SENSORS_DPS_TO_RADS / 16.4)},
+    ICM20X_SCALE_Q(ICM20948_UT_PER_LSB)};
+
 /*!
  *    @brief  Instantiates a new ICM20948 class!
  */
 
-Adafruit_ICM20948::Adafruit_ICM20948(void) {}
+Adafruit_ICM20948::Adafruit_ICM20948(void) { scale_table = &icm20948_scales; }
 /*!
  *    @brief  Sets up the hardware and initializes I2C
  *    @param  i2c_address
@@ -31,18 +49,14 @@ bool Adafruit_ICM20948::begin_I2C(uint8_t i2c_address, TwoWire *wire,
   }
 
   i2c_dev = new Adafruit_I2CDevice(i2c_address, wire);
+  dmp_running = false;
 
   if (!i2c_dev->begin()) {
     Serial.println("I2C begin Failed");
     return false;
   }
-  bool init_success = _init(sensor_id);
-  if (!setupMag()) {
-    Serial.println("failed to setup mag");
-    return false;
-  }
-
-  return init_success;
+  invalidateBankCache();
+  return _init(sensor_id);
 }
 
 // A million thanks to the SparkFun folks for their library that I pillaged to
@@ -67,8 +81,20 @@ uint8_t Adafruit_ICM20948::getMagId(void) {
   return readExternalRegister(0x8C, 0x01);
 }
 
+/**
+ * @brief Start the magnetometer and have slave 0 proxy its readings into the
+ * data registers. Called by `_init`, so it runs the same way over I2C and SPI
+ *
+ * @return true: success false: the magnetometer didn't respond
+ */
 bool Adafruit_ICM20948::setupMag(void) {
-  uint8_t buffer[2];
+  // after a warm start the mag may already be running and proxied by slave 0
+  if (readConfigBits(0, ICM20X_B0_USER_CTRL, 1, 5) &&
+      readConfig(3, ICM20X_B3_I2C_SLV0_ADDR) == 0x8C &&
+      readConfig(3, ICM20X_B3_I2C_SLV0_REG) == 0x10 &&
+      readConfig(3, ICM20X_B3_I2C_SLV0_CTRL) == 0x89) {
+    return true;
+  }
 
   setI2CBypass(false);
 
@@ -77,6 +103,7 @@ bool Adafruit_ICM20948::setupMag(void) {
   enableI2CMaster(true);
 
   if (auxI2CBusSetupFailed()) {
+    Serial.println("failed to setup mag");
     return false;
   }
 
@@ -86,25 +113,13 @@ bool Adafruit_ICM20948::setupMag(void) {
     return false;
   }
 
-  // TODO: extract method
-  // Set up Slave0 to proxy Mag readings
-  _setBank(3);
-  // set up slave0 to proxy reads to mag
-  buffer[0] = ICM20X_B3_I2C_SLV0_ADDR;
-  buffer[1] = 0x8C;
-  if (!i2c_dev->write(buffer, 2)) {
-    return false;
-  }
-
-  buffer[0] = ICM20X_B3_I2C_SLV0_REG;
-  buffer[1] = 0x10;
-  if (!i2c_dev->write(buffer, 2)) {
-    return false;
-  }
-
-  buffer[0] = ICM20X_B3_I2C_SLV0_CTRL;
-  buffer[1] = 0x89; // enable, read 9 bytes
-  if (!i2c_dev->write(buffer, 2)) {
+  // Set up Slave0 to proxy Mag readings; the three registers are adjacent so
+  // this is a single burst
+  beginConfig();
+  writeConfig(3, ICM20X_B3_I2C_SLV0_ADDR, 0x8C);
+  writeConfig(3, ICM20X_B3_I2C_SLV0_REG, 0x10);
+  writeConfig(3, ICM20X_B3_I2C_SLV0_CTRL, 0x89); // enable, read 9 bytes
+  if (!commitConfig()) {
     return false;
   }
 
@@ -127,46 +142,6 @@ bool Adafruit_ICM20948::writeMagRegister(uint8_t mag_reg_addr, uint8_t value) {
   return writeExternalRegister(0x0C, mag_reg_addr, value);
 }
 
-void Adafruit_ICM20948::scaleValues(void) {
-
-  icm20948_gyro_range_t gyro_range = (icm20948_gyro_range_t)current_gyro_range;
-  icm20948_accel_range_t accel_range =
-      (icm20948_accel_range_t)current_accel_range;
-
-  float accel_scale = 1.0;
-  float gyro_scale = 1.0;
-
-  if (gyro_range == ICM20948_GYRO_RANGE_250_DPS)
-    gyro_scale = 131.0;
-  if (gyro_range == ICM20948_GYRO_RANGE_500_DPS)
-    gyro_scale = 65.5;
-  if (gyro_range == ICM20948_GYRO_RANGE_1000_DPS)
-    gyro_scale = 32.8;
-  if (gyro_range == ICM20948_GYRO_RANGE_2000_DPS)
-    gyro_scale = 16.4;
-
-  if (accel_range == ICM20948_ACCEL_RANGE_2_G)
-    accel_scale = 16384.0;
-  if (accel_range == ICM20948_ACCEL_RANGE_4_G)
-    accel_scale = 8192.0;
-  if (accel_range == ICM20948_ACCEL_RANGE_8_G)
-    accel_scale = 4096.0;
-  if (accel_range == ICM20948_ACCEL_RANGE_16_G)
-    accel_scale = 2048.0;
-
-  gyroX = rawGyroX / gyro_scale;
-  gyroY = rawGyroY / gyro_scale;
-  gyroZ = rawGyroZ / gyro_scale;
-
-  accX = rawAccX / accel_scale;
-  accY = rawAccY / accel_scale;
-  accZ = rawAccZ / accel_scale;
-
-  magX = rawMagX * ICM20948_UT_PER_LSB;
-  magY = rawMagY * ICM20948_UT_PER_LSB;
-  magZ = rawMagZ * ICM20948_UT_PER_LSB;
-}
-
 /**************************************************************************/
 /*!
     @brief Get the accelerometer's measurement range.
@@ -220,24 +195,690 @@ ak09916_data_rate_t Adafruit_ICM20948::getMagDataRate(void) {
   return (ak09916_data_rate_t)(raw_mag_rate);
 }
 /**
- * @brief Set the magnetometer measurement rate
+ * @brief Set the magnetometer measurement rate, blocking until the
+ * auxillary I2C writes finish
  *
  * @param rate The rate to set.
  *
  * @return true: success false: failure
  */
 bool Adafruit_ICM20948::setMagDataRate(ak09916_data_rate_t rate) {
+  finishAuxTransactions();
+  if (!queueMagDataRate(rate)) {
+    return false;
+  }
+  return finishAuxTransactions();
+}
+
+/**
+ * @brief Queue a change of the magnetometer measurement rate without
+ * blocking. Call `serviceAuxTransactions` until it no longer returns
+ * `ICM20X_AUX_BUSY` to complete it
+ *
+ * @param rate The rate to set.
+ *
+ * @return true: queued false: not enough room in the aux queue
+ */
+bool Adafruit_ICM20948::queueMagDataRate(ak09916_data_rate_t rate) {
   /*
    * Following the datasheet, the sensor will be set to
-   * AK09916_MAG_DATARATE_SHUTDOWN followed by a 100ms delay, followed by
+   * AK09916_MAG_DATARATE_SHUTDOWN followed by a 100us wait, followed by
    * setting the new data rate.
    *
    * See page 9 of https://www.y-ic.es/datasheet/78/SMDSW.020-2OZ.pdf
    */
+  if (auxQueueSpace() < 3) {
+    return false;
+  }
 
   // don't need to read/mask because there's nothing else in the register and
   // it's right justified
-  bool success = writeMagRegister(AK09916_CNTL2, AK09916_MAG_DATARATE_SHUTDOWN);
-  delay(1);
-  return writeMagRegister(AK09916_CNTL2, rate) && success;
+  queueExternalWrite(0x0C, AK09916_CNTL2, AK09916_MAG_DATARATE_SHUTDOWN);
+  queueAuxDelay(AK09916_MODE_CHANGE_US);
+  return queueExternalWrite(0x0C, AK09916_CNTL2, rate);
+}
+
+/**
+ * @brief Power the magnetometer down, remembering its rate, or back up at
+ * that rate. Slave 0 stops proxying it while it is down so the data burst
+ * can leave it out
+ *
+ * @param enable true: power up false: power down
+ * @return true: success false: failure, or the DMP is using the magnetometer
+ */
+bool Adafruit_ICM20948::powerMag(bool enable) {
+  if (dmp_outputs & ICM20948_DMP_QUAT9) {
+    return false;
+  }
+
+  if (enable) {
+    if (!setMagDataRate(mag_rate)) {
+      return false;
+    }
+    return writeConfigBits(3, ICM20X_B3_I2C_SLV0_CTRL, 1, 7, true);
+  }
+
+  ak09916_data_rate_t rate = getMagDataRate();
+  if (rate != AK09916_MAG_DATARATE_SHUTDOWN) {
+    mag_rate = rate;
+  }
+  if (!writeConfigBits(3, ICM20X_B3_I2C_SLV0_CTRL, 1, 7, false)) {
+    return false;
+  }
+  return setMagDataRate(AK09916_MAG_DATARATE_SHUTDOWN);
+}
+
+// Payload size of each DMP FIFO packet item, in the order the items follow
+// the header words. The two byte footer is not included
+typedef struct {
+  uint16_t bit;
+  uint8_t size;
+} dmp_item_t;
+
+static constexpr dmp_item_t dmp_header_items[] = {
+    {ICM20948_DMP_HEADER_ACCEL, 6},
+    {ICM20948_DMP_HEADER_GYRO, 12},
+    {ICM20948_DMP_HEADER_COMPASS, 6},
+    {ICM20948_DMP_HEADER_ALS, 8},
+    {ICM20948_DMP_HEADER_QUAT6, 12},
+    {ICM20948_DMP_HEADER_QUAT9, 14},
+    {ICM20948_DMP_HEADER_PQUAT6, 6},
+    {ICM20948_DMP_HEADER_GEOMAG, 14},
+    {ICM20948_DMP_HEADER_PRESSURE, 6},
+    {ICM20948_DMP_HEADER_GYRO_CALIBR, 12},
+    {ICM20948_DMP_HEADER_COMPASS_CALIBR, 12},
+    {ICM20948_DMP_HEADER_STEP_DETECTOR, 4},
+};
+#define DMP_HEADER_ITEMS                                                       \
+  (sizeof(dmp_header_items) / sizeof(dmp_header_items[0]))
+
+static constexpr dmp_item_t dmp_header2_items[] = {
+    {ICM20948_DMP_HEADER2_ACCEL_ACCURACY, 2},
+    {ICM20948_DMP_HEADER2_GYRO_ACCURACY, 2},
+    {ICM20948_DMP_HEADER2_COMPASS_ACCURACY, 2},
+    {ICM20948_DMP_HEADER2_FSYNC, 2},
+    {ICM20948_DMP_HEADER2_PICKUP, 2},
+    {ICM20948_DMP_HEADER2_BATCH_MODE, 0},
+    {ICM20948_DMP_HEADER2_ACTIVITY, 6},
+    {ICM20948_DMP_HEADER2_SECONDARY_ON_OFF, 2},
+};
+#define DMP_HEADER2_ITEMS                                                      \
+  (sizeof(dmp_header2_items) / sizeof(dmp_header2_items[0]))
+
+// Header bits with no known payload size; seeing one means the packet
+// alignment has been lost
+static constexpr uint16_t DMP_HEADER_UNKNOWN = 0x0007;
+static constexpr uint16_t DMP_HEADER2_UNKNOWN = 0x823F;
+
+// DMP values are big endian
+static int32_t dmpInt32(const uint8_t *buffer) {
+  return (int32_t)((uint32_t)buffer[0] << 24 | (uint32_t)buffer[1] << 16 |
+                   (uint32_t)buffer[2] << 8 | buffer[3]);
+}
+
+// DMP memory the firmware expects the host to fill in before it starts, for
+// the ranges and `ICM20948_DMP_RATE_DIVISOR` set by `beginDMP`. Values are
+// from InvenSense's reference driver
+typedef struct {
+  uint16_t address;
+  uint32_t value; // written big endian
+  uint8_t len;
+} dmp_setting_t;
+
+static constexpr dmp_setting_t dmp_settings[] = {
+    // every output off until `enableDMPOutput`
+    {ICM20948_DMP_DATA_OUT_CTL1, 0, 2},
+    {ICM20948_DMP_DATA_OUT_CTL2, 0, 2},
+    {ICM20948_DMP_DATA_INTR_CTL, 0, 2},
+    {ICM20948_DMP_MOTION_EVENT_CTL, 0, 2},
+    {ICM20948_DMP_DATA_RDY_STATUS, 0, 2},
+    {ICM20948_DMP_FIFO_WATERMARK, 800, 2},
+    // +-4g
+    {ICM20948_DMP_ACC_SCALE, 0x04000000, 4},
+    {ICM20948_DMP_ACC_SCALE2, 0x00040000, 4},
+    // AK09916 axes to chip axes, Y and Z flipped, scaled to 0.15uT per LSB
+    {ICM20948_DMP_CPASS_MTX_00, 0x09999999, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 4, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 8, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 12, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 16, 0xF6666667, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 20, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 24, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 28, 0, 4},
+    {ICM20948_DMP_CPASS_MTX_00 + 32, 0xF6666667, 4},
+    // body frame is the chip frame
+    {ICM20948_DMP_B2S_MTX_00, 0x40000000, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 4, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 8, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 12, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 16, 0x40000000, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 20, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 24, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 28, 0, 4},
+    {ICM20948_DMP_B2S_MTX_00 + 32, 0x40000000, 4},
+    // +-2000dps
+    {ICM20948_DMP_GYRO_FULLSCALE, 0x10000000, 4},
+    // accel calibration tuned for a 56Hz sample rate
+    {ICM20948_DMP_ACCEL_ONLY_GAIN, 0x03A49249, 4},
+    {ICM20948_DMP_ACCEL_ALPHA_VAR, 0x34920000, 4},
+    {ICM20948_DMP_ACCEL_A_VAR, 0x0B6DB6DB, 4},
+    {ICM20948_DMP_ACCEL_CAL_RATE, 0, 2},
+    // the magnetometer is read at 1100Hz / 2^4 = 69Hz
+    {ICM20948_DMP_CPASS_TIME_BUFFER, 69, 2},
+};
+#define DMP_SETTINGS (sizeof(dmp_settings) / sizeof(dmp_settings[0]))
+
+/**
+ * @brief Load the Digital Motion Processor firmware and start it, with no
+ * outputs enabled. Use `enableDMPOutput` to choose what it writes to the
+ * FIFO and `readDMPQuaternions` to read it.
+ *
+ * The DMP needs the accelerometer at +-4g and the gyro at +-2000dps, both
+ * with a rate divisor of `ICM20948_DMP_RATE_DIVISOR` (about 56Hz). This sets
+ * them; changing them afterwards will upset the DMP's results. The DMP
+ * owns the FIFO until `begin` resets the chip: `enableFIFO` fails and
+ * `readFIFO` returns no samples.
+ *
+ * @param firmware The InvenSense DMP3 firmware image for the ICM20948 (usually
+ * `dmp3_image` from InvenSense's `icm20948_img.dmp3a.h`). It is not shipped
+ * with this library. On AVR it must be stored in PROGMEM; on other chips it
+ * can be in flash or RAM
+ * @param size The image size in bytes
+ * @return true: the DMP is running false: the image didn't load or verify
+ */
+bool Adafruit_ICM20948::beginDMP(const uint8_t *firmware, uint16_t size) {
+  if (!firmware || !size) {
+    return false;
+  }
+
+  dmp_running = false;
+  dmp_outputs = 0;
+  dmp_header_len = 0;
+  enableFIFO(false);
+
+  beginConfig();
+  // stop any running DMP while its memory is rewritten
+  writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 7, false);
+  // awake, and out of low power mode which blocks DMP memory access
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 6, false);
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 5, false);
+  writeAccelRange(ICM20948_ACCEL_RANGE_4_G);
+  writeGyroRange(ICM20948_GYRO_RANGE_2000_DPS);
+  // the rate divisors only apply with the DLPF enabled
+  writeConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 1, 0, true);
+  writeConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 1, 0, true);
+  setAccelRateDivisor(ICM20948_DMP_RATE_DIVISOR);
+  setGyroRateDivisor(ICM20948_DMP_RATE_DIVISOR);
+  if (!commitConfig()) {
+    return false;
+  }
+
+  _setBank(0);
+  if (!writeRegister(ICM20948_B0_HW_FIX_DISABLE, 0x48) ||
+      !writeRegister(ICM20948_B0_FIFO_PRIORITY_SEL, 0xE4) ||
+      !writeRegister(ICM20948_B0_FIFO_CFG, 0x01)) { // single FIFO
+    return false;
+  }
+
+  if (!loadDMPFirmware(firmware, size)) {
+    return false;
+  }
+
+  _setBank(2);
+  uint8_t start[2] = {ICM20948_DMP_START_ADDRESS >> 8,
+                      ICM20948_DMP_START_ADDRESS & 0xFF};
+  if (!writeRegisters(ICM20948_B2_PRGM_START_ADDRH, start, 2)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < DMP_SETTINGS; i++) {
+    const dmp_setting_t *setting = &dmp_settings[i];
+    if (!writeDMPValue(setting->address, setting->value, setting->len)) {
+      return false;
+    }
+  }
+
+  // gyro scale factor for the rate divisor and this chip's clock error, as
+  // computed by InvenSense's reference driver
+  uint64_t gyro_sf = 264446880937391ULL * 16 *
+                     (1 + ICM20948_DMP_RATE_DIVISOR) /
+                     (ICM20X_TIMEBASE_PLL_UNITY + timebase_pll) / 100000;
+  if (gyro_sf > 0x7FFFFFFF) {
+    gyro_sf = 0x7FFFFFFF;
+  }
+  if (!writeDMPValue(ICM20948_DMP_GYRO_SF, gyro_sf, 4)) {
+    return false;
+  }
+
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 7, true); // DMP
+  writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 6, true); // FIFO
+  if (!commitConfig()) {
+    return false;
+  }
+  resetDMP();
+
+  dmp_running = true;
+  return true;
+}
+
+/**
+ * @brief Check if the DMP is running and writing its packets to the FIFO
+ *
+ * @return true after a successful `beginDMP`, until a reset in `begin`
+ * clears DMP_EN
+ */
+bool Adafruit_ICM20948::dmpOwnsFIFO(void) {
+  return dmp_running && readConfigBits(0, ICM20X_B0_USER_CTRL, 1, 7);
+}
+
+/**
+ * @brief Turn one of the DMP's quaternion outputs on or off
+ *
+ * `ICM20948_DMP_QUAT9` needs the magnetometer, so while it is enabled the
+ * magnetometer is handed over to the DMP and the raw magnetometer readings
+ * from `getEvent` and `readRaw` are not valid. Turning it off restores them.
+ *
+ * @param output The output to change
+ * @param enable true: write it to the FIFO false: stop writing it
+ * @param interval Sensor samples between outputs, minus one. 0 gives one
+ * output per sample, about 55Hz
+ * @return true: success false: the DMP isn't running or a write failed
+ */
+bool Adafruit_ICM20948::enableDMPOutput(icm20948_dmp_output_t output,
+                                        bool enable, uint16_t interval) {
+  if (!dmp_running) {
+    return false;
+  }
+
+  uint16_t outputs = enable ? (dmp_outputs | output) : (dmp_outputs & ~output);
+  if ((outputs ^ dmp_outputs) & ICM20948_DMP_QUAT9) {
+    if (!routeMagToDMP(outputs & ICM20948_DMP_QUAT9)) {
+      return false;
+    }
+  }
+
+  // which sensors the DMP waits for, and which calibration and fusion it runs
+  uint16_t ready = 0, events = 0;
+  if (outputs) {
+    ready = 0x0003;  // accel and gyro
+    events = 0x0300; // accel and gyro calibration
+  }
+  if (outputs & ICM20948_DMP_QUAT9) {
+    ready |= 0x0008;  // magnetometer
+    events |= 0x00C0; // magnetometer calibration and 9 axis fusion
+  }
+
+  bool success = true;
+  if (output == ICM20948_DMP_QUAT6) {
+    success &= writeDMPValue(ICM20948_DMP_ODR_QUAT6, interval, 2);
+    success &= writeDMPValue(ICM20948_DMP_ODR_CNTR_QUAT6, 0, 2);
+    dmp_quat6_interval = interval;
+  } else {
+    success &= writeDMPValue(ICM20948_DMP_ODR_QUAT9, interval, 2);
+    success &= writeDMPValue(ICM20948_DMP_ODR_CNTR_QUAT9, 0, 2);
+    dmp_quat9_interval = interval;
+  }
+  success &= writeDMPValue(ICM20948_DMP_DATA_OUT_CTL1, outputs, 2);
+  success &= writeDMPValue(ICM20948_DMP_DATA_RDY_STATUS, ready, 2);
+  success &= writeDMPValue(ICM20948_DMP_MOTION_EVENT_CTL, events, 2);
+  dmp_outputs = outputs;
+
+  // start the FIFO on a packet boundary with the new layout
+  resetDMP();
+  return success;
+}
+
+/**
+ * @brief Drain quaternions written to the FIFO by the DMP. Each packet is
+ * fetched with one bus transaction together with the header of the packet
+ * after it. Timestamps are worked back from the time of the read using each
+ * output's interval
+ *
+ * @param quats Where to store the quaternions, oldest first
+ * @param max_quats The most quaternions to store
+ * @return The number of quaternions stored
+ */
+uint16_t Adafruit_ICM20948::readDMPQuaternions(icm20948_quaternion_t *quats,
+                                               uint16_t max_quats) {
+  if (!dmp_running || !quats) {
+    return 0;
+  }
+
+  _setBank(0);
+  if (readRegister(ICM20X_B0_INT_STATUS_2) & 0x1F) {
+    // the oldest data was overwritten so packet alignment is lost
+    fifo_overflows++;
+    resetDMP();
+    return 0;
+  }
+
+  uint16_t available = getFIFOCount();
+  uint32_t newest_us = sampleTime(micros());
+
+  uint8_t packet[ICM20948_DMP_MAX_PACKET + 2];
+  uint8_t held = dmp_header_len;
+  memcpy(packet, dmp_header, held);
+  uint16_t count = 0;
+
+  while (true) {
+    int16_t size = dmpPacketSize(packet, held);
+    if (size < 0) {
+      // not a header we know, so packet alignment is lost
+      resetDMP();
+      held = 0;
+      break;
+    }
+
+    if (held >= 2) {
+      // stop before fetching a payload there's no room for, so at most the
+      // header words are carried over to the next call
+      uint16_t header = packet[0] << 8 | packet[1];
+      uint8_t packet_quats = ((header & ICM20948_DMP_HEADER_QUAT6) ? 1 : 0) +
+                             ((header & ICM20948_DMP_HEADER_QUAT9) ? 1 : 0);
+      if (count + packet_quats > max_quats) {
+        break;
+      }
+    }
+
+    if (held < size) {
+      uint16_t needed = size - held;
+      if (needed > available) {
+        break;
+      }
+      // once the whole size is known, fetch the next header with the payload
+      uint16_t extra = 0;
+      if (size > 4 && available - needed >= 2) {
+        extra = 2;
+      }
+      if (!readRegisters(ICM20X_B0_FIFO_R_W, packet + held, needed + extra,
+                         ICM20X_BUS_OP_DATA)) {
+        resetDMP();
+        held = 0;
+        break;
+      }
+      held += needed + extra;
+      available -= needed + extra;
+      continue;
+    }
+
+    count += decodeDMPPacket(packet, quats + count);
+    held -= size;
+    memmove(packet, packet + size, held);
+  }
+
+  dmp_header_len = held;
+  memcpy(dmp_header, packet, held);
+
+  // each output is evenly spaced by its own interval, newest last
+  uint64_t period_ns = getSamplePeriodNanos();
+  uint32_t quat6_age = 0, quat9_age = 0;
+  for (uint16_t i = count; i-- > 0;) {
+    uint64_t age_ns;
+    if (quats[i].output == ICM20948_DMP_QUAT6) {
+      age_ns = quat6_age++ * period_ns * (1 + dmp_quat6_interval);
+    } else {
+      age_ns = quat9_age++ * period_ns * (1 + dmp_quat9_interval);
+    }
+    quats[i].timestamp_us = newest_us - (uint32_t)(age_ns / 1000);
+  }
+
+  return count;
+}
+
+/**
+ * @brief Write the DMP firmware image to DMP memory and read it back to
+ * check it
+ *
+ * @param firmware The image. It is read with `pgm_read_byte`, so on AVR it
+ * must be in PROGMEM; other chips read flash and RAM alike
+ * @param size The image size in bytes
+ * @return true: success false: a write failed or the image didn't verify
+ */
+bool Adafruit_ICM20948::loadDMPFirmware(const uint8_t *firmware,
+                                        uint16_t size) {
+  uint8_t chunk[ICM20948_DMP_MAX_WRITE];
+  uint8_t check[ICM20948_DMP_MAX_WRITE];
+  uint16_t address = ICM20948_DMP_LOAD_START;
+
+  for (uint16_t offset = 0; offset < size;) {
+    uint16_t len = ICM20948_DMP_MAX_WRITE;
+    if (size - offset < len) {
+      len = size - offset;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+      chunk[i] = pgm_read_byte(firmware + offset + i);
+    }
+
+    if (!writeDMPMemory(address, chunk, len) ||
+        !readDMPMemory(address, check, len) || memcmp(chunk, check, len)) {
+      return false;
+    }
+    address += len;
+    offset += len;
+  }
+  return true;
+}
+
+/**
+ * @brief Write to DMP memory, in bursts that don't cross a memory bank
+ *
+ * @param address The first DMP memory address to write
+ * @param data The bytes to write
+ * @param len The number of bytes to write
+ * @return true: success false: a bus transfer failed
+ */
+bool Adafruit_ICM20948::writeDMPMemory(uint16_t address, const uint8_t *data,
+                                       uint16_t len) {
+  _setBank(0);
+  while (len) {
+    uint16_t burst = ICM20948_DMP_BANK_SIZE - (address & 0xFF);
+    if (burst > ICM20948_DMP_MAX_WRITE) {
+      burst = ICM20948_DMP_MAX_WRITE;
+    }
+    if (burst > len) {
+      burst = len;
+    }
+
+    if (!writeRegister(ICM20948_B0_MEM_BANK_SEL, address >> 8) ||
+        !writeRegister(ICM20948_B0_MEM_START_ADDR, address & 0xFF) ||
+        !writeRegisters(ICM20948_B0_MEM_R_W, data, burst)) {
+      return false;
+    }
+    address += burst;
+    data += burst;
+    len -= burst;
+  }
+  return true;
+}
+
+/**
+ * @brief Read from DMP memory, in bursts that don't cross a memory bank
+ *
+ * @param address The first DMP memory address to read
+ * @param data Where to store the bytes
+ * @param len The number of bytes to read
+ * @return true: success false: a bus transfer failed
+ */
+bool Adafruit_ICM20948::readDMPMemory(uint16_t address, uint8_t *data,
+                                      uint16_t len) {
+  _setBank(0);
+  while (len) {
+    uint16_t burst = ICM20948_DMP_BANK_SIZE - (address & 0xFF);
+    if (burst > ICM20948_DMP_MAX_WRITE) {
+      burst = ICM20948_DMP_MAX_WRITE;
+    }
+    if (burst > len) {
+      burst = len;
+    }
+
+    if (!writeRegister(ICM20948_B0_MEM_BANK_SEL, address >> 8) ||
+        !writeRegister(ICM20948_B0_MEM_START_ADDR, address & 0xFF) ||
+        !readRegisters(ICM20948_B0_MEM_R_W, data, burst)) {
+      return false;
+    }
+    address += burst;
+    data += burst;
+    len -= burst;
+  }
+  return true;
+}
+
+/**
+ * @brief Write a big endian value to DMP memory
+ *
+ * @param address The DMP memory address
+ * @param value The value to write
+ * @param len The value's size in bytes, up to 4
+ * @return true: success false: a bus transfer failed
+ */
+bool Adafruit_ICM20948::writeDMPValue(uint16_t address, uint32_t value,
+                                      uint8_t len) {
+  uint8_t buffer[4];
+  for (uint8_t i = 0; i < len; i++) {
+    buffer[i] = value >> (8 * (len - 1 - i));
+  }
+  return writeDMPMemory(address, buffer, len);
+}
+
+/**
+ * @brief Restart the DMP and empty the FIFO so the next packet starts on a
+ * boundary
+ */
+void Adafruit_ICM20948::resetDMP(void) {
+  // DMP_RST clears itself, so it is written around the shadow
+  uint8_t user_ctrl = readConfig(0, ICM20X_B0_USER_CTRL);
+  _setBank(0);
+  writeRegister(ICM20X_B0_USER_CTRL, user_ctrl | 0x08);
+
+  writeRegister(ICM20X_B0_FIFO_RST, 0x1F);
+  writeRegister(ICM20X_B0_FIFO_RST, 0x1E);
+  readRegister(ICM20X_B0_INT_STATUS_2); // clear on read
+  dmp_header_len = 0;
+}
+
+/**
+ * @brief Switch the magnetometer between feeding the DMP and the raw data
+ * registers. The DMP wants slave 0 to read ten bytes from RSV2 with the data
+ * words byte swapped, and slave 1 to trigger a single measurement every I2C
+ * master cycle
+ *
+ * @param enable true: feed the DMP false: go back to raw readings
+ * @return true: success false: a write failed
+ */
+bool Adafruit_ICM20948::routeMagToDMP(bool enable) {
+  if (!setMagDataRate(enable ? AK09916_MAG_DATARATE_SHUTDOWN
+                             : AK09916_MAG_DATARATE_100_HZ)) {
+    return false;
+  }
+
+  // slave 1 isn't in the shadow register file
+  uint8_t slv1[4] = {0x0C, AK09916_CNTL2, 0x81, AK09916_MAG_DATARATE_SINGLE};
+  if (!enable) {
+    slv1[2] = 0;
+  }
+  _setBank(3);
+  if (!writeRegisters(ICM20X_B3_I2C_SLV1_ADDR, slv1, 4)) {
+    return false;
+  }
+
+  beginConfig();
+  writeConfig(3, ICM20X_B3_I2C_MST_ODR_CONFIG, enable ? 0x04 : 0x00);
+  writeConfig(3, ICM20X_B3_I2C_SLV0_ADDR, 0x8C);
+  if (enable) {
+    writeConfig(3, ICM20X_B3_I2C_SLV0_REG, AK09916_RSV2);
+    // enable, swap bytes, group odd pairs, read 10 bytes
+    writeConfig(3, ICM20X_B3_I2C_SLV0_CTRL, 0xDA);
+  } else {
+    writeConfig(3, ICM20X_B3_I2C_SLV0_REG, AK09916_ST1);
+    writeConfig(3, ICM20X_B3_I2C_SLV0_CTRL, 0x89); // enable, read 9 bytes
+  }
+  return commitConfig();
+}
+
+/**
+ * @brief Work out how long a DMP FIFO packet is from its header words
+ *
+ * @param packet The start of the packet
+ * @param len How many bytes of the packet are available
+ * @return The packet size including header words and footer, or the number
+ * of header bytes needed to tell if fewer are available, or -1 if the header
+ * has bits that aren't understood
+ */
+int16_t Adafruit_ICM20948::dmpPacketSize(const uint8_t *packet, uint8_t len) {
+  if (len < 2) {
+    return 2;
+  }
+  uint16_t header = packet[0] << 8 | packet[1];
+  if (header & DMP_HEADER_UNKNOWN) {
+    return -1;
+  }
+
+  int16_t size = 2 + 2; // header and footer
+  if (header & ICM20948_DMP_HEADER_HEADER2) {
+    if (len < 4) {
+      return 4;
+    }
+    uint16_t header2 = packet[2] << 8 | packet[3];
+    if (header2 & DMP_HEADER2_UNKNOWN) {
+      return -1;
+    }
+    size += 2;
+    for (uint8_t i = 0; i < DMP_HEADER2_ITEMS; i++) {
+      if (header2 & dmp_header2_items[i].bit) {
+        size += dmp_header2_items[i].size;
+      }
+    }
+  }
+
+  for (uint8_t i = 0; i < DMP_HEADER_ITEMS; i++) {
+    if (header & dmp_header_items[i].bit) {
+      size += dmp_header_items[i].size;
+    }
+  }
+  return size;
+}
+
+/**
+ * @brief Pull the quaternions out of a complete DMP FIFO packet. Other items
+ * in the packet are skipped
+ *
+ * @param packet The packet, starting with its header
+ * @param quats Where to store the quaternions
+ * @return The number of quaternions stored, 0 to 2
+ */
+uint8_t Adafruit_ICM20948::decodeDMPPacket(const uint8_t *packet,
+                                           icm20948_quaternion_t *quats) {
+  uint16_t header = packet[0] << 8 | packet[1];
+  const uint8_t *item = packet + 2;
+  if (header & ICM20948_DMP_HEADER_HEADER2) {
+    item += 2;
+  }
+
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < DMP_HEADER_ITEMS; i++) {
+    uint16_t bit = dmp_header_items[i].bit;
+    if (!(header & bit)) {
+      continue;
+    }
+
+    if (bit == ICM20948_DMP_HEADER_QUAT6 || bit == ICM20948_DMP_HEADER_QUAT9) {
+      icm20948_quaternion_t *quat = &quats[count++];
+      quat->x = dmpInt32(item);
+      quat->y = dmpInt32(item + 4);
+      quat->z = dmpInt32(item + 8);
+      quat->accuracy = 0;
+      if (bit == ICM20948_DMP_HEADER_QUAT9) {
+        quat->accuracy = item[12] << 8 | item[13];
+      }
+      quat->output = bit;
+
+      // unit quaternion, so w follows from the others; Q60 in, Q30 out
+      int64_t w_sq = (1LL << 60) - (int64_t)quat->x * quat->x -
+                     (int64_t)quat->y * quat->y - (int64_t)quat->z * quat->z;
+      quat->w = (w_sq > 0) ? (int32_t)sqrt((double)w_sq) : 0;
+    }
+    item += dmp_header_items[i].size;
+  }
+  return count;
 }
@@ -24,8 +24,11 @@
 #define ICM20948_MAG_ID 0x09          ///< The chip ID for the magnetometer
 
 #define ICM20948_UT_PER_LSB 0.15 ///< mag data LSB value (fixed)
+#define AK09916_MODE_CHANGE_US                                                 \
+  100 ///< Time the magnetometer needs in power down between mode changes
 
 #define AK09916_WIA2 0x01  ///< Magnetometer
+#define AK09916_RSV2 0x03  ///< Magnetometer
 #define AK09916_ST1 0x10   ///< Magnetometer
 #define AK09916_HXL 0x11   ///< Magnetometer
 #define AK09916_HXH 0x12   ///< Magnetometer
@@ -37,6 +40,100 @@
 #define AK09916_CNTL2 0x31 ///< Magnetometer
 #define AK09916_CNTL3 0x32 ///< Magnetometer
 
+// DMP registers
+#define ICM20948_B0_FIFO_PRIORITY_SEL 0x26 ///< FIFO write priority for the DMP
+#define ICM20948_B0_HW_FIX_DISABLE 0x75    ///< Hardware fixes, set for the DMP
+#define ICM20948_B0_FIFO_CFG 0x76          ///< Single or multiple FIFO mode
+#define ICM20948_B0_MEM_START_ADDR 0x7C    ///< DMP memory address in the bank
+#define ICM20948_B0_MEM_R_W 0x7D           ///< DMP memory data port
+#define ICM20948_B0_MEM_BANK_SEL 0x7E      ///< DMP memory bank
+#define ICM20948_B2_PRGM_START_ADDRH 0x50  ///< DMP program start address MSB
+
+// DMP memory map, as used by InvenSense's DMP3 firmware
+#define ICM20948_DMP_LOAD_START 0x90      ///< Where the firmware is loaded
+#define ICM20948_DMP_START_ADDRESS 0x1000 ///< DMP program entry point
+#define ICM20948_DMP_BANK_SIZE 256        ///< Bytes per DMP memory bank
+#define ICM20948_DMP_MAX_WRITE 16         ///< Largest DMP memory burst
+
+#define ICM20948_DMP_DATA_OUT_CTL1 (4 * 16)            ///< FIFO outputs
+#define ICM20948_DMP_DATA_OUT_CTL2 (4 * 16 + 2)        ///< FIFO accuracies
+#define ICM20948_DMP_DATA_INTR_CTL (4 * 16 + 12)       ///< Interrupt outputs
+#define ICM20948_DMP_MOTION_EVENT_CTL (4 * 16 + 14)    ///< Calibration, fusion
+#define ICM20948_DMP_DATA_RDY_STATUS (8 * 16 + 10)     ///< DMP input sensors
+#define ICM20948_DMP_ODR_CNTR_QUAT9 (8 * 16 + 8)       ///< Quat9 output counter
+#define ICM20948_DMP_ODR_CNTR_QUAT6 (8 * 16 + 12)      ///< Quat6 output counter
+#define ICM20948_DMP_ODR_QUAT9 (10 * 16 + 8)           ///< Quat9 output divisor
+#define ICM20948_DMP_ODR_QUAT6 (10 * 16 + 12)          ///< Quat6 output divisor
+#define ICM20948_DMP_ACCEL_ONLY_GAIN (16 * 16 + 12)    ///< Accel fusion gain
+#define ICM20948_DMP_GYRO_SF (19 * 16)                 ///< Gyro scale factor
+#define ICM20948_DMP_CPASS_MTX_00 (23 * 16)            ///< Mag axes matrix
+#define ICM20948_DMP_ACC_SCALE (30 * 16)               ///< Accel full scale
+#define ICM20948_DMP_FIFO_WATERMARK (31 * 16 + 14)     ///< DMP FIFO watermark
+#define ICM20948_DMP_GYRO_FULLSCALE (72 * 16 + 12)     ///< Gyro full scale
+#define ICM20948_DMP_ACC_SCALE2 (79 * 16 + 4)          ///< Accel full scale
+#define ICM20948_DMP_ACCEL_ALPHA_VAR (91 * 16)         ///< Accel calibration
+#define ICM20948_DMP_ACCEL_A_VAR (92 * 16)             ///< Accel calibration
+#define ICM20948_DMP_ACCEL_CAL_RATE (94 * 16 + 4)      ///< Accel calibration
+#define ICM20948_DMP_CPASS_TIME_BUFFER (112 * 16 + 14) ///< Mag rate in Hz
+#define ICM20948_DMP_B2S_MTX_00 (208 * 16)             ///< Mounting matrix
+
+#define ICM20948_DMP_RATE_DIVISOR                                              \
+  19 ///< Accel and gyro rate divisor the DMP's scale factors assume
+#define ICM20948_DMP_MAX_PACKET                                                \
+  136 ///< Largest DMP FIFO packet, with every output and footer
+#define ICM20948_DMP_QUAT_ONE                                                  \
+  (1L << 30) ///< Value of 1.0 in `icm20948_quaternion_t` components
+
+/** DMP FIFO packet header bits. `ICM20948_DMP_HEADER_HEADER2` means a second
+ * header word follows with the `ICM20948_DMP_HEADER2_*` bits */
+typedef enum {
+  ICM20948_DMP_HEADER_ACCEL = 0x8000,          ///< Calibrated accel
+  ICM20948_DMP_HEADER_GYRO = 0x4000,           ///< Calibrated gyro and bias
+  ICM20948_DMP_HEADER_COMPASS = 0x2000,        ///< Calibrated mag
+  ICM20948_DMP_HEADER_ALS = 0x1000,            ///< Ambient light
+  ICM20948_DMP_HEADER_QUAT6 = 0x0800,          ///< Game rotation vector
+  ICM20948_DMP_HEADER_QUAT9 = 0x0400,          ///< Rotation vector
+  ICM20948_DMP_HEADER_PQUAT6 = 0x0200,         ///< Low precision Quat6
+  ICM20948_DMP_HEADER_GEOMAG = 0x0100,         ///< Geomagnetic vector
+  ICM20948_DMP_HEADER_PRESSURE = 0x0080,       ///< Pressure
+  ICM20948_DMP_HEADER_GYRO_CALIBR = 0x0040,    ///< Uncalibrated gyro
+  ICM20948_DMP_HEADER_COMPASS_CALIBR = 0x0020, ///< Uncalibrated mag
+  ICM20948_DMP_HEADER_STEP_DETECTOR = 0x0010,  ///< Step timestamp
+  ICM20948_DMP_HEADER_HEADER2 = 0x0008,        ///< Second header follows
+} icm20948_dmp_header_t;
+
+/** DMP FIFO second header word bits */
+typedef enum {
+  ICM20948_DMP_HEADER2_ACCEL_ACCURACY = 0x4000,   ///< Accel accuracy
+  ICM20948_DMP_HEADER2_GYRO_ACCURACY = 0x2000,    ///< Gyro accuracy
+  ICM20948_DMP_HEADER2_COMPASS_ACCURACY = 0x1000, ///< Mag accuracy
+  ICM20948_DMP_HEADER2_FSYNC = 0x0800,            ///< FSYNC delay
+  ICM20948_DMP_HEADER2_PICKUP = 0x0400,           ///< Pickup gesture
+  ICM20948_DMP_HEADER2_BATCH_MODE = 0x0100,       ///< Batch mode, no data
+  ICM20948_DMP_HEADER2_ACTIVITY = 0x0080,         ///< Activity recognition
+  ICM20948_DMP_HEADER2_SECONDARY_ON_OFF = 0x0040, ///< Secondary sensor state
+} icm20948_dmp_header2_t;
+
+/** Quaternion outputs the DMP can write to the FIFO */
+typedef enum {
+  ICM20948_DMP_QUAT6 = ICM20948_DMP_HEADER_QUAT6, ///< Accel and gyro fusion
+                                                  ///< (game rotation vector)
+  ICM20948_DMP_QUAT9 = ICM20948_DMP_HEADER_QUAT9, ///< Accel, gyro and mag
+                                                  ///< fusion (rotation vector)
+} icm20948_dmp_output_t;
+
+/** One orientation from the DMP as a unit quaternion. Components are in
+ * Q2.30 fixed point; divide by `ICM20948_DMP_QUAT_ONE` for floats */
+typedef struct {
+  uint32_t timestamp_us; ///< `micros()` when the DMP produced it
+  int32_t w;             ///< Real part, derived from x, y and z
+  int32_t x;             ///< X component
+  int32_t y;             ///< Y component
+  int32_t z;             ///< Z component
+  int16_t accuracy;      ///< Heading accuracy for `ICM20948_DMP_QUAT9`
+  uint16_t output;       ///< The `icm20948_dmp_output_t` it came from
+} icm20948_quaternion_t;
+
 /** The accelerometer data range */
 typedef enum {
   ICM20948_ACCEL_RANGE_2_G,
@@ -69,6 +166,9 @@ typedef enum {
   AK09916_MAG_DATARATE_100_HZ = 0x8, ///< updates at 100Hz
 } ak09916_data_rate_t;
 
+/** Scale factors for every ICM20948 range, used to replay recorded samples */
+extern const icm20x_scale_table_t icm20948_scales;
+
 /*!
  *    @brief  Class that stores state and functions for interacting with
  *            the ST ICM2948 9-DoF Accelerometer, gyro, and magnetometer
@@ -88,8 +188,33 @@ public:
 
   ak09916_data_rate_t getMagDataRate(void);
   bool setMagDataRate(ak09916_data_rate_t rate);
+  bool queueMagDataRate(ak09916_data_rate_t rate);
+
+  bool beginDMP(const uint8_t *firmware, uint16_t size);
+  bool enableDMPOutput(icm20948_dmp_output_t output, bool enable,
+                       uint16_t interval = 0);
+  uint16_t readDMPQuaternions(icm20948_quaternion_t *quats,
+                              uint16_t max_quats);
 
 private:
+  bool dmp_running = false;        ///< Has `beginDMP` succeeded
+  uint16_t dmp_outputs = 0;        ///< Enabled `icm20948_dmp_output_t` bits
+  uint16_t dmp_quat6_interval = 0; ///< Samples per Quat6 output, minus one
+  uint16_t dmp_quat9_interval = 0; ///< Samples per Quat9 output, minus one
+  uint8_t dmp_header[4];           ///< Header bytes of the next FIFO packet
+  uint8_t dmp_header_len = 0;      ///< Valid bytes in `dmp_header`
+  ak09916_data_rate_t mag_rate =
+      AK09916_MAG_DATARATE_100_HZ; ///< Rate to restore in `powerMag`
+
+  bool loadDMPFirmware(const uint8_t *firmware, uint16_t size);
+  bool writeDMPMemory(uint16_t address, const uint8_t *data, uint16_t len);
+  bool readDMPMemory(uint16_t address, uint8_t *data, uint16_t len);
+  bool writeDMPValue(uint16_t address, uint32_t value, uint8_t len);
+  void resetDMP(void);
+  bool routeMagToDMP(bool enable);
+  int16_t dmpPacketSize(const uint8_t *packet, uint8_t len);
+  uint8_t decodeDMPPacket(const uint8_t *packet, icm20948_quaternion_t *quats);
+
   uint8_t readMagRegister(uint8_t reg_addr);
   bool writeMagRegister(uint8_t reg_addr, uint8_t value);
 
@@ -97,7 +222,8 @@ private:
   bool auxI2CBusSetupFailed(void);
 
   bool setupMag(void);
-  void scaleValues(void);
+  bool powerMag(bool enable);
+  bool dmpOwnsFIFO(void);
 };
 
 #endif
\ No newline at end of file
@@ -43,24 +43,149 @@
 
 #include "Adafruit_ICM20X.h"
 
+// Types of queued auxillary I2C master operation
+enum { AUX_OP_READ, AUX_OP_WRITE, AUX_OP_DELAY, AUX_OP_RESET };
+
+// A run of adjacent registers mirrored by the shadow register file, stored
+// from `offset` in `shadow_regs`
+typedef struct {
+  uint8_t bank;
+  uint8_t first;
+  uint8_t len;
+  uint8_t offset;
+} shadow_span_t;
+
+// Sorted by bank then address, which is the order `commitConfig` writes in
+static constexpr shadow_span_t shadow_spans[] = {
+    {0, ICM20X_B0_USER_CTRL, 17, 0},          // USER_CTRL..INT_ENABLE_3
+    {0, ICM20X_B0_FIFO_EN_1, 4, 17},          // FIFO_EN_1..FIFO_MODE
+    {1, ICM20X_B1_XA_OFFS_H, 8, 21},          // XA_OFFS_H..ZA_OFFS_L
+    {2, ICM20X_B2_GYRO_SMPLRT_DIV, 3, 29},    // GYRO_SMPLRT_DIV..GYRO_CONFIG_2
+    {2, ICM20X_B2_ACCEL_SMPLRT_DIV_1, 6, 32}, // ACCEL_SMPLRT_DIV_1..CONFIG_2
+    {3, ICM20X_B3_I2C_MST_ODR_CONFIG, 7, 38}, // I2C_MST_ODR_CONFIG..SLV0_DO
+};
+#define SHADOW_SPANS (sizeof(shadow_spans) / sizeof(shadow_spans[0]))
+static_assert(shadow_spans[SHADOW_SPANS - 1].offset +
+                      shadow_spans[SHADOW_SPANS - 1].len ==
+                  ICM20X_SHADOW_SIZE,
+              "ICM20X_SHADOW_SIZE does not match the shadow spans");
+
+static int8_t shadowIndex(uint8_t bank, uint8_t reg) {
+  for (uint8_t i = 0; i < SHADOW_SPANS; i++) {
+    const shadow_span_t *span = &shadow_spans[i];
+    if (span->bank == bank && reg >= span->first &&
+        reg < span->first + span->len) {
+      return span->offset + reg - span->first;
+    }
+  }
+  return -1;
+}
+
+// Power on values of the shadowed settings this library manages, checked by a
+// warm start. Only the bits in `mask` are compared; the I2C master and slave 0
+// setup, range and rate fields are left to `begin`. Accel offsets are factory
+// trimmed and kept as they are
+typedef struct {
+  uint8_t bank;
+  uint8_t reg;
+  uint8_t mask;
+  uint8_t value;
+} reset_default_t;
+
+static const reset_default_t reset_defaults[] = {
+    {0, ICM20X_B0_USER_CTRL, 0xC0, 0x00}, // DMP and FIFO off
+    {0, ICM20X_B0_LP_CONFIG, 0x70, 0x40},
+    {0, ICM20X_B0_PWR_MGMT_1, 0x2F, 0x01}, // SLEEP is cleared by `_init`
+    {0, ICM20X_B0_PWR_MGMT_2, 0x3F, 0x00},
+    {0, ICM20X_B0_REG_INT_PIN_CFG, 0xFD, 0x00}, // BYPASS_EN is left alone
+    {0, ICM20X_B0_REG_INT_ENABLE, 0xFF, 0x00},
+    {0, ICM20X_B0_REG_INT_ENABLE_1, 0xFF, 0x00},
+    {0, ICM20X_B0_REG_INT_ENABLE_2, 0xFF, 0x00},
+    {0, ICM20X_B0_REG_INT_ENABLE_3, 0xFF, 0x00},
+    {0, ICM20X_B0_FIFO_EN_1, 0xFF, 0x00},
+    {0, ICM20X_B0_FIFO_EN_2, 0xFF, 0x00},
+    {0, ICM20X_B0_FIFO_MODE, 0xFF, 0x00},
+    {2, ICM20X_B2_GYRO_CONFIG_1, 0x39, 0x01}, // DLPF off
+    {2, ICM20X_B2_GYRO_CONFIG_2, 0xFF, 0x00},
+    {2, ICM20X_B2_ACCEL_INTEL_CTRL, 0xFF, 0x00},
+    {2, ICM20X_B2_ACCEL_WOM_THR, 0xFF, 0x00},
+    {2, ICM20X_B2_ACCEL_CONFIG_1, 0x39, 0x01}, // DLPF off
+    {2, ICM20X_B2_ACCEL_CONFIG_2, 0xFF, 0x00},
+};
+
+// Where each sensor's data sits in the burst starting at ACCEL_XOUT_H. The
+// magnetometer's 9 bytes are proxied by slave 0, ending with ST2 so the mag
+// knows the reading was fetched
+typedef struct {
+  uint8_t sensor; // icm20x_sensor_t
+  uint8_t offset;
+  uint8_t len;
+} data_block_t;
+
+static constexpr data_block_t data_blocks[] = {
+    {ICM20X_SENSOR_ACCEL, 0, 6},
+    {ICM20X_SENSOR_GYRO, 6, 6},
+    {ICM20X_SENSOR_TEMP, 12, 2},
+    {ICM20X_SENSOR_MAG, 14, 9},
+};
+#define DATA_BLOCKS (sizeof(data_blocks) / sizeof(data_blocks[0]))
+static_assert(data_blocks[DATA_BLOCKS - 1].offset +
+                      data_blocks[DATA_BLOCKS - 1].len ==
+                  ICM20X_DATA_SIZE,
+              "data blocks must cover ICM20X_DATA_SIZE");
+
+// Decode the 9 magnetometer bytes proxied by slave 0, ST1 through ST2, into
+// `mag` if they hold a new reading. Slave 0 may have already fetched the
+// reading that set ST1's DRDY bit, so a changed reading counts as new too.
+// Returns `icm20x_sample_flag_t` values
+static uint8_t decodeMag(const uint8_t *block, int16_t *mag) {
+  int16_t x = block[2] << 8 | block[1]; // little endian
+  int16_t y = block[4] << 8 | block[3];
+  int16_t z = block[6] << 8 | block[5];
+
+  uint8_t flags = 0;
+  if ((block[0] & 0x01) || x != mag[0] || y != mag[1] || z != mag[2]) {
+    flags |= ICM20X_SAMPLE_MAG_NEW;
+    mag[0] = x;
+    mag[1] = y;
+    mag[2] = z;
+  }
+  if (block[8] & 0x08) {
+    flags |= ICM20X_SAMPLE_MAG_OVERFLOW;
+  }
+  return flags;
+}
+
+static inline bool testBit(const uint8_t *map, uint8_t i) {
+  return map[i >> 3] & (1 << (i & 7));
+}
+
+static inline void setBit(uint8_t *map, uint8_t i) {
+  map[i >> 3] |= (1 << (i & 7));
+}
+
+static inline void clearBit(uint8_t *map, uint8_t i) {
+  map[i >> 3] &= ~(1 << (i & 7));
+}
+
 /*!
  *    @brief  Instantiates a new ICM20X class!
  */
-Adafruit_ICM20X::Adafruit_ICM20X(void) {
+Adafruit_ICM20X::Adafruit_ICM20X(void)
+    : accel_sensor(this), gyro_sensor(this), mag_sensor(this),
+      temp_sensor(this) {
+  invalidateShadow();
+#ifdef ICM20X_BUS_STATS
+  resetBusStats();
+#endif
 }
 
 /*!
  *    @brief  Cleans up the ICM20X
  */
 Adafruit_ICM20X::~Adafruit_ICM20X(void) {
-  if (accel_sensor)
-    delete accel_sensor;
-  if (gyro_sensor)
-    delete gyro_sensor;
-  if (mag_sensor)
-    delete mag_sensor;
-  if (temp_sensor)
-    delete temp_sensor;
+  if (spi_data_dev)
+    delete spi_data_dev;
 }
 
 /*!
@@ -84,7 +209,8 @@ bool Adafruit_ICM20X::begin_I2C(uint8_t i2c_address, TwoWire *wire,
 }
 
 /*!
- *    @brief  Sets up the hardware and initializes hardware SPI
+ *    @brief  Sets up the hardware and initializes hardware SPI. The ICM20948's
+ *            magnetometer is set up too and read in the same data burst
  *    @param  cs_pin The arduino pin # connected to chip select
  *    @param  theSPI The SPI object to be used for SPI connections.
  *    @param  sensor_id An optional parameter to set the sensor ids to
@@ -102,20 +228,29 @@ bool Adafruit_ICM20X::begin_SPI(uint8_t cs_pin, SPIClass *theSPI,
   }
 
   spi_dev = new Adafruit_SPIDevice(cs_pin,
-                                   1000000,               // frequency
-                                   SPI_BITORDER_MSBFIRST, // bit order
-                                   SPI_MODE0,             // data mode
+                                   ICM20X_SPI_CONFIG_FREQ, // frequency
+                                   SPI_BITORDER_MSBFIRST,  // bit order
+                                   SPI_MODE0,              // data mode
                                    theSPI);
 
   if (!spi_dev->begin()) {
     return false;
   }
+  invalidateBankCache();
+
+  spi_cs = cs_pin;
+  spi_sck = spi_miso = spi_mosi = -1;
+  spi_bus = theSPI;
+  if (!setupDataSPI()) {
+    return false;
+  }
 
   return _init(sensor_id);
 }
 
 /*!
- *    @brief  Sets up the hardware and initializes software SPI
+ *    @brief  Sets up the hardware and initializes software SPI, including the
+ *            ICM20948's magnetometer
  *    @param  cs_pin The arduino pin # connected to chip select
  *    @param  sck_pin The arduino pin # connected to SPI clock
  *    @param  miso_pin The arduino pin # connected to SPI MISO
@@ -134,30 +269,100 @@ bool Adafruit_ICM20X::begin_SPI(int8_t cs_pin, int8_t sck_pin, int8_t miso_pin,
     delete spi_dev; // remove old interface
   }
   spi_dev = new Adafruit_SPIDevice(cs_pin, sck_pin, miso_pin, mosi_pin,
-                                   1000000,               // frequency
-                                   SPI_BITORDER_MSBFIRST, // bit order
-                                   SPI_MODE0);            // data mode
+                                   ICM20X_SPI_CONFIG_FREQ, // frequency
+                                   SPI_BITORDER_MSBFIRST,  // bit order
+                                   SPI_MODE0);             // data mode
   if (!spi_dev->begin()) {
     return false;
   }
+  invalidateBankCache();
+
+  spi_cs = cs_pin;
+  spi_sck = sck_pin;
+  spi_miso = miso_pin;
+  spi_mosi = mosi_pin;
+  if (!setupDataSPI()) {
+    return false;
+  }
 
   return _init(sensor_id);
 }
 
+/*!
+ *    @brief  Set the SPI clock used for sensor data and FIFO bursts.
+ * Configuration registers are always accessed at `ICM20X_SPI_CONFIG_FREQ`;
+ * the chip allows up to `ICM20X_SPI_MAX_FREQ` for reading sensor data. May be
+ * called before or after `begin_SPI`
+ *    @param  frequency The data clock in Hz, limited to `ICM20X_SPI_MAX_FREQ`
+ *    @return True if the setting was applied, otherwise false.
+ */
+bool Adafruit_ICM20X::setSPIDataFrequency(uint32_t frequency) {
+  if (frequency > ICM20X_SPI_MAX_FREQ) {
+    frequency = ICM20X_SPI_MAX_FREQ;
+  }
+  spi_data_freq = frequency;
+
+  if (!spi_dev) {
+    return true; // applied by begin_SPI
+  }
+  return setupDataSPI();
+}
+
+/*!
+ *    @brief  Get how long the last sensor data or FIFO burst took, including
+ * the bus transaction overhead
+ *    @return The duration in microseconds
+ */
+uint32_t Adafruit_ICM20X::getLastBurstMicros(void) { return last_burst_us; }
+
+/*!
+ *    @brief  Create the second SPI interface on the same pins that runs at the
+ * data clock, or remove it if the data clock is no faster than the
+ * configuration clock
+ *    @return True if the interface is ready, otherwise false.
+ */
+bool Adafruit_ICM20X::setupDataSPI(void) {
+  if (spi_data_dev) {
+    delete spi_data_dev;
+    spi_data_dev = NULL;
+  }
+  if (spi_data_freq <= ICM20X_SPI_CONFIG_FREQ) {
+    return true;
+  }
+
+  if (spi_sck < 0) {
+    spi_data_dev = new Adafruit_SPIDevice(spi_cs, spi_data_freq,
+                                          SPI_BITORDER_MSBFIRST, SPI_MODE0,
+                                          spi_bus);
+  } else {
+    spi_data_dev =
+        new Adafruit_SPIDevice(spi_cs, spi_sck, spi_miso, spi_mosi,
+                               spi_data_freq, SPI_BITORDER_MSBFIRST, SPI_MODE0);
+  }
+
+  if (!spi_data_dev->begin()) {
+    delete spi_data_dev;
+    spi_data_dev = NULL;
+    return false;
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Get the SPI interface to use for sensor data bursts
+ *    @return The fast data interface if there is one, otherwise `spi_dev`
+ */
+Adafruit_SPIDevice *Adafruit_ICM20X::dataSPIDevice(void) {
+  return spi_data_dev ? spi_data_dev : spi_dev;
+}
+
 /*!
  * @brief Get Accelerator X offset from ICM20948 bank 1
  *
  */
 int16_t Adafruit_ICM20X::getAccelXOffset(void) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-  uint8_t buffer[numbytes];
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_XA_OFFS_H, numbytes);
-  offset_reg.read(buffer, numbytes);
-  
-  return buffer[0] << 8 | buffer[1];
+  return readConfig(1, ICM20X_B1_XA_OFFS_H) << 8 |
+         readConfig(1, ICM20X_B1_XA_OFFS_L);
 }
 
 /*!
@@ -165,15 +370,8 @@ int16_t Adafruit_ICM20X::getAccelXOffset(void) {
  *
  */
 int16_t Adafruit_ICM20X::getAccelYOffset(void) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-  uint8_t buffer[numbytes];
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_YA_OFFS_H, numbytes);
-  offset_reg.read(buffer, numbytes);
-  
-  return buffer[0] << 8 | buffer[1];
+  return readConfig(1, ICM20X_B1_YA_OFFS_H) << 8 |
+         readConfig(1, ICM20X_B1_YA_OFFS_L);
 }
 
 /*!
@@ -181,15 +379,8 @@ int16_t Adafruit_ICM20X::getAccelYOffset(void) {
  *
  */
 int16_t Adafruit_ICM20X::getAccelZOffset(void) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-  uint8_t buffer[numbytes];
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_ZA_OFFS_H, numbytes);
-  offset_reg.read(buffer, numbytes);
-  
-  return buffer[0] << 8 | buffer[1];
+  return readConfig(1, ICM20X_B1_ZA_OFFS_H) << 8 |
+         readConfig(1, ICM20X_B1_ZA_OFFS_L);
 }
 
 /*!
@@ -197,17 +388,10 @@ int16_t Adafruit_ICM20X::getAccelZOffset(void) {
  *
  */
 void Adafruit_ICM20X::setAccelXOffset(int16_t offset) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_XA_OFFS_H, numbytes);
-
-  uint8_t buffer[numbytes];
-  buffer[0] = offset >> 8;
-  buffer[1] = offset  & 0xFE;
-  
-  offset_reg.write(buffer, numbytes);
+  beginConfig();
+  writeConfig(1, ICM20X_B1_XA_OFFS_H, offset >> 8);
+  writeConfig(1, ICM20X_B1_XA_OFFS_L, offset & 0xFE);
+  commitConfig();
 }
 
 
@@ -216,17 +400,10 @@ void Adafruit_ICM20X::setAccelXOffset(int16_t offset) {
  *
  */
 void Adafruit_ICM20X::setAccelYOffset(int16_t offset) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_YA_OFFS_H, numbytes);
-
-  uint8_t buffer[numbytes];
-  buffer[0] = offset >> 8;
-  buffer[1] = offset & 0xFE;
-  
-  offset_reg.write(buffer, numbytes);
+  beginConfig();
+  writeConfig(1, ICM20X_B1_YA_OFFS_H, offset >> 8);
+  writeConfig(1, ICM20X_B1_YA_OFFS_L, offset & 0xFE);
+  commitConfig();
 }
 
 
@@ -235,17 +412,10 @@ void Adafruit_ICM20X::setAccelYOffset(int16_t offset) {
  *
  */
 void Adafruit_ICM20X::setAccelZOffset(int16_t offset) {
-  _setBank(1);
-
-  const uint8_t numbytes = 2;
-
-  Adafruit_BusIO_Register offset_reg = Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B1_ZA_OFFS_H, numbytes);
-
-  uint8_t buffer[numbytes];
-  buffer[0] = offset >> 8;
-  buffer[1] = offset & 0xFE;
-  
-  offset_reg.write(buffer, numbytes);
+  beginConfig();
+  writeConfig(1, ICM20X_B1_ZA_OFFS_H, offset >> 8);
+  writeConfig(1, ICM20X_B1_ZA_OFFS_L, offset & 0xFE);
+  commitConfig();
 }
 
 /*!
@@ -253,9 +423,11 @@ void Adafruit_ICM20X::setAccelZOffset(int16_t offset) {
  *
  */
 void Adafruit_ICM20X::setAccelOffset(int16_t offAccX, int16_t offAccY, int16_t offAccZ) {
+  beginConfig();
   setAccelXOffset(offAccX);
   setAccelYOffset(offAccY);
   setAccelZOffset(offAccZ);
+  commitConfig();
 }
 
 
@@ -264,21 +436,208 @@ void Adafruit_ICM20X::setAccelOffset(int16_t offAccX, int16_t offAccY, int16_t o
  *
  */
 void Adafruit_ICM20X::reset(void) {
+  // DEVICE_RESET clears itself, so it is set around the shadow
+  uint8_t pwr_mgmt_1 = readConfig(0, ICM20X_B0_PWR_MGMT_1) | 0x80;
+  _setBank(0);
+  writeRegister(ICM20X_B0_PWR_MGMT_1, pwr_mgmt_1);
+  // the reset returns REG_BANK_SEL to bank 0 and every register to its default
+  invalidateBankCache();
+  invalidateShadow();
+  snapshot_valid = false;
+  current_gyro_divisor = 0;
+  current_accel_divisor = 0;
+
+  // the chip stops answering while it resets. It is done once WHOAMI reads
+  // back and PWR_MGMT_1 is at its reset value, asleep with DEVICE_RESET clear
+  uint32_t start = millis();
+  uint8_t buffer[ICM20X_B0_PWR_MGMT_1 + 1];
+  do {
+    delay(1);
+    if (readRegisters(ICM20X_B0_WHOAMI, buffer, sizeof(buffer)) &&
+        (buffer[ICM20X_B0_WHOAMI] == ICM20649_CHIP_ID ||
+         buffer[ICM20X_B0_WHOAMI] == ICM20948_CHIP_ID) &&
+        (buffer[ICM20X_B0_PWR_MGMT_1] & 0xC0) == 0x40) {
+      return;
+    }
+  } while (millis() - start < ICM20X_RESET_TIMEOUT_MS);
+}
+
+/**************************************************************************/
+/*!
+ * @brief Enable or disable the on-chip FIFO for accel, gyro and temp data.
+ * Each sensor writes to the FIFO at its own rate, so give the accelerometer
+ * and gyro the same rate divisor to keep every frame complete
+ *
+ * @param enable true: start buffering samples false: stop buffering
+ * @param include_mag true to also buffer the 9 magnetometer bytes proxied by
+ * I2C slave 0. Only useful on the ICM20948 once the magnetometer is set up
+ * @return true: success false: failure, or the DMP is using the FIFO
+ */
+bool Adafruit_ICM20X::enableFIFO(bool enable, bool include_mag) {
+  if (dmpOwnsFIFO()) {
+    return false;
+  }
+
+  fifo_frame_size = 0;
+  beginConfig();
+  if (!enable) {
+    writeConfig(0, ICM20X_B0_FIFO_EN_1, 0);
+    writeConfig(0, ICM20X_B0_FIFO_EN_2, 0);
+    writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 6, false);
+    return commitConfig();
+  }
+
+  // stream mode; overflows are detected in readFIFO and the FIFO reset
+  writeConfig(0, ICM20X_B0_FIFO_MODE, 0);
+  // accel, gyro X/Y/Z and temp, in register order
+  writeConfig(0, ICM20X_B0_FIFO_EN_2, 0x1F);
+  writeConfig(0, ICM20X_B0_FIFO_EN_1, include_mag ? 0x01 : 0x00);
+  writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 6, true);
+  if (!commitConfig()) {
+    return false;
+  }
+
+  resetFIFO();
+  fifo_frame_size =
+      include_mag ? ICM20X_FIFO_MAG_FRAME_SIZE : ICM20X_FIFO_FRAME_SIZE;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Discard the contents of the FIFO and clear any pending overflow
+ */
+void Adafruit_ICM20X::resetFIFO(void) {
+  _setBank(0);
+
+  writeRegister(ICM20X_B0_FIFO_RST, 0x1F);
+  writeRegister(ICM20X_B0_FIFO_RST, 0x00);
+  readRegister(ICM20X_B0_INT_STATUS_2); // clear on read
+}
+
+/**************************************************************************/
+/*!
+ * @brief Get the number of bytes waiting in the FIFO
+ *
+ * @return The FIFO byte count
+ */
+uint16_t Adafruit_ICM20X::getFIFOCount(void) {
+  _setBank(0);
+
+  uint8_t buffer[2];
+  if (!readRegisters(ICM20X_B0_FIFO_COUNT_H, buffer, 2)) {
+    return 0;
+  }
+  return (buffer[0] << 8 | buffer[1]) & 0x1FFF;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Drain complete frames from the FIFO into a sample ring. All waiting
+ * frames are fetched with as few bus transactions as `ICM20X_FIFO_MAX_BURST`
+ * allows, instead of one transaction per sample
+ *
+ * @param ring The ring to store the raw samples in
+ * @param max_frames The most frames to drain in this call
+ * @return The number of samples added to the ring, 0 while the DMP is using
+ * the FIFO
+ */
+uint16_t Adafruit_ICM20X::readFIFO(Adafruit_ICM20X_SampleRing *ring,
+                                   uint16_t max_frames) {
+  if (!fifo_frame_size || !ring || dmpOwnsFIFO()) {
+    return 0;
+  }
+
   _setBank(0);
 
-  Adafruit_BusIO_Register pwr_mgmt1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_PWR_MGMT_1, 1);
+  if (readRegister(ICM20X_B0_INT_STATUS_2) & 0x1F) {
+    // the oldest data was overwritten so frame alignment is lost
+    fifo_overflows++;
+    resetFIFO();
+    return 0;
+  }
+
+  uint16_t queued = getFIFOCount() / fifo_frame_size;
+  // the newest frame was written at the last data ready edge, or just now
+  uint32_t newest_us = sampleTime(micros());
+  uint32_t period_ns = getSamplePeriodNanos();
+
+  uint16_t frames = queued;
+  if (frames > max_frames) {
+    frames = max_frames;
+  }
+  if (frames > ring->space()) {
+    frames = ring->space();
+  }
+
+  const uint8_t frames_per_burst = ICM20X_FIFO_MAX_BURST / fifo_frame_size;
+  uint8_t buffer[ICM20X_FIFO_MAX_BURST];
+  icm20x_raw_sample_t sample;
+  uint16_t drained = 0;
+
+  while (drained < frames) {
+    uint8_t burst_frames = frames_per_burst;
+    if (frames - drained < burst_frames) {
+      burst_frames = frames - drained;
+    }
+
+    uint32_t start_us = micros();
+    bool success = readRegisters(ICM20X_B0_FIFO_R_W, buffer,
+                                 burst_frames * fifo_frame_size,
+                                 ICM20X_BUS_OP_DATA);
+    last_burst_us = micros() - start_us;
+    if (!success) {
+      break;
+    }
+    for (uint8_t i = 0; i < burst_frames; i++) {
+      decodeFIFOFrame(buffer + (i * fifo_frame_size), &sample);
+      // frames are evenly spaced by the sample period, oldest first
+      uint16_t age = queued - 1 - (drained + i);
+      sample.timestamp_us =
+          newest_us - (uint32_t)(((uint64_t)age * period_ns) / 1000);
+      ring->push(&sample);
+    }
+    drained += burst_frames;
+  }
+
+  return drained;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Get the number of times the FIFO overflowed and had to be reset
+ *
+ * @return The overflow count since the object was created
+ */
+uint32_t Adafruit_ICM20X::getFIFOOverflowCount(void) { return fifo_overflows; }
+
+/*!
+ * @brief Unpack one FIFO frame. Frames follow the data register layout:
+ * accel, gyro and temp big endian, then the proxied AK09916 ST1, little endian
+ * mag data, a dummy byte and ST2
+ *
+ * @param buffer The frame bytes
+ * @param sample The sample to fill in
+ */
+void Adafruit_ICM20X::decodeFIFOFrame(const uint8_t *buffer,
+                                      icm20x_raw_sample_t *sample) {
+  sample->accel[0] = buffer[0] << 8 | buffer[1];
+  sample->accel[1] = buffer[2] << 8 | buffer[3];
+  sample->accel[2] = buffer[4] << 8 | buffer[5];
 
-  Adafruit_BusIO_RegisterBits reset_bit =
-      Adafruit_BusIO_RegisterBits(&pwr_mgmt1, 1, 7);
+  sample->gyro[0] = buffer[6] << 8 | buffer[7];
+  sample->gyro[1] = buffer[8] << 8 | buffer[9];
+  sample->gyro[2] = buffer[10] << 8 | buffer[11];
 
-  reset_bit.write(1);
-  delay(20);
+  sample->temperature = buffer[12] << 8 | buffer[13];
 
-  while (reset_bit.read()) {
-    delay(10);
-  };
-  delay(50);
+  if (fifo_frame_size == ICM20X_FIFO_MAG_FRAME_SIZE) {
+    sample->flags = decodeMag(buffer + 14, fifo_mag);
+    memcpy(sample->mag, fifo_mag, sizeof(fifo_mag));
+  } else {
+    sample->mag[0] = sample->mag[1] = sample->mag[2] = 0;
+    sample->flags = 0;
+  }
 }
 
 /*!  @brief Initilizes the sensor
@@ -286,13 +645,12 @@ void Adafruit_ICM20X::reset(void) {
  *   @returns True if chip identified and initialized
  */
 bool Adafruit_ICM20X::_init(int32_t sensor_id) {
-  Adafruit_BusIO_Register chip_id = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_WHOAMI);
+  startup_begin_us = micros();
 
   _setBank(0);
-  uint8_t chip_id_ = chip_id.read();
+  chip_id = readRegister(ICM20X_B0_WHOAMI);
   // This returns true when using a 649 lib with a 948
-  if ((chip_id_ != ICM20649_CHIP_ID) && (chip_id_ != ICM20948_CHIP_ID)) {
+  if ((chip_id != ICM20649_CHIP_ID) && (chip_id != ICM20948_CHIP_ID)) {
     return false;
   }
 
@@ -301,34 +659,126 @@ bool Adafruit_ICM20X::_init(int32_t sensor_id) {
   _sensorid_mag = sensor_id + 2;
   _sensorid_temp = sensor_id + 3;
 
-  reset();
+  // one burst per bank instead of a read for every register we touch. A chip
+  // that is already awake was set up before the MCU restarted
+  uint8_t chip_regs[ICM20X_SHADOW_SIZE];
+  warm_started = warm_start && refreshShadow() &&
+                 !readConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 6);
+  if (warm_started) {
+    memcpy(chip_regs, shadow_regs, ICM20X_SHADOW_SIZE);
+  } else {
+    reset();
+    refreshShadow();
+  }
+
+  // sign and magnitude, as in InvenSense's reference driver
+  _setBank(1);
+  uint8_t pll = readRegister(ICM20X_B1_TIMEBASE_CORRECTION_PLL);
+  timebase_pll = (pll & 0x80) ? -(int8_t)(pll & 0x7F) : (int8_t)pll;
 
-  Adafruit_BusIO_Register pwr_mgmt_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_PWR_MGMT_1);
+  beginConfig();
+  if (warm_started) {
+    applyResetDefaults();
+  }
 
-  Adafruit_BusIO_RegisterBits sleep =
-      Adafruit_BusIO_RegisterBits(&pwr_mgmt_1, 1, 6);
-  sleep.write(false); // take out of default sleep state
+  // take out of default sleep state
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 6, false);
 
   // 3 will be the largest range for either sensor
   writeGyroRange(3);
   writeAccelRange(3);
 
-  // 1100Hz/(1+10) = 100Hz
-  setGyroRateDivisor(10);
+  setGyroDataRate(ICM20X_DEFAULT_GYRO_RATE_HZ);
+  setAccelDataRate(ICM20X_DEFAULT_ACCEL_RATE_HZ);
 
-  // # 1125Hz/(1+20) = 53.57Hz
-  setAccelRateDivisor(20);
+  if (warm_started) {
+    discardUnchanged(chip_regs);
+  }
+  commitConfig();
 
-  temp_sensor = new Adafruit_ICM20X_Temp(this);
-  accel_sensor = new Adafruit_ICM20X_Accelerometer(this);
-  gyro_sensor = new Adafruit_ICM20X_Gyro(this);
-  mag_sensor = new Adafruit_ICM20X_Magnetometer(this);
-  delay(20);
+  if (!setupMag()) {
+    return false;
+  }
+  waitForData();
 
+  startup_us = micros() - startup_begin_us;
   return true;
 }
 
+/*!
+ *    @brief  Set up the magnetometer, for chips that have one. Runs at the
+ *            end of `_init` for every bus
+ *    @returns True on success
+ */
+bool Adafruit_ICM20X::setupMag(void) { return true; }
+
+/*!
+ *    @brief  Put the settings a reset would clear back to their power on
+ *            values, inside the current `beginConfig` batch
+ */
+void Adafruit_ICM20X::applyResetDefaults(void) {
+  for (uint8_t i = 0; i < sizeof(reset_defaults) / sizeof(reset_defaults[0]);
+       i++) {
+    const reset_default_t *def = &reset_defaults[i];
+    uint8_t value = readConfig(def->bank, def->reg);
+    writeConfig(def->bank, def->reg,
+                (value & ~def->mask) | (def->value & def->mask));
+  }
+}
+
+/*!
+ *    @brief  Drop pending writes of registers that already hold their new
+ *            value, so a warm start only writes what actually differs
+ *    @param  chip_regs The shadow register file as read from the chip
+ */
+void Adafruit_ICM20X::discardUnchanged(const uint8_t *chip_regs) {
+  for (uint8_t i = 0; i < ICM20X_SHADOW_SIZE; i++) {
+    if (testBit(shadow_dirty, i) && shadow_regs[i] == chip_regs[i]) {
+      clearBit(shadow_dirty, i);
+    }
+  }
+}
+
+/*!
+ *    @brief  Wait for the first sample to be ready, at most
+ *            `ICM20X_STARTUP_TIMEOUT_MS`
+ */
+void Adafruit_ICM20X::waitForData(void) {
+  uint32_t start = millis();
+
+  _setBank(0);
+  while (!(readRegister(ICM20X_B0_INT_STATUS_1) & 0x01)) {
+    if (millis() - start >= ICM20X_STARTUP_TIMEOUT_MS) {
+      return;
+    }
+    delay(1);
+  }
+}
+
+/*!
+ *    @brief  Choose whether `begin` may skip resetting a chip that is already
+ *            running, such as after the MCU restarts without power cycling
+ *            the sensor. The chip's settings are read back and only those
+ *            that differ from a fresh `begin` are written. Call before `begin`
+ *    @param  warm_start true: keep a running chip false: always reset
+ */
+void Adafruit_ICM20X::setWarmStart(bool warm_start) {
+  this->warm_start = warm_start;
+}
+
+/*!
+ *    @brief  Check whether the last `begin` found the chip running and
+ *            skipped the reset
+ *    @returns True if the chip was warm started
+ */
+bool Adafruit_ICM20X::wasWarmStart(void) { return warm_started; }
+
+/*!
+ *    @brief  Get how long the last `begin` took
+ *    @returns The startup time in microseconds
+ */
+uint32_t Adafruit_ICM20X::getStartupMicros(void) { return startup_us; }
+
 /**************************************************************************/
 /*!
     @brief  Gets the most recent sensor event, Adafruit Unified Sensor format
@@ -348,18 +798,30 @@ bool Adafruit_ICM20X::_init(int32_t sensor_id) {
             Pointer to an Adafruit Unified sensor_event_t object to be filled
             with temperature event data.
 
+    Any of the pointers may be NULL; only the sensors asked for are read
+
     @return True on successful read
 */
 /**************************************************************************/
 bool Adafruit_ICM20X::getEvent(sensors_event_t *accel, sensors_event_t *gyro,
                                sensors_event_t *temp, sensors_event_t *mag) {
-  uint32_t t = millis();
-  _read();
+  uint8_t sensors = (accel ? ICM20X_SENSOR_ACCEL : 0) |
+                    (gyro ? ICM20X_SENSOR_GYRO : 0) |
+                    (temp ? ICM20X_SENSOR_TEMP : 0) |
+                    (mag ? ICM20X_SENSOR_MAG : 0);
+  _read(sensors);
+  uint32_t t = sampleMillis();
 
   // use helpers to fill in the events
-  fillAccelEvent(accel, t);
-  fillGyroEvent(gyro, t);
-  fillTempEvent(temp, t);
+  if (accel) {
+    fillAccelEvent(accel, t);
+  }
+  if (gyro) {
+    fillGyroEvent(gyro, t);
+  }
+  if (temp) {
+    fillTempEvent(temp, t);
+  }
   if (mag) {
     fillMagEvent(mag, t);
   }
@@ -375,9 +837,9 @@ void Adafruit_ICM20X::fillAccelEvent(sensors_event_t *accel,
   accel->type = SENSOR_TYPE_ACCELEROMETER;
   accel->timestamp = timestamp;
 
-  accel->acceleration.x = accX * SENSORS_GRAVITY_EARTH;
-  accel->acceleration.y = accY * SENSORS_GRAVITY_EARTH;
-  accel->acceleration.z = accZ * SENSORS_GRAVITY_EARTH;
+  accel->acceleration.x = accX;
+  accel->acceleration.y = accY;
+  accel->acceleration.z = accZ;
 }
 
 void Adafruit_ICM20X::fillGyroEvent(sensors_event_t *gyro, uint32_t timestamp) {
@@ -386,9 +848,9 @@ void Adafruit_ICM20X::fillGyroEvent(sensors_event_t *gyro, uint32_t timestamp) {
   gyro->sensor_id = _sensorid_gyro;
   gyro->type = SENSOR_TYPE_GYROSCOPE;
   gyro->timestamp = timestamp;
-  gyro->gyro.x = gyroX * SENSORS_DPS_TO_RADS;
-  gyro->gyro.y = gyroY * SENSORS_DPS_TO_RADS;
-  gyro->gyro.z = gyroZ * SENSORS_DPS_TO_RADS;
+  gyro->gyro.x = gyroX;
+  gyro->gyro.y = gyroY;
+  gyro->gyro.z = gyroZ;
 }
 
 void Adafruit_ICM20X::fillMagEvent(sensors_event_t *mag, uint32_t timestamp) {
@@ -397,7 +859,7 @@ void Adafruit_ICM20X::fillMagEvent(sensors_event_t *mag, uint32_t timestamp) {
   mag->sensor_id = _sensorid_mag;
   mag->type = SENSOR_TYPE_MAGNETIC_FIELD;
   mag->timestamp = timestamp;
-  mag->magnetic.x = magX; // magic number!
+  mag->magnetic.x = magX;
   mag->magnetic.y = magY;
   mag->magnetic.z = magZ;
 }
@@ -409,155 +871,997 @@ void Adafruit_ICM20X::fillTempEvent(sensors_event_t *temp, uint32_t timestamp) {
   temp->sensor_id = _sensorid_temp;
   temp->type = SENSOR_TYPE_AMBIENT_TEMPERATURE;
   temp->timestamp = timestamp;
-  temp->temperature = (temperature / 333.87) + 21.0;
+  temp->temperature = temperature;
 }
 /******************* Adafruit_Sensor functions *****************/
 /*!
- *     @brief  Updates the measurement data for all sensors simultaneously
+ *     @brief  Updates the measurement data for the requested sensors with one
+ *             burst read
+ *     @param  sensors
+ *             A combination of `icm20x_sensor_t` values for the sensors to
+ *             read
+ *     @returns True on a successful read
  */
 /**************************************************************************/
-void Adafruit_ICM20X::_read(void) {
-
-  _setBank(0);
-
-  // reading 9 bytes of mag data to fetch the register that tells the mag we've
-  // read all the data
-  const uint8_t numbytes = 14 + 9; // Read Accel, gyro, temp, and 9 bytes of mag
-
-  Adafruit_BusIO_Register data_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_ACCEL_XOUT_H, numbytes);
-
-  uint8_t buffer[numbytes];
-  data_reg.read(buffer, numbytes);
-
-  rawAccX = buffer[0] << 8 | buffer[1];
-  rawAccY = buffer[2] << 8 | buffer[3];
-  rawAccZ = buffer[4] << 8 | buffer[5];
-
-  rawGyroX = buffer[6] << 8 | buffer[7];
-  rawGyroY = buffer[8] << 8 | buffer[9];
-  rawGyroZ = buffer[10] << 8 | buffer[11];
-
-  temperature = buffer[12] << 8 | buffer[13];
-
-  rawMagX = ((buffer[16] << 8) |
-             (buffer[15] & 0xFF)); // Mag data is read little endian
-  rawMagY = ((buffer[18] << 8) | (buffer[17] & 0xFF));
-  rawMagZ = ((buffer[20] << 8) | (buffer[19] & 0xFF));
-
+bool Adafruit_ICM20X::_read(uint8_t sensors) {
+  if (!_readRaw(sensors)) {
+    snapshot_valid = false;
+    return false;
+  }
   scaleValues();
-  _setBank(0);
+
+  snapshot_time_us = micros();
+  snapshot_generation++;
+  snapshot_sensors = sensors;
+  snapshot_valid = true;
+  return true;
 }
-/*!
- * @brief Scales the raw variables based on the current measurement range
- *
- */
-void Adafruit_ICM20X::scaleValues(void) {}
 
 /*!
-    @brief  Gets an Adafruit Unified Sensor object for the accelerometer
-    sensor component
-    @return Adafruit_Sensor pointer to accelerometer sensor
+ *     @brief  Updates the measurement data only if the last reading is older
+ *             than the age set with `setSnapshotMaxAge` or doesn't include
+ *             the requested sensors, so the Unified Sensor objects can share
+ *             one burst read
+ *     @param  sensors
+ *             A combination of `icm20x_sensor_t` values for the sensors
+ *             needed. When readings are shared every sensor is read, so the
+ *             other objects can use the same burst
+ *     @returns True if the measurement data is usable
  */
-Adafruit_Sensor *Adafruit_ICM20X::getAccelerometerSensor(void) {
-  return accel_sensor;
+bool Adafruit_ICM20X::_readIfStale(uint8_t sensors) {
+  uint32_t max_age_us = snapshot_max_age_us;
+  if (max_age_us == ICM20X_SNAPSHOT_DATA_PERIOD) {
+    max_age_us = dataPeriodMicros();
+  }
+
+  if (snapshot_valid && ((snapshot_sensors & sensors) == sensors) &&
+      ((micros() - snapshot_time_us) < max_age_us)) {
+    return true;
+  }
+  if (max_age_us) {
+    sensors = ICM20X_SENSOR_ALL;
+  }
+  return _read(sensors);
 }
 
 /*!
-    @brief  Gets an Adafruit Unified Sensor object for the gyro sensor component
-    @return Adafruit_Sensor pointer to gyro sensor
+ *     @brief  Get the time between new samples from the faster of the
+ *             accelerometer and gyro, based on their data rates
+ *     @returns The output data period in microseconds
  */
-Adafruit_Sensor *Adafruit_ICM20X::getGyroSensor(void) { return gyro_sensor; }
+uint32_t Adafruit_ICM20X::dataPeriodMicros(void) {
+  return getSamplePeriodNanos() / 1000;
+}
 
 /*!
-    @brief  Gets an Adafruit Unified Sensor object for the magnetometer sensor
-   component
-    @return Adafruit_Sensor pointer to magnetometer sensor
+ *     @brief  Fetch the raw measurement data for the requested sensors in one
+ *             burst, without scaling it. The burst spans only the requested
+ *             sensors that are powered; requested sensors that are powered
+ *             down read as zero and the rest are left unchanged.
+ *             `Adafruit_ICM20X_Replay` overrides this to read from a log
+ *     @param  sensors
+ *             A combination of `icm20x_sensor_t` values for the sensors to
+ *             read
+ *     @returns True on a successful read
  */
-Adafruit_Sensor *Adafruit_ICM20X::getMagnetometerSensor(void) {
-  return mag_sensor;
+bool Adafruit_ICM20X::_readRaw(uint8_t sensors) {
+  uint8_t wanted = sensors & getPoweredSensors();
+  uint8_t start = ICM20X_DATA_SIZE, end = 0;
+  for (uint8_t i = 0; i < DATA_BLOCKS; i++) {
+    const data_block_t *block = &data_blocks[i];
+    if (wanted & block->sensor) {
+      if (start == ICM20X_DATA_SIZE) {
+        start = block->offset;
+      }
+      end = block->offset + block->len;
+    }
+  }
+
+  uint8_t buffer[ICM20X_DATA_SIZE] = {0};
+  uint32_t start_us = micros();
+  if (end) {
+    _setBank(0);
+    bool success = readRegisters(ICM20X_B0_ACCEL_XOUT_H + start, buffer + start,
+                                 end - start, ICM20X_BUS_OP_DATA);
+    if (!success) {
+      last_burst_us = micros() - start_us;
+      return false;
+    }
+  }
+  last_burst_us = micros() - start_us;
+  sample_time_us = sampleTime(start_us);
+
+  if (sensors & ICM20X_SENSOR_ACCEL) {
+    rawAccX = buffer[0] << 8 | buffer[1];
+    rawAccY = buffer[2] << 8 | buffer[3];
+    rawAccZ = buffer[4] << 8 | buffer[5];
+  }
+
+  if (sensors & ICM20X_SENSOR_GYRO) {
+    rawGyroX = buffer[6] << 8 | buffer[7];
+    rawGyroY = buffer[8] << 8 | buffer[9];
+    rawGyroZ = buffer[10] << 8 | buffer[11];
+  }
+
+  if (sensors & ICM20X_SENSOR_TEMP) {
+    rawTemp = buffer[12] << 8 | buffer[13];
+  }
+
+  // leave the magnetometer alone unless it has something new, so it is only
+  // rescaled when it changes
+  sample_flags = 0;
+  mag_updated = false;
+  if (wanted & ICM20X_SENSOR_MAG) {
+    int16_t mag[3] = {rawMagX, rawMagY, rawMagZ};
+    sample_flags = decodeMag(buffer + 14, mag);
+    mag_updated = sample_flags & ICM20X_SAMPLE_MAG_NEW;
+    rawMagX = mag[0];
+    rawMagY = mag[1];
+    rawMagZ = mag[2];
+  } else if (sensors & ICM20X_SENSOR_MAG) {
+    rawMagX = rawMagY = rawMagZ = 0;
+    mag_updated = true;
+  }
+
+  return true;
 }
 
+/**************************************************************************/
 /*!
-    @brief  Gets an Adafruit Unified Sensor object for the temp sensor component
-    @return Adafruit_Sensor pointer to temperature sensor
- */
-Adafruit_Sensor *Adafruit_ICM20X::getTemperatureSensor(void) {
-  return temp_sensor;
+    @brief  Set how long a reading may be shared between the accelerometer,
+    gyro, magnetometer and temperature Unified Sensor objects. Within that
+    time their `getEvent` calls reuse the last burst read instead of each
+    fetching their own
+    @param  max_age_us The age in microseconds after which a new reading is
+    taken. 0, the default, reads on every call. `ICM20X_SNAPSHOT_DATA_PERIOD`
+    reuses a reading until the sensor has produced a new one
+*/
+/**************************************************************************/
+void Adafruit_ICM20X::setSnapshotMaxAge(uint32_t max_age_us) {
+  snapshot_max_age_us = max_age_us;
 }
+
 /**************************************************************************/
 /*!
-    @brief Sets register bank.
-    @param  bank_number
-          The bank to set to active
+    @brief  Get a count of the readings taken. It changes whenever the data
+    returned by the Unified Sensor objects is refreshed
+    @return The number of readings taken so far
 */
-void Adafruit_ICM20X::_setBank(uint8_t bank_number) {
-
-  Adafruit_BusIO_Register reg_bank_sel = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_REG_BANK_SEL);
-
-  reg_bank_sel.write((bank_number & 0b11) << 4);
+/**************************************************************************/
+uint32_t Adafruit_ICM20X::getSnapshotGeneration(void) {
+  return snapshot_generation;
 }
 
 /**************************************************************************/
 /*!
-    @brief Get the accelerometer's measurement range.
-    @returns The accelerometer's measurement range (`icm20x_accel_range_t`).
+    @brief Get when the latest reading was taken. With `ICM20X_INT_DATA_READY`
+    enabled and `handleInterrupt` attached to the INT pin this is the time of
+    the data ready edge, otherwise the time the data burst started
+    @returns The `micros()` timestamp of the latest reading
 */
-uint8_t Adafruit_ICM20X::readAccelRange(void) {
-  _setBank(2);
+uint32_t Adafruit_ICM20X::getSampleMicros(void) { return sample_time_us; }
 
-  Adafruit_BusIO_Register accel_config_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_ACCEL_CONFIG_1);
-
-  Adafruit_BusIO_RegisterBits accel_range =
-      Adafruit_BusIO_RegisterBits(&accel_config_1, 2, 1);
+/**************************************************************************/
+/*!
+    @brief Get the time between samples from the faster of the accelerometer
+    and gyro, corrected for the chip's measured clock error
+    @returns The sample period in nanoseconds
+*/
+uint32_t Adafruit_ICM20X::getSamplePeriodNanos(void) {
+  uint64_t gyro_period = gyroPeriodNanos();
+  uint64_t accel_period = accelPeriodNanos();
 
-  uint8_t range = accel_range.read();
-  _setBank(0);
-  return range;
+  return (gyro_period < accel_period) ? gyro_period : accel_period;
 }
 
 /**************************************************************************/
 /*!
-
-    @brief Sets the accelerometer's measurement range.
-    @param  new_accel_range
-            Measurement range to be set. Must be an
-            `icm20x_accel_range_t`.
+    @brief Get the gyro's sample period. The rate divisor only applies while
+    the DLPF is enabled (FCHOICE set), otherwise the gyro runs at 9kHz
+    @returns The period in nanoseconds, corrected for the clock error
 */
-void Adafruit_ICM20X::writeAccelRange(uint8_t new_accel_range) {
-  _setBank(2);
+uint64_t Adafruit_ICM20X::gyroPeriodNanos(void) {
+  uint64_t period;
+  if (readConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 1, 0)) {
+    period = (1 + (uint64_t)current_gyro_divisor) * 1000000000 /
+             ICM20X_GYRO_BASE_RATE_HZ;
+  } else {
+    period = 1000000000 / ICM20X_GYRO_BYPASS_RATE_HZ;
+  }
+  return period * ICM20X_TIMEBASE_PLL_UNITY /
+         (ICM20X_TIMEBASE_PLL_UNITY + timebase_pll);
+}
 
-  Adafruit_BusIO_Register accel_config_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_ACCEL_CONFIG_1);
+/**************************************************************************/
+/*!
+    @brief Get the accelerometer's sample period. The rate divisor only
+    applies while the DLPF is enabled (FCHOICE set), otherwise the
+    accelerometer runs at 4.5kHz
+    @returns The period in nanoseconds, corrected for the clock error
+*/
+uint64_t Adafruit_ICM20X::accelPeriodNanos(void) {
+  uint64_t period;
+  if (readConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 1, 0)) {
+    period = (1 + (uint64_t)current_accel_divisor) * 1000000000 /
+             ICM20X_ACCEL_BASE_RATE_HZ;
+  } else {
+    period = 1000000000 / ICM20X_ACCEL_BYPASS_RATE_HZ;
+  }
+  return period * ICM20X_TIMEBASE_PLL_UNITY /
+         (ICM20X_TIMEBASE_PLL_UNITY + timebase_pll);
+}
 
-  Adafruit_BusIO_RegisterBits accel_range =
-      Adafruit_BusIO_RegisterBits(&accel_config_1, 2, 1);
+/**************************************************************************/
+/*!
+    @brief Find the rate divisor giving the output data rate closest to a
+    target, allowing for the chip's measured clock error
+    @param  base_hz
+            The sensor's rate with a divisor of 0
+    @param  rate_hz
+            The target rate in Hz
+    @param  max_divisor
+            The largest divisor the sensor accepts
+    @returns The divisor to use
+*/
+uint16_t Adafruit_ICM20X::nearestDivisor(uint32_t base_hz, float rate_hz,
+                                         uint16_t max_divisor) {
+  if (!(rate_hz > 0)) {
+    return max_divisor;
+  }
+  float base = (float)base_hz * (ICM20X_TIMEBASE_PLL_UNITY + timebase_pll) /
+               ICM20X_TIMEBASE_PLL_UNITY;
+
+  // rate = base / (1 + divisor), so check the divisors either side of the
+  // exact answer and keep whichever lands closer in Hz
+  float exact = base / rate_hz - 1;
+  if (exact <= 0) {
+    return 0;
+  }
+  if (exact >= max_divisor) {
+    return max_divisor;
+  }
+  uint16_t low = (uint16_t)exact;
+  float low_error = base / (1 + low) - rate_hz;
+  float high_error = rate_hz - base / (2 + low);
+  return (low_error <= high_error) ? low : low + 1;
+}
 
-  accel_range.write(new_accel_range);
-  current_accel_range = new_accel_range;
+/**************************************************************************/
+/*!
+    @brief Get the chip's factory measured sample clock error, read from
+    TIMEBASE_CORRECTION_PLL during `begin`
+    @returns The error in steps of 1/1270, positive when the clock runs fast
+*/
+int8_t Adafruit_ICM20X::getTimebaseCorrection(void) { return timebase_pll; }
 
-  _setBank(0);
+/**************************************************************************/
+/*!
+    @brief Work out when the data in the output registers was sampled
+    @param  read_us
+          `micros()` when the registers were read
+    @returns The data ready edge time if data ready interrupts are being
+    handled, otherwise `read_us`
+*/
+uint32_t Adafruit_ICM20X::sampleTime(uint32_t read_us) {
+  if (!(int_sources & ICM20X_INT_DATA_READY)) {
+    return read_us;
+  }
+
+  noInterrupts();
+  bool valid = int_edge_valid;
+  uint32_t edge_us = int_edge_us;
+  interrupts();
+  return valid ? edge_us : read_us;
 }
 
 /**************************************************************************/
 /*!
-    @brief Get the gyro's measurement range.
-    @returns The gyro's measurement range (`icm20x_gyro_range_t`).
+    @brief Convert the latest reading's timestamp to the `millis()` clock for
+    Unified Sensor events
+    @returns The `millis()` time the latest reading was taken
 */
-uint8_t Adafruit_ICM20X::readGyroRange(void) {
-  _setBank(2);
+uint32_t Adafruit_ICM20X::sampleMillis(void) {
+  return millis() - (micros() - sample_time_us) / 1000;
+}
 
-  Adafruit_BusIO_Register gyro_config_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_GYRO_CONFIG_1);
+/**************************************************************************/
+/*!
+    @brief  Read a raw sample without any floating point scaling. Pair with
+    `getFixedScale` to convert it to SI units in fixed point
+    @param  sample The sample to fill in
+    @return True on successful read
+*/
+/**************************************************************************/
+bool Adafruit_ICM20X::readRaw(icm20x_raw_sample_t *sample) {
+  if (!_readRaw(ICM20X_SENSOR_ALL)) {
+    return false;
+  }
+  fillRawSample(sample);
+  return true;
+}
 
-  Adafruit_BusIO_RegisterBits gyro_range =
-      Adafruit_BusIO_RegisterBits(&gyro_config_1, 2, 1);
+/**************************************************************************/
+/*!
+    @brief  Check whether the last reading had a new magnetometer measurement.
+    The magnetometer updates at most 100 times a second, so most readings at
+    higher rates repeat the previous one; magnetometer processing can be
+    skipped for those
+    @return `icm20x_sample_flag_t` values for the last reading
+*/
+/**************************************************************************/
+uint8_t Adafruit_ICM20X::getSampleFlags(void) { return sample_flags; }
 
-  uint8_t range = gyro_range.read();
-  _setBank(0);
-  return range;
+/**************************************************************************/
+/*!
+    @brief  Get the fixed point scale factors for the current measurement
+    ranges. They only change when a range is set, so they can be fetched once
+    and reused for every raw sample
+    @param  scale The scale factors to fill in
+*/
+/**************************************************************************/
+void Adafruit_ICM20X::getFixedScale(icm20x_fixed_scale_t *scale) {
+  *scale = fixed_scale;
+}
+/*!
+ * @brief Copy the raw values from the last `_read` into a sample
+ *
+ * @param sample The sample to fill in
+ */
+void Adafruit_ICM20X::fillRawSample(icm20x_raw_sample_t *sample) {
+  sample->accel[0] = rawAccX;
+  sample->accel[1] = rawAccY;
+  sample->accel[2] = rawAccZ;
+  sample->gyro[0] = rawGyroX;
+  sample->gyro[1] = rawGyroY;
+  sample->gyro[2] = rawGyroZ;
+  sample->temperature = rawTemp;
+  sample->mag[0] = rawMagX;
+  sample->mag[1] = rawMagY;
+  sample->mag[2] = rawMagZ;
+  sample->timestamp_us = sample_time_us;
+  sample->flags = sample_flags;
+}
+
+/*!
+ * @brief Scales the raw variables to SI units using the multipliers for the
+ * current measurement ranges
+ *
+ */
+void Adafruit_ICM20X::scaleValues(void) {
+  accX = rawAccX * accel_scale;
+  accY = rawAccY * accel_scale;
+  accZ = rawAccZ * accel_scale;
+
+  gyroX = rawGyroX * gyro_scale;
+  gyroY = rawGyroY * gyro_scale;
+  gyroZ = rawGyroZ * gyro_scale;
+
+  if (mag_updated) {
+    magX = rawMagX * mag_scale;
+    magY = rawMagY * mag_scale;
+    magZ = rawMagZ * mag_scale;
+  }
+
+  temperature = rawTemp * ICM20X_TEMP_C_PER_LSB + ICM20X_TEMP_OFFSET_C;
+}
+
+/*!
+ * @brief Looks up the scale factors for the current ranges in the chip's scale
+ * table, so scaling a sample needs no branches or divides
+ *
+ */
+void Adafruit_ICM20X::updateScales(void) {
+  if (!scale_table) {
+    return;
+  }
+  accel_scale = scale_table->accel[current_accel_range & 0x3];
+  gyro_scale = scale_table->gyro[current_gyro_range & 0x3];
+  mag_scale = scale_table->mag;
+
+  fixed_scale.accel = scale_table->accel_q[current_accel_range & 0x3];
+  fixed_scale.gyro = scale_table->gyro_q[current_gyro_range & 0x3];
+  fixed_scale.mag = scale_table->mag_q;
+  fixed_scale.temperature = ICM20X_SCALE_Q(ICM20X_TEMP_C_PER_LSB);
+}
+
+/*!
+    @brief  Gets an Adafruit Unified Sensor object for the accelerometer
+    sensor component
+    @return Adafruit_Sensor pointer to accelerometer sensor
+ */
+Adafruit_Sensor *Adafruit_ICM20X::getAccelerometerSensor(void) {
+  return &accel_sensor;
+}
+
+/*!
+    @brief  Gets an Adafruit Unified Sensor object for the gyro sensor component
+    @return Adafruit_Sensor pointer to gyro sensor
+ */
+Adafruit_Sensor *Adafruit_ICM20X::getGyroSensor(void) { return &gyro_sensor; }
+
+/*!
+    @brief  Gets an Adafruit Unified Sensor object for the magnetometer sensor
+   component
+    @return Adafruit_Sensor pointer to magnetometer sensor
+ */
+Adafruit_Sensor *Adafruit_ICM20X::getMagnetometerSensor(void) {
+  return &mag_sensor;
+}
+
+/*!
+    @brief  Gets an Adafruit Unified Sensor object for the temp sensor component
+    @return Adafruit_Sensor pointer to temperature sensor
+ */
+Adafruit_Sensor *Adafruit_ICM20X::getTemperatureSensor(void) {
+  return &temp_sensor;
+}
+/**************************************************************************/
+/*!
+    @brief Sets register bank.
+    @param  bank_number
+          The bank to set to active
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+*/
+void Adafruit_ICM20X::_setBank(uint8_t bank_number ICM20X_BUS_SITE_DEF) {
+  bank_number &= 0b11;
+  if (bank_number == current_bank) {
+    bank_writes_skipped++;
+    return;
+  }
+
+  bank_writes_issued++;
+  if (writeRegister(ICM20X_B0_REG_BANK_SEL, bank_number << 4,
+                    ICM20X_BUS_OP_BANK ICM20X_BUS_SITE_ARG)) {
+    current_bank = bank_number;
+  } else {
+    current_bank = 0xFF;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Forget the cached register bank so the next `_setBank` always
+    writes REG_BANK_SEL. Needed whenever the chip may have changed banks behind
+    our back, such as after a reset or when the bus is set up again
+*/
+void Adafruit_ICM20X::invalidateBankCache(void) { current_bank = 0xFF; }
+
+/**************************************************************************/
+/*!
+    @brief Get the number of REG_BANK_SEL writes sent to the chip
+    @returns The number of bank select writes issued
+*/
+uint32_t Adafruit_ICM20X::getBankWritesIssued(void) {
+  return bank_writes_issued;
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the number of REG_BANK_SEL writes skipped because the requested
+    bank was already active
+    @returns The number of bank select writes skipped
+*/
+uint32_t Adafruit_ICM20X::getBankWritesSkipped(void) {
+  return bank_writes_skipped;
+}
+
+/**************************************************************************/
+/*!
+    @brief Start a batch of configuration changes. Until the matching
+    `commitConfig`, setters only update the shadow register file. Batches may
+    be nested; only the outermost `commitConfig` writes to the chip
+*/
+void Adafruit_ICM20X::beginConfig(void) { config_depth++; }
+
+/**************************************************************************/
+/*!
+    @brief End a batch of configuration changes and write every changed
+    register to the chip. Registers are written bank by bank in address order,
+    with adjacent changed registers sent as a single burst
+    @returns True if every write succeeded
+*/
+bool Adafruit_ICM20X::commitConfig(void) {
+  if (config_depth > 0 && --config_depth > 0) {
+    return true;
+  }
+
+  bool success = true;
+  for (uint8_t s = 0; s < SHADOW_SPANS; s++) {
+    const shadow_span_t *span = &shadow_spans[s];
+    uint8_t i = 0;
+    while (i < span->len) {
+      uint8_t start = span->offset + i;
+      if (!testBit(shadow_dirty, start)) {
+        i++;
+        continue;
+      }
+
+      uint8_t run = 1;
+      while (i + run < span->len && testBit(shadow_dirty, start + run)) {
+        run++;
+      }
+
+      _setBank(span->bank);
+      bool written = writeRegisters(span->first + i, &shadow_regs[start], run);
+      for (uint8_t r = start; r < start + run; r++) {
+        clearBit(shadow_dirty, r);
+        if (!written) {
+          // the chip's value is unknown, read it again next time
+          clearBit(shadow_valid, r);
+        }
+      }
+      success &= written;
+      i += run;
+    }
+  }
+  return success;
+}
+
+/**************************************************************************/
+/*!
+    @brief Load the shadow register file from the chip, one burst per run of
+    registers. Any uncommitted changes are discarded
+    @returns True if every read succeeded
+*/
+bool Adafruit_ICM20X::refreshShadow(void) {
+  invalidateShadow();
+
+  bool success = true;
+  for (uint8_t s = 0; s < SHADOW_SPANS; s++) {
+    const shadow_span_t *span = &shadow_spans[s];
+    _setBank(span->bank);
+    if (!readRegisters(span->first, &shadow_regs[span->offset], span->len)) {
+      success = false;
+      continue;
+    }
+    for (uint8_t i = span->offset; i < span->offset + span->len; i++) {
+      setBit(shadow_valid, i);
+    }
+  }
+  return success;
+}
+
+/**************************************************************************/
+/*!
+    @brief Forget the shadow register file so registers are read from the chip
+    again. Needed whenever the chip may have changed them behind our back, such
+    as after a reset. Any uncommitted changes are discarded
+*/
+void Adafruit_ICM20X::invalidateShadow(void) {
+  memset(shadow_valid, 0, sizeof(shadow_valid));
+  memset(shadow_dirty, 0, sizeof(shadow_dirty));
+  config_depth = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief Read a configuration register, from the shadow register file if
+    it holds a known copy
+    @param  bank
+          The register's bank
+    @param  reg
+          The register to read
+    @returns The register value, or 0 if the bus transfer failed
+*/
+uint8_t Adafruit_ICM20X::readConfig(uint8_t bank, uint8_t reg) {
+  int8_t i = shadowIndex(bank, reg);
+  if (i >= 0 && testBit(shadow_valid, i)) {
+    return shadow_regs[i];
+  }
+
+  _setBank(bank);
+  uint8_t value;
+  if (!readRegisters(reg, &value, 1)) {
+    return 0;
+  }
+  if (i >= 0) {
+    shadow_regs[i] = value;
+    setBit(shadow_valid, i);
+  }
+  return value;
+}
+
+/**************************************************************************/
+/*!
+    @brief Write a configuration register through the shadow register file.
+    Nothing is sent if the chip already holds the value, and inside a
+    `beginConfig` batch the write is deferred to `commitConfig`
+    @param  bank
+          The register's bank
+    @param  reg
+          The register to write
+    @param  value
+          The value to write
+    @returns True on success, false if the bus transfer failed
+*/
+bool Adafruit_ICM20X::writeConfig(uint8_t bank, uint8_t reg, uint8_t value) {
+  int8_t i = shadowIndex(bank, reg);
+  if (i < 0) {
+    _setBank(bank);
+    return writeRegister(reg, value);
+  }
+
+  if (testBit(shadow_valid, i) && shadow_regs[i] == value) {
+    return true;
+  }
+  shadow_regs[i] = value;
+  setBit(shadow_valid, i);
+  setBit(shadow_dirty, i);
+
+  if (config_depth > 0) {
+    return true;
+  }
+  return commitConfig();
+}
+
+/**************************************************************************/
+/*!
+    @brief Read a bit field from a configuration register
+    @param  bank
+          The register's bank
+    @param  reg
+          The register to read
+    @param  bits
+          The width of the field in bits
+    @param  shift
+          The position of the field's lowest bit
+    @returns The field value
+*/
+uint8_t Adafruit_ICM20X::readConfigBits(uint8_t bank, uint8_t reg,
+                                        uint8_t bits, uint8_t shift) {
+  return (readConfig(bank, reg) >> shift) & ((1 << bits) - 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Update a bit field in a configuration register through the shadow
+    register file
+    @param  bank
+          The register's bank
+    @param  reg
+          The register to update
+    @param  bits
+          The width of the field in bits
+    @param  shift
+          The position of the field's lowest bit
+    @param  value
+          The new field value
+    @returns True on success, false if a bus transfer failed
+*/
+bool Adafruit_ICM20X::writeConfigBits(uint8_t bank, uint8_t reg, uint8_t bits,
+                                      uint8_t shift, uint8_t value) {
+  uint8_t mask = ((1 << bits) - 1) << shift;
+  uint8_t current = readConfig(bank, reg);
+  return writeConfig(bank, reg, (current & ~mask) | ((value << shift) & mask));
+}
+
+/**************************************************************************/
+/*!
+    @brief Read one or more consecutive registers in the current bank
+    @param  reg
+          The first register to read
+    @param  buffer
+          Where to store the register values
+    @param  len
+          The number of bytes to read
+    @param  op
+          The kind of transaction, for `getBusStats`. Data bursts use the
+          faster data SPI clock
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns True on success, false if the bus transfer failed
+*/
+bool Adafruit_ICM20X::readRegisters(uint8_t reg, uint8_t *buffer, uint8_t len,
+                                    icm20x_bus_op_t op ICM20X_BUS_SITE_DEF) {
+  Adafruit_SPIDevice *spi =
+      (op == ICM20X_BUS_OP_DATA) ? dataSPIDevice() : spi_dev;
+  Adafruit_BusIO_Register regs =
+      Adafruit_BusIO_Register(i2c_dev, spi, ADDRBIT8_HIGH_TOREAD, reg, len);
+
+#ifdef ICM20X_BUS_STATS
+  uint32_t start_us = micros();
+  bool success = regs.read(buffer, len);
+  recordBusOp(op, site, len, micros() - start_us);
+  return success;
+#else
+  return regs.read(buffer, len);
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief Write one or more consecutive registers in the current bank
+    @param  reg
+          The first register to write
+    @param  buffer
+          The register values to write
+    @param  len
+          The number of bytes to write
+    @param  op
+          The kind of transaction, for `getBusStats`
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns True on success, false if the bus transfer failed
+*/
+bool Adafruit_ICM20X::writeRegisters(uint8_t reg, const uint8_t *buffer,
+                                     uint8_t len,
+                                     icm20x_bus_op_t op ICM20X_BUS_SITE_DEF) {
+  Adafruit_SPIDevice *spi =
+      (op == ICM20X_BUS_OP_DATA) ? dataSPIDevice() : spi_dev;
+  Adafruit_BusIO_Register regs =
+      Adafruit_BusIO_Register(i2c_dev, spi, ADDRBIT8_HIGH_TOREAD, reg, len);
+
+#ifdef ICM20X_BUS_STATS
+  uint32_t start_us = micros();
+  bool success = regs.write((uint8_t *)buffer, len);
+  recordBusOp(op, site, len, micros() - start_us);
+  return success;
+#else
+  return regs.write((uint8_t *)buffer, len);
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief Read a single register in the current bank
+    @param  reg
+          The register to read
+    @param  op
+          The kind of transaction, for `getBusStats`
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns The register value, or 0 if the bus transfer failed
+*/
+uint8_t Adafruit_ICM20X::readRegister(uint8_t reg,
+                                      icm20x_bus_op_t op ICM20X_BUS_SITE_DEF) {
+  uint8_t value = 0;
+  if (!readRegisters(reg, &value, 1, op ICM20X_BUS_SITE_ARG)) {
+    return 0;
+  }
+  return value;
+}
+
+/**************************************************************************/
+/*!
+    @brief Write a single register in the current bank
+    @param  reg
+          The register to write
+    @param  value
+          The value to write
+    @param  op
+          The kind of transaction, for `getBusStats`
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns True on success, false if the bus transfer failed
+*/
+bool Adafruit_ICM20X::writeRegister(uint8_t reg, uint8_t value,
+                                    icm20x_bus_op_t op ICM20X_BUS_SITE_DEF) {
+  return writeRegisters(reg, &value, 1, op ICM20X_BUS_SITE_ARG);
+}
+
+/**************************************************************************/
+/*!
+    @brief Read a bit field from a register in the current bank
+    @param  reg
+          The register to read
+    @param  bits
+          The width of the field in bits
+    @param  shift
+          The position of the field's lowest bit
+    @param  op
+          The kind of transaction, for `getBusStats`
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns The field value, or 0 if the bus transfer failed
+*/
+uint8_t Adafruit_ICM20X::readRegisterBits(uint8_t reg, uint8_t bits,
+                                          uint8_t shift,
+                                          icm20x_bus_op_t op
+                                              ICM20X_BUS_SITE_DEF) {
+  return (readRegister(reg, op ICM20X_BUS_SITE_ARG) >> shift) &
+         ((1 << bits) - 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Read-modify-write a bit field in a register in the current bank
+    @param  reg
+          The register to update
+    @param  bits
+          The width of the field in bits
+    @param  shift
+          The position of the field's lowest bit
+    @param  value
+          The new field value
+    @param  op
+          The kind of transaction, for `getBusStats`
+    @param  site
+          With `ICM20X_BUS_STATS`, the calling function, filled in by the
+          compiler
+    @returns True on success, false if either bus transfer failed
+*/
+bool Adafruit_ICM20X::writeRegisterBits(uint8_t reg, uint8_t bits,
+                                        uint8_t shift, uint8_t value,
+                                        icm20x_bus_op_t op
+                                            ICM20X_BUS_SITE_DEF) {
+  uint8_t current;
+  if (!readRegisters(reg, &current, 1, op ICM20X_BUS_SITE_ARG)) {
+    return false;
+  }
+
+  uint8_t mask = ((1 << bits) - 1) << shift;
+  current = (current & ~mask) | ((value << shift) & mask);
+  return writeRegister(reg, current, op ICM20X_BUS_SITE_ARG);
+}
+
+/**************************************************************************/
+/*!
+    @brief Get a copy of the bus statistics collected since the last
+    `resetBusStats`. Only available when `ICM20X_BUS_STATS` is defined in
+    Adafruit_ICM20X.h
+    @param  stats
+          Where to store the statistics. Zeroed if stats are not compiled in
+    @returns True if stats are compiled in, false otherwise
+*/
+bool Adafruit_ICM20X::getBusStats(icm20x_bus_stats_t *stats) {
+#ifdef ICM20X_BUS_STATS
+  *stats = bus_stats;
+  return true;
+#else
+  memset(stats, 0, sizeof(icm20x_bus_stats_t));
+  return false;
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief Clear the bus statistics
+*/
+void Adafruit_ICM20X::resetBusStats(void) {
+#ifdef ICM20X_BUS_STATS
+  for (uint8_t i = 0; i < ICM20X_BUS_OP_COUNT; i++) {
+    bus_stats.op[i].transactions = 0;
+    bus_stats.op[i].bytes = 0;
+    bus_stats.op[i].total_us = 0;
+    bus_stats.op[i].min_us = 0xFFFFFFFF;
+    bus_stats.op[i].max_us = 0;
+  }
+  memset(bus_stats.site, 0, sizeof(bus_stats.site));
+  bus_stats.untracked = 0;
+#endif
+}
+
+/**************************************************************************/
+/*!
+    @brief Print a table of the bus statistics, one line per op kind with the
+    transaction and byte counts and the min, average and max time in us, then
+    one line per calling function with its counts and average time
+    @param  out
+          Where to print the table
+*/
+void Adafruit_ICM20X::printBusStats(Print *out) {
+  static const char *const op_names[ICM20X_BUS_OP_COUNT] = {"bank", "data",
+                                                            "aux", "config"};
+  icm20x_bus_stats_t stats;
+  if (!getBusStats(&stats)) {
+    out->println(F("ICM20X_BUS_STATS is not enabled"));
+    return;
+  }
+
+  out->println(F("op\ttxns\tbytes\tmin_us\tavg_us\tmax_us"));
+  for (uint8_t i = 0; i < ICM20X_BUS_OP_COUNT; i++) {
+    icm20x_bus_op_stats_t *op = &stats.op[i];
+    out->print(op_names[i]);
+    out->print('\t');
+    out->print(op->transactions);
+    out->print('\t');
+    out->print(op->bytes);
+    out->print('\t');
+    out->print(op->transactions ? op->min_us : 0);
+    out->print('\t');
+    out->print(op->transactions ? op->total_us / op->transactions : 0);
+    out->print('\t');
+    out->println(op->max_us);
+  }
+
+  out->println(F("site\ttxns\tbytes\tavg_us"));
+  for (uint8_t i = 0; i < ICM20X_BUS_STATS_SITES && stats.site[i].site; i++) {
+    icm20x_bus_site_stats_t *site = &stats.site[i];
+    out->print(site->site);
+    out->print('\t');
+    out->print(site->transactions);
+    out->print('\t');
+    out->print(site->bytes);
+    out->print('\t');
+    out->println(site->total_us / site->transactions);
+  }
+  if (stats.untracked) {
+    out->print(F("untracked\t"));
+    out->println(stats.untracked);
+  }
+}
+
+#ifdef ICM20X_BUS_STATS
+/**************************************************************************/
+/*!
+    @brief Add one transaction to the bus statistics
+    @param  op
+          The kind of transaction
+    @param  site
+          The driver function that issued it
+    @param  bytes
+          The number of register bytes moved
+    @param  elapsed_us
+          How long the transaction took
+*/
+void Adafruit_ICM20X::recordBusOp(icm20x_bus_op_t op, const char *site,
+                                  uint8_t bytes, uint32_t elapsed_us) {
+  icm20x_bus_op_stats_t *stats = &bus_stats.op[op];
+  stats->transactions++;
+  stats->bytes += bytes;
+  stats->total_us += elapsed_us;
+  if (elapsed_us < stats->min_us) {
+    stats->min_us = elapsed_us;
+  }
+  if (elapsed_us > stats->max_us) {
+    stats->max_us = elapsed_us;
+  }
+
+  // the same name can be a different pointer in another translation unit
+  for (uint8_t i = 0; i < ICM20X_BUS_STATS_SITES; i++) {
+    icm20x_bus_site_stats_t *entry = &bus_stats.site[i];
+    if (!entry->site) {
+      entry->site = site;
+    } else if (entry->site != site && strcmp(entry->site, site)) {
+      continue;
+    }
+    entry->transactions++;
+    entry->bytes += bytes;
+    entry->total_us += elapsed_us;
+    return;
+  }
+  bus_stats.untracked++;
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief Get the accelerometer's measurement range.
+    @returns The accelerometer's measurement range (`icm20x_accel_range_t`).
+*/
+uint8_t Adafruit_ICM20X::readAccelRange(void) {
+  return readConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 2, 1);
+}
+
+/**************************************************************************/
+/*!
+
+    @brief Sets the accelerometer's measurement range.
+    @param  new_accel_range
+            Measurement range to be set. Must be an
+            `icm20x_accel_range_t`.
+*/
+void Adafruit_ICM20X::writeAccelRange(uint8_t new_accel_range) {
+  writeConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 2, 1, new_accel_range);
+  current_accel_range = new_accel_range;
+  updateScales();
+  snapshot_valid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the gyro's measurement range.
+    @returns The gyro's measurement range (`icm20x_gyro_range_t`).
+*/
+uint8_t Adafruit_ICM20X::readGyroRange(void) {
+  return readConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 2, 1);
 }
 
 /**************************************************************************/
@@ -569,17 +1873,10 @@ uint8_t Adafruit_ICM20X::readGyroRange(void) {
             `icm20x_gyro_range_t`.
 */
 void Adafruit_ICM20X::writeGyroRange(uint8_t new_gyro_range) {
-  _setBank(2);
-
-  Adafruit_BusIO_Register gyro_config_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_GYRO_CONFIG_1);
-
-  Adafruit_BusIO_RegisterBits gyro_range =
-      Adafruit_BusIO_RegisterBits(&gyro_config_1, 2, 1);
-
-  gyro_range.write(new_gyro_range);
+  writeConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 2, 1, new_gyro_range);
   current_gyro_range = new_gyro_range;
-  _setBank(0);
+  updateScales();
+  snapshot_valid = false;
 }
 
 /**************************************************************************/
@@ -588,16 +1885,8 @@ void Adafruit_ICM20X::writeGyroRange(uint8_t new_gyro_range) {
     @returns The accelerometer's data rate divisor (`uint8_t`).
 */
 uint16_t Adafruit_ICM20X::getAccelRateDivisor(void) {
-  _setBank(2);
-
-  Adafruit_BusIO_Register accel_rate_divisor =
-      Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD,
-                              ICM20X_B2_ACCEL_SMPLRT_DIV_1, 2, MSBFIRST);
-
-  uint16_t divisor_val = accel_rate_divisor.read();
-
-  _setBank(0);
-  return divisor_val;
+  return readConfig(2, ICM20X_B2_ACCEL_SMPLRT_DIV_1) << 8 |
+         readConfig(2, ICM20X_B2_ACCEL_SMPLRT_DIV_2);
 }
 
 /**************************************************************************/
@@ -609,14 +1898,11 @@ uint16_t Adafruit_ICM20X::getAccelRateDivisor(void) {
    value must be <= 4095
 */
 void Adafruit_ICM20X::setAccelRateDivisor(uint16_t new_accel_divisor) {
-  _setBank(2);
-
-  Adafruit_BusIO_Register accel_rate_divisor =
-      Adafruit_BusIO_Register(i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD,
-                              ICM20X_B2_ACCEL_SMPLRT_DIV_1, 2, MSBFIRST);
-
-  accel_rate_divisor.write(new_accel_divisor);
-  _setBank(0);
+  beginConfig();
+  writeConfig(2, ICM20X_B2_ACCEL_SMPLRT_DIV_1, new_accel_divisor >> 8);
+  writeConfig(2, ICM20X_B2_ACCEL_SMPLRT_DIV_2, new_accel_divisor & 0xFF);
+  commitConfig();
+  current_accel_divisor = new_accel_divisor;
 }
 
 /**************************************************************************/
@@ -625,15 +1911,7 @@ void Adafruit_ICM20X::setAccelRateDivisor(uint16_t new_accel_divisor) {
     @returns The gyro's data rate divisor (`uint8_t`).
 */
 uint8_t Adafruit_ICM20X::getGyroRateDivisor(void) {
-  _setBank(2);
-
-  Adafruit_BusIO_Register gyro_rate_divisor = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_GYRO_SMPLRT_DIV, 1);
-
-  uint8_t divisor_val = gyro_rate_divisor.read();
-
-  _setBank(0);
-  return divisor_val;
+  return readConfig(2, ICM20X_B2_GYRO_SMPLRT_DIV);
 }
 
 /**************************************************************************/
@@ -644,127 +1922,408 @@ uint8_t Adafruit_ICM20X::getGyroRateDivisor(void) {
             The gyro's data rate divisor (`uint8_t`).
 */
 void Adafruit_ICM20X::setGyroRateDivisor(uint8_t new_gyro_divisor) {
-  _setBank(2);
+  writeConfig(2, ICM20X_B2_GYRO_SMPLRT_DIV, new_gyro_divisor);
+  current_gyro_divisor = new_gyro_divisor;
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the gyro's output data rate, from the rate divisor and DLPF
+    setting and corrected for the chip's measured clock error
+    @returns The gyro's data rate in Hz
+*/
+float Adafruit_ICM20X::getGyroDataRate(void) {
+  return 1e9 / gyroPeriodNanos();
+}
+
+/**************************************************************************/
+/*!
+    @brief Set the gyro's output data rate to the one closest to a target the
+    rate divisor can give. With the DLPF disabled the divisor is still
+    stored but the gyro keeps running at 9kHz until it is enabled again
+    @param  rate_hz
+            The target rate, from 1100Hz down to about 4.3Hz
+    @returns The data rate actually set, in Hz
+*/
+float Adafruit_ICM20X::setGyroDataRate(float rate_hz) {
+  setGyroRateDivisor(nearestDivisor(ICM20X_GYRO_BASE_RATE_HZ, rate_hz,
+                                    ICM20X_GYRO_MAX_DIVISOR));
+  return getGyroDataRate();
+}
+
+/**************************************************************************/
+/*!
+    @brief Get the accelerometer's output data rate, from the rate divisor
+    and DLPF setting and corrected for the chip's measured clock error
+    @returns The accelerometer's data rate in Hz
+*/
+float Adafruit_ICM20X::getAccelDataRate(void) {
+  return 1e9 / accelPeriodNanos();
+}
 
-  Adafruit_BusIO_Register gyro_rate_divisor = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_GYRO_SMPLRT_DIV, 1);
+/**************************************************************************/
+/*!
+    @brief Set the accelerometer's output data rate to the one closest to a
+    target the rate divisor can give. With the DLPF disabled the divisor is
+    still stored but the accelerometer keeps running at 4.5kHz until it is
+    enabled again
+    @param  rate_hz
+            The target rate, from 1125Hz down to about 0.27Hz
+    @returns The data rate actually set, in Hz
+*/
+float Adafruit_ICM20X::setAccelDataRate(float rate_hz) {
+  setAccelRateDivisor(nearestDivisor(ICM20X_ACCEL_BASE_RATE_HZ, rate_hz,
+                                     ICM20X_ACCEL_MAX_DIVISOR));
+  return getAccelDataRate();
+}
+
+/**************************************************************************/
+/*!
+ * @brief Enable or disable the accelerometer's Digital Low Pass Filter
+ *
+ * @param enable true: enable false: disable
+ * @param cutoff_freq Signals changing at a rate higher than the given cutoff
+ * frequency will be filtered out
+ * @return true: success false: failure
+ */
+bool Adafruit_ICM20X::enableAccelDLPF(bool enable,
+                                      icm20x_accel_cutoff_t cutoff_freq) {
+  beginConfig();
+  writeConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 1, 0, enable);
+  if (enable) {
+    writeConfigBits(2, ICM20X_B2_ACCEL_CONFIG_1, 3, 3, cutoff_freq);
+  }
+  return commitConfig();
+}
 
-  gyro_rate_divisor.write(new_gyro_divisor);
+/**************************************************************************/
+/*!
+ * @brief Enable or disable the gyro's Digital Low Pass Filter
+ *
+ * @param enable true: enable false: disable
+ * @param cutoff_freq Signals changing at a rate higher than the given cutoff
+ * frequency will be filtered out
+ * @return true: success false: failure
+ */
+bool Adafruit_ICM20X::enableGyrolDLPF(bool enable,
+                                      icm20x_gyro_cutoff_t cutoff_freq) {
+  beginConfig();
+  writeConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 1, 0, enable);
+  if (enable) {
+    writeConfigBits(2, ICM20X_B2_GYRO_CONFIG_1, 3, 3, cutoff_freq);
+  }
+  return commitConfig();
+}
+
+/**************************************************************************/
+/*!
+ * @brief Sets the polarity of the int1 pin
+ *
+ * @param active_low Set to true to make INT1 active low, false to make it
+ * active high
+ */
+void Adafruit_ICM20X::setInt1ActiveLow(bool active_low) {
+  // open drain, then polarity
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_REG_INT_PIN_CFG, 1, 6, true);
+  writeConfigBits(0, ICM20X_B0_REG_INT_PIN_CFG, 1, 7, active_low);
+  commitConfig();
+}
+/*!
+ * @brief Sets the polarity of the INT2 pin
+ *
+ * @param active_low Set to true to make INT1 active low, false to make it
+ * active high
+ */
+void Adafruit_ICM20X::setInt2ActiveLow(bool active_low) {
+  // open drain, then polarity
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_REG_INT_ENABLE_1, 1, 6, true);
+  writeConfigBits(0, ICM20X_B0_REG_INT_ENABLE_1, 1, 7, active_low);
+  commitConfig();
+}
+
+/**************************************************************************/
+/*!
+ * @brief Choose which interrupt sources drive the INT1 pin. Use together with
+ * `handleInterrupt` and `serviceInterrupts` to read data only when there is
+ * some instead of polling
+ *
+ * @param sources A combination of `icm20x_int_source_t` values, or 0 to
+ * disable all of them
+ * @return true: success false: failure
+ */
+bool Adafruit_ICM20X::enableInterrupts(uint8_t sources) {
+  int_sources = sources;
+  int_edge_valid = false;
+
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_REG_INT_ENABLE_1, 1, 0,
+                  sources & ICM20X_INT_DATA_READY);
+  writeConfig(0, ICM20X_B0_REG_INT_ENABLE_2,
+              (sources & ICM20X_INT_FIFO_OVERFLOW) ? 0x1F : 0);
+  writeConfig(0, ICM20X_B0_REG_INT_ENABLE_3,
+              (sources & ICM20X_INT_FIFO_WATERMARK) ? 0x1F : 0);
+  writeConfigBits(0, ICM20X_B0_REG_INT_ENABLE, 1, 3,
+                  (sources & ICM20X_INT_WAKE_ON_MOTION) ? 1 : 0);
+  return commitConfig();
+}
+
+/**************************************************************************/
+/*!
+ * @brief Read and clear the interrupt status. If the FIFO overflowed it is
+ * reset, since its frames are no longer aligned
+ *
+ * @return A combination of the `icm20x_int_source_t` values that fired
+ */
+uint8_t Adafruit_ICM20X::getInterruptStatus(void) {
   _setBank(0);
+
+  uint8_t buffer[4];
+  if (!readRegisters(ICM20X_B0_INT_STATUS, buffer, 4)) {
+    return 0;
+  }
+
+  uint8_t sources = 0;
+  if (buffer[0] & 0x08) {
+    sources |= ICM20X_INT_WAKE_ON_MOTION;
+  }
+  if (buffer[1] & 0x01) {
+    sources |= ICM20X_INT_DATA_READY;
+  }
+  if (buffer[2] & 0x1F) {
+    sources |= ICM20X_INT_FIFO_OVERFLOW;
+    if (fifo_frame_size) {
+      fifo_overflows++;
+      resetFIFO();
+    }
+  }
+  if (buffer[3] & 0x1F) {
+    sources |= ICM20X_INT_FIFO_WATERMARK;
+  }
+  return sources;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Set a function for `handleInterrupt` to call. It runs in interrupt
+ * context, so it should only set a flag or wake a task
+ *
+ * @param callback The function to call, or NULL for none
+ */
+void Adafruit_ICM20X::setInterruptCallback(void (*callback)(void)) {
+  int_callback = callback;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Record an interrupt from the INT1 pin. Safe to call from an ISR
+ * since it does not touch the bus; attach it with a small wrapper, i.e.
+ * `void isr(void) { icm.handleInterrupt(); }`
+ */
+void Adafruit_ICM20X::handleInterrupt(void) {
+  int_edge_us = micros();
+  int_edge_valid = true;
+  int_count = int_count + 1;
+  if (int_callback) {
+    int_callback();
+  }
 }
 
 /**************************************************************************/
 /*!
- * @brief Enable or disable the accelerometer's Digital Low Pass Filter
+ * @brief Check if an interrupt arrived since the last `serviceInterrupts`
  *
- * @param enable true: enable false: disable
- * @param cutoff_freq Signals changing at a rate higher than the given cutoff
- * frequency will be filtered out
- * @return true: success false: failure
+ * @return true if there is data to fetch
  */
-bool Adafruit_ICM20X::enableAccelDLPF(bool enable,
-                                      icm20x_accel_cutoff_t cutoff_freq) {
-  _setBank(2);
-  Adafruit_BusIO_Register accel_config1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_ACCEL_CONFIG_1);
+bool Adafruit_ICM20X::interruptPending(void) {
+  return int_count != int_serviced;
+}
 
-  Adafruit_BusIO_RegisterBits dlpf_enable =
-      Adafruit_BusIO_RegisterBits(&accel_config1, 1, 0);
-  if (!dlpf_enable.write(enable)) {
-    return false;
+/**************************************************************************/
+/*!
+ * @brief Fetch the data announced by `handleInterrupt` into a sample ring.
+ * Drains the FIFO if it is enabled, otherwise reads the latest sample. Call
+ * from the loop or a task, not from the ISR. The ring is safe to pop from in
+ * one context while this pushes in another
+ *
+ * @param ring The ring to add samples to
+ * @return The number of samples added
+ */
+uint16_t Adafruit_ICM20X::serviceInterrupts(Adafruit_ICM20X_SampleRing *ring) {
+  uint8_t count = int_count;
+  if (count == int_serviced) {
+    return 0;
   }
+  int_serviced = count;
 
-  if (!enable) {
-    return true;
+  if (fifo_frame_size) {
+    return readFIFO(ring);
   }
 
-  Adafruit_BusIO_RegisterBits dlpf_config =
-      Adafruit_BusIO_RegisterBits(&accel_config1, 3, 3);
-
-  if (!dlpf_config.write(cutoff_freq)) {
-    return false;
+  icm20x_raw_sample_t sample;
+  if (!_readRaw(ICM20X_SENSOR_ALL)) {
+    return 0;
   }
-  return true;
+  fillRawSample(&sample);
+  return ring->push(&sample) ? 1 : 0;
 }
 
 /**************************************************************************/
 /*!
- * @brief Enable or disable the gyro's Digital Low Pass Filter
+ * @brief Power sensors up or down. Powered down sensors use no current and
+ * are left out of the data burst, so reads get shorter too
  *
- * @param enable true: enable false: disable
- * @param cutoff_freq Signals changing at a rate higher than the given cutoff
- * frequency will be filtered out
+ * @param sensors A combination of `icm20x_sensor_t` values for the sensors to
+ * keep powered. `ICM20X_SENSOR_MAG` is ignored on chips without one
  * @return true: success false: failure
  */
-bool Adafruit_ICM20X::enableGyrolDLPF(bool enable,
-                                      icm20x_gyro_cutoff_t cutoff_freq) {
-  _setBank(2);
-  Adafruit_BusIO_Register gyro_config1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B2_ACCEL_CONFIG_1);
-
-  Adafruit_BusIO_RegisterBits dlpf_enable =
-      Adafruit_BusIO_RegisterBits(&gyro_config1, 1, 0);
-  if (!dlpf_enable.write(enable)) {
-    return false;
+bool Adafruit_ICM20X::setPoweredSensors(uint8_t sensors) {
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_2, 3, 3,
+                  (sensors & ICM20X_SENSOR_ACCEL) ? 0 : 0x7);
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_2, 3, 0,
+                  (sensors & ICM20X_SENSOR_GYRO) ? 0 : 0x7);
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 3,
+                  !(sensors & ICM20X_SENSOR_TEMP));
+  bool success = commitConfig();
+
+  bool mag = sensors & ICM20X_SENSOR_MAG;
+  if (mag != (bool)(getPoweredSensors() & ICM20X_SENSOR_MAG)) {
+    success &= powerMag(mag);
   }
+  return success;
+}
 
-  if (!enable) {
-    return true;
+/**************************************************************************/
+/*!
+ * @brief Check which sensors are powered, from the shadow register file so
+ * there is usually no bus traffic
+ *
+ * @return A combination of `icm20x_sensor_t` values
+ */
+uint8_t Adafruit_ICM20X::getPoweredSensors(void) {
+  uint8_t sensors = 0;
+  if (readConfigBits(0, ICM20X_B0_PWR_MGMT_2, 3, 3) != 0x7) {
+    sensors |= ICM20X_SENSOR_ACCEL;
   }
-
-  Adafruit_BusIO_RegisterBits dlpf_config =
-      Adafruit_BusIO_RegisterBits(&gyro_config1, 3, 3);
-
-  if (!dlpf_config.write(cutoff_freq)) {
-    return false;
+  if (readConfigBits(0, ICM20X_B0_PWR_MGMT_2, 3, 0) != 0x7) {
+    sensors |= ICM20X_SENSOR_GYRO;
   }
-  return true;
+  if (!readConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 3)) {
+    sensors |= ICM20X_SENSOR_TEMP;
+  }
+  // the magnetometer is read when slave 0 is proxying it
+  if (readConfigBits(0, ICM20X_B0_USER_CTRL, 1, 5) &&
+      readConfigBits(3, ICM20X_B3_I2C_SLV0_CTRL, 1, 7)) {
+    sensors |= ICM20X_SENSOR_MAG;
+  }
+  return sensors;
 }
 
 /**************************************************************************/
 /*!
- * @brief Sets the polarity of the int1 pin
+ * @brief Power the magnetometer up or down. Chips without one have nothing
+ * to do
  *
- * @param active_low Set to true to make INT1 active low, false to make it
- * active high
+ * @param enable true: power up false: power down
+ * @return true: success false: failure
  */
-void Adafruit_ICM20X::setInt1ActiveLow(bool active_low) {
-
-  _setBank(0);
-
-  Adafruit_BusIO_Register int_pin_cfg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_REG_INT_PIN_CFG);
-
-  Adafruit_BusIO_RegisterBits int1_polarity =
-      Adafruit_BusIO_RegisterBits(&int_pin_cfg, 1, 7);
+bool Adafruit_ICM20X::powerMag(bool enable) {
+  (void)enable;
+  return true;
+}
 
-  Adafruit_BusIO_RegisterBits int1_open_drain =
-      Adafruit_BusIO_RegisterBits(&int_pin_cfg, 1, 6);
+/**************************************************************************/
+/*!
+ * @brief Check if a firmware running on the chip writes to the FIFO, so the
+ * raw sample FIFO can't be used. Chips without a DMP driver never do
+ *
+ * @return true if `enableFIFO` and `readFIFO` must leave the FIFO alone
+ */
+bool Adafruit_ICM20X::dmpOwnsFIFO(void) { return false; }
 
-  int1_open_drain.write(true);
-  int1_polarity.write(active_low);
+/**************************************************************************/
+/*!
+ * @brief Duty cycle the accelerometer and gyro instead of running them
+ * continuously. They wake once per sample at the rates set with
+ * `setAccelDataRate` and `setGyroDataRate`, so lower rates save more power.
+ * Together with `setPoweredSensors(ICM20X_SENSOR_ACCEL)` this gives the
+ * lowest power accelerometer only mode
+ *
+ * @param enable true: duty cycle false: run continuously
+ * @return true: success false: failure
+ */
+bool Adafruit_ICM20X::enableLowPower(bool enable) {
+  beginConfig();
+  writeConfigBits(0, ICM20X_B0_LP_CONFIG, 1, 5, enable);  // ACCEL_CYCLE
+  writeConfigBits(0, ICM20X_B0_LP_CONFIG, 1, 4, enable);  // GYRO_CYCLE
+  writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 5, enable); // LP_EN
+  return commitConfig();
 }
+
+/**************************************************************************/
 /*!
- * @brief Sets the polarity of the INT2 pin
+ * @brief Check if the sensors are duty cycled by `enableLowPower`
  *
- * @param active_low Set to true to make INT1 active low, false to make it
- * active high
+ * @return true: low power mode is on
  */
-void Adafruit_ICM20X::setInt2ActiveLow(bool active_low) {
+bool Adafruit_ICM20X::isLowPowerEnabled(void) {
+  return readConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 5);
+}
 
-  _setBank(0);
+/**************************************************************************/
+/*!
+ * @brief Put the whole chip to sleep or wake it up. Asleep, nothing is
+ * measured and wake on motion does not work; use `enableLowPower` to save
+ * power while still watching for motion
+ *
+ * @param sleep true: sleep false: wake up
+ * @return true: success false: failure
+ */
+bool Adafruit_ICM20X::setSleep(bool sleep) {
+  return writeConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 6, sleep);
+}
 
-  Adafruit_BusIO_Register int_enable_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_REG_INT_ENABLE_1);
+/**************************************************************************/
+/*!
+ * @brief Check if the chip is asleep
+ *
+ * @return true: asleep
+ */
+bool Adafruit_ICM20X::isSleeping(void) {
+  return readConfigBits(0, ICM20X_B0_PWR_MGMT_1, 1, 6);
+}
 
-  Adafruit_BusIO_RegisterBits int2_polarity =
-      Adafruit_BusIO_RegisterBits(&int_enable_1, 1, 7);
+/**************************************************************************/
+/*!
+ * @brief Raise `ICM20X_INT_WAKE_ON_MOTION` on INT1 when the acceleration on
+ * any axis changes by more than a threshold between samples. The
+ * accelerometer must be powered; combine with `enableLowPower` and a low
+ * accelerometer data rate to watch for motion on a few microamps
+ *
+ * @param enable true: watch for motion false: stop
+ * @param threshold_mg The change that counts as motion, in milli-g. Steps of
+ * `ICM20X_WOM_MG_PER_LSB`, up to 1020
+ * @return true: success false: failure, or the accelerometer is powered down
+ */
+bool Adafruit_ICM20X::enableWakeOnMotion(bool enable, uint16_t threshold_mg) {
+  if (enable && !(getPoweredSensors() & ICM20X_SENSOR_ACCEL)) {
+    return false;
+  }
 
-  Adafruit_BusIO_RegisterBits int2_open_drain =
-      Adafruit_BusIO_RegisterBits(&int_enable_1, 1, 6);
+  uint16_t threshold = threshold_mg / ICM20X_WOM_MG_PER_LSB;
+  if (threshold > 0xFF) {
+    threshold = 0xFF;
+  }
 
-  int2_open_drain.write(true);
-  int2_polarity.write(active_low);
+  beginConfig();
+  writeConfig(2, ICM20X_B2_ACCEL_WOM_THR, threshold);
+  // enable, comparing each sample with the one before
+  writeConfigBits(2, ICM20X_B2_ACCEL_INTEL_CTRL, 2, 0, enable ? 0x3 : 0);
+  enableInterrupts(enable ? (int_sources | ICM20X_INT_WAKE_ON_MOTION)
+                          : (int_sources & ~ICM20X_INT_WAKE_ON_MOTION));
+  return commitConfig();
 }
 
 /**************************************************************************/
@@ -776,15 +2335,7 @@ void Adafruit_ICM20X::setInt2ActiveLow(bool active_low) {
  * re-connect
  */
 void Adafruit_ICM20X::setI2CBypass(bool bypass_i2c) {
-  _setBank(0);
-
-  Adafruit_BusIO_Register int_enable_1 = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_REG_INT_PIN_CFG);
-
-  Adafruit_BusIO_RegisterBits i2c_bypass_enable =
-      Adafruit_BusIO_RegisterBits(&int_enable_1, 1, 1);
-
-  i2c_bypass_enable.write(bypass_i2c);
+  writeConfigBits(0, ICM20X_B0_REG_INT_PIN_CFG, 1, 1, bypass_i2c);
 }
 
 /**************************************************************************/
@@ -796,13 +2347,7 @@ void Adafruit_ICM20X::setI2CBypass(bool bypass_i2c) {
  * @return true: success false: error
  */
 bool Adafruit_ICM20X::enableI2CMaster(bool enable_i2c_master) {
-  _setBank(0);
-  Adafruit_BusIO_Register user_ctrl_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_USER_CTRL);
-
-  Adafruit_BusIO_RegisterBits i2c_master_enable_bit =
-      Adafruit_BusIO_RegisterBits(&user_ctrl_reg, 1, 5);
-  return i2c_master_enable_bit.write(enable_i2c_master);
+  return writeConfigBits(0, ICM20X_B0_USER_CTRL, 1, 5, enable_i2c_master);
 }
 
 // TODO: add params
@@ -814,12 +2359,7 @@ bool Adafruit_ICM20X::enableI2CMaster(bool enable_i2c_master) {
  * @return true: success false: failure
  */
 bool Adafruit_ICM20X::configureI2CMaster(void) {
-
-  _setBank(3);
-  Adafruit_BusIO_Register i2c_master_ctrl_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_MST_CTRL);
-
-  return i2c_master_ctrl_reg.write(0x17);
+  return writeConfig(3, ICM20X_B3_I2C_MST_CTRL, 0x17);
 }
 
 /**************************************************************************/
@@ -856,101 +2396,310 @@ bool Adafruit_ICM20X::writeExternalRegister(uint8_t slv_addr, uint8_t reg_addr,
 
 /**************************************************************************/
 /*!
- * @brief Write a single byte to a given register address for an I2C slave
- * device on the auxiliary I2C bus
+ * @brief Run a single byte transaction on the auxiliary I2C bus, blocking
+ * until it finishes. Anything already queued is finished first
  *
+ * @param read true to read, false to write
  * @param slv_addr the 7-bit I2C address of the slave device
- * @param reg_addr the register address to write to
+ * @param reg_addr the register address to read or write
  * @param value the value to write
- * @return true
- * @return false
+ * @return the register value for reads, true for successful writes, false on
+ * failure
  */
 uint8_t Adafruit_ICM20X::auxillaryRegisterTransaction(bool read,
                                                       uint8_t slv_addr,
                                                       uint8_t reg_addr,
                                                       uint8_t value) {
 
-  _setBank(3);
+  finishAuxTransactions();
+  if (!queueAuxOp(read ? AUX_OP_READ : AUX_OP_WRITE, slv_addr, reg_addr, value,
+                  0)) {
+    return (uint8_t) false;
+  }
+  if (!finishAuxTransactions()) {
+    return (uint8_t) false;
+  }
+  return read ? aux_read_value : (uint8_t) true;
+}
 
-  Adafruit_BusIO_Register *slv4_di_reg;
+/**************************************************************************/
+/*!
+ * @brief Reset the I2C master, blocking until it has settled
+ *
+ */
+void Adafruit_ICM20X::resetI2CMaster(void) {
+  finishAuxTransactions();
+  queueI2CMasterReset();
+  finishAuxTransactions();
+}
 
-  Adafruit_BusIO_Register *slv4_do_reg;
-  Adafruit_BusIO_Register slv4_addr_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_SLV4_ADDR);
+/**************************************************************************/
+/*!
+ * @brief Queue a single byte read from a device on the auxiliary I2C bus.
+ * Call `serviceAuxTransactions` to make progress; the value is available from
+ * `getExternalReadValue` or the aux callback once it finishes
+ *
+ * @param slv_addr the 7-bit I2C address of the slave device
+ * @param reg_addr the register address to read from
+ * @return true: queued false: the queue is full
+ */
+bool Adafruit_ICM20X::queueExternalRead(uint8_t slv_addr, uint8_t reg_addr) {
+  return queueAuxOp(AUX_OP_READ, slv_addr, reg_addr, 0, 0);
+}
 
-  Adafruit_BusIO_Register slv4_reg_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_SLV4_REG);
+/**************************************************************************/
+/*!
+ * @brief Queue a single byte write to a device on the auxiliary I2C bus.
+ * Call `serviceAuxTransactions` to make progress
+ *
+ * @param slv_addr the 7-bit I2C address of the slave device
+ * @param reg_addr the register address to write to
+ * @param value the value to write
+ * @return true: queued false: the queue is full
+ */
+bool Adafruit_ICM20X::queueExternalWrite(uint8_t slv_addr, uint8_t reg_addr,
+                                         uint8_t value) {
+  return queueAuxOp(AUX_OP_WRITE, slv_addr, reg_addr, value, 0);
+}
 
-  Adafruit_BusIO_Register slv4_ctrl_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_SLV4_CTRL);
+/**************************************************************************/
+/*!
+ * @brief Queue a pause between auxiliary I2C operations, for devices that
+ * need time between writes. No bus traffic is generated while waiting
+ *
+ * @param delay_us how long to wait in microseconds
+ * @return true: queued false: the queue is full
+ */
+bool Adafruit_ICM20X::queueAuxDelay(uint32_t delay_us) {
+  return queueAuxOp(AUX_OP_DELAY, 0, 0, 0, delay_us);
+}
 
-  Adafruit_BusIO_Register i2c_master_status_reg = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_I2C_MST_STATUS);
+/**************************************************************************/
+/*!
+ * @brief Queue a reset of the I2C master, followed by
+ * `ICM20X_AUX_RESET_SETTLE_US` for it to settle
+ *
+ * @return true: queued false: the queue is full
+ */
+bool Adafruit_ICM20X::queueI2CMasterReset(void) {
+  return queueAuxOp(AUX_OP_RESET, 0, 0, 0, 0);
+}
 
-  Adafruit_BusIO_RegisterBits slave_finished_bit =
-      Adafruit_BusIO_RegisterBits(&i2c_master_status_reg, 1, 6);
+/**************************************************************************/
+/*!
+ * @brief Advance the queued auxiliary I2C operations by one step. Each call
+ * does at most four register accesses and never waits, so it can be called
+ * from the main loop between normal data reads
+ *
+ * @return `ICM20X_AUX_BUSY` while operations remain, otherwise the result of
+ * the last queue
+ */
+icm20x_aux_status_t Adafruit_ICM20X::serviceAuxTransactions(void) {
+  if (aux_count == 0) {
+    return aux_status;
+  }
 
-  if (read) {
-    slv_addr |= 0x80; // set high bit for read, presumably for multi-byte reads
+  aux_op_t *op = &aux_queue[aux_head];
+  if (!aux_started) {
+    if (!startAuxOp(op)) {
+      finishAuxOp(false);
+      return aux_status;
+    }
+    aux_started = true;
+    aux_polls = 0;
+    aux_start_us = micros();
+    return aux_status;
+  }
 
-    slv4_di_reg = new Adafruit_BusIO_Register(
-        i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_SLV4_DI);
-  } else {
+  switch (op->type) {
+  case AUX_OP_READ:
+  case AUX_OP_WRITE: {
+    _setBank(0);
+    // clears on read
+    uint8_t status = readRegister(ICM20X_B0_I2C_MST_STATUS, ICM20X_BUS_OP_AUX);
+    if (status & 0x40) {   // I2C_SLV4_DONE
+      if (status & 0x10) { // I2C_SLV4_NACK
+        finishAuxOp(false);
+        break;
+      }
+      if (op->type == AUX_OP_READ) {
+        _setBank(3);
+        aux_read_value = readRegister(ICM20X_B3_I2C_SLV4_DI, ICM20X_BUS_OP_AUX);
+      }
+      finishAuxOp(true);
+    } else if (++aux_polls >= NUM_FINISHED_CHECKS) {
+      finishAuxOp(false);
+    }
+    break;
+  }
 
-    slv4_do_reg = new Adafruit_BusIO_Register(
-        i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B3_I2C_SLV4_DO);
+  case AUX_OP_RESET:
+    _setBank(0);
+    if (!readRegisterBits(ICM20X_B0_USER_CTRL, 1, 1, ICM20X_BUS_OP_AUX)) {
+      // reset done, give the master time to settle
+      op->type = AUX_OP_DELAY;
+      op->wait_us = ICM20X_AUX_RESET_SETTLE_US;
+      aux_start_us = micros();
+    }
+    break;
 
-    if (!slv4_do_reg->write(value)) {
-      return (uint8_t) false;
+  default:
+    if ((uint32_t)(micros() - aux_start_us) >= op->wait_us) {
+      finishAuxOp(true);
     }
+    break;
   }
+  return aux_status;
+}
 
-  if (!slv4_addr_reg.write(slv_addr)) {
-    return (uint8_t) false;
-  }
-  if (!slv4_reg_reg.write(reg_addr)) {
-    return (uint8_t) false;
+/**************************************************************************/
+/*!
+ * @brief Get the state of the queued auxiliary I2C operations without
+ * advancing them
+ *
+ * @return The current `icm20x_aux_status_t`
+ */
+icm20x_aux_status_t Adafruit_ICM20X::getAuxStatus(void) { return aux_status; }
+
+/**************************************************************************/
+/*!
+ * @brief Get the byte returned by the last finished auxiliary I2C read
+ *
+ * @return The last value read
+ */
+uint8_t Adafruit_ICM20X::getExternalReadValue(void) { return aux_read_value; }
+
+/**************************************************************************/
+/*!
+ * @brief Set a function to be called each time a queued auxiliary I2C read
+ * or write finishes. It is called from `serviceAuxTransactions`, not from an
+ * interrupt
+ *
+ * @param callback The function to call, or NULL to disable
+ */
+void Adafruit_ICM20X::setAuxCallback(icm20x_aux_callback_t callback) {
+  aux_callback = callback;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Get the number of free slots in the auxiliary I2C queue
+ *
+ * @return How many more operations can be queued
+ */
+uint8_t Adafruit_ICM20X::auxQueueSpace(void) {
+  return ICM20X_AUX_QUEUE_LEN - aux_count;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Run the queued auxiliary I2C operations to completion
+ *
+ * @return true: everything succeeded false: an operation failed
+ */
+bool Adafruit_ICM20X::finishAuxTransactions(void) {
+  while (serviceAuxTransactions() == ICM20X_AUX_BUSY) {
+    yield();
   }
+  return aux_status == ICM20X_AUX_IDLE;
+}
 
-  if (!slv4_ctrl_reg.write(0x80)) {
-    return (uint8_t) false;
+/**************************************************************************/
+/*!
+ * @brief Add an operation to the auxiliary I2C queue
+ *
+ * @param type one of the AUX_OP_ types
+ * @param slv_addr the 7-bit I2C address of the slave device
+ * @param reg_addr the register address to read or write
+ * @param value the value to write
+ * @param wait_us how long a delay should last
+ * @return true: queued false: the queue is full
+ */
+bool Adafruit_ICM20X::queueAuxOp(uint8_t type, uint8_t slv_addr,
+                                 uint8_t reg_addr, uint8_t value,
+                                 uint32_t wait_us) {
+  if (aux_count >= ICM20X_AUX_QUEUE_LEN) {
+    return false;
   }
 
-  _setBank(0);
-  uint8_t tries = 0;
-  // wait until the operation is finished
-  while (slave_finished_bit.read() != true) {
-    tries++;
-    if (tries >= NUM_FINISHED_CHECKS) {
-      return (uint8_t) false;
+  aux_op_t *op = &aux_queue[(aux_head + aux_count) % ICM20X_AUX_QUEUE_LEN];
+  op->type = type;
+  op->slv_addr = slv_addr;
+  op->reg_addr = reg_addr;
+  op->value = value;
+  op->wait_us = wait_us;
+  aux_count++;
+  aux_status = ICM20X_AUX_BUSY;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+ * @brief Issue the register writes that start an auxiliary I2C operation
+ *
+ * @param op the operation to start
+ * @return true: success false: a bus error
+ */
+bool Adafruit_ICM20X::startAuxOp(aux_op_t *op) {
+  switch (op->type) {
+  case AUX_OP_READ:
+  case AUX_OP_WRITE: {
+    _setBank(3);
+
+    uint8_t slv_addr = op->slv_addr;
+    if (op->type == AUX_OP_READ) {
+      slv_addr |= 0x80; // set high bit for read
+    } else if (!writeRegister(ICM20X_B3_I2C_SLV4_DO, op->value,
+                              ICM20X_BUS_OP_AUX)) {
+      return false;
     }
+
+    return writeRegister(ICM20X_B3_I2C_SLV4_ADDR, slv_addr,
+                         ICM20X_BUS_OP_AUX) &&
+           writeRegister(ICM20X_B3_I2C_SLV4_REG, op->reg_addr,
+                         ICM20X_BUS_OP_AUX) &&
+           writeRegister(ICM20X_B3_I2C_SLV4_CTRL, 0x80, ICM20X_BUS_OP_AUX);
   }
-  if (read) {
-    _setBank(3);
-    return slv4_di_reg->read();
+
+  case AUX_OP_RESET: {
+    // I2C_MST_RST clears itself, so it is set around the shadow
+    uint8_t user_ctrl = readConfig(0, ICM20X_B0_USER_CTRL) | 0x02;
+    _setBank(0);
+    return writeRegister(ICM20X_B0_USER_CTRL, user_ctrl, ICM20X_BUS_OP_AUX);
+  }
+
+  default:
+    return true;
   }
-  return (uint8_t) true;
 }
 
 /**************************************************************************/
 /*!
- * @brief Reset the I2C master
+ * @brief Retire the auxiliary I2C operation in progress. A failure flushes
+ * the rest of the queue
  *
+ * @param success did the operation succeed
  */
-void Adafruit_ICM20X::resetI2CMaster(void) {
-
-  _setBank(0);
-  Adafruit_BusIO_Register user_ctrl = Adafruit_BusIO_Register(
-      i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, ICM20X_B0_USER_CTRL);
-
-  Adafruit_BusIO_RegisterBits i2c_master_reset_bit =
-      Adafruit_BusIO_RegisterBits(&user_ctrl, 1, 1);
+void Adafruit_ICM20X::finishAuxOp(bool success) {
+  aux_op_t op = aux_queue[aux_head];
+
+  aux_started = false;
+  if (success) {
+    aux_head = (aux_head + 1) % ICM20X_AUX_QUEUE_LEN;
+    aux_count--;
+    if (aux_count == 0) {
+      aux_status = ICM20X_AUX_IDLE;
+    }
+  } else {
+    aux_head = 0;
+    aux_count = 0;
+    aux_status = ICM20X_AUX_FAILED;
+  }
 
-  i2c_master_reset_bit.write(true);
-  while (i2c_master_reset_bit.read()) {
-    delay(10);
+  if (aux_callback && (op.type == AUX_OP_READ || op.type == AUX_OP_WRITE)) {
+    aux_callback(op.slv_addr & 0x7F, op.reg_addr,
+                 op.type == AUX_OP_READ ? aux_read_value : op.value, success);
   }
-  delay(100);
 }
 
 /**************************************************************************/
@@ -983,8 +2732,8 @@ void Adafruit_ICM20X_Accelerometer::getSensor(sensor_t *sensor) {
 */
 /**************************************************************************/
 bool Adafruit_ICM20X_Accelerometer::getEvent(sensors_event_t *event) {
-  _theICM20X->_read();
-  _theICM20X->fillAccelEvent(event, millis());
+  _theICM20X->_readIfStale(ICM20X_SENSOR_ACCEL);
+  _theICM20X->fillAccelEvent(event, _theICM20X->sampleMillis());
 
   return true;
 }
@@ -1018,8 +2767,8 @@ void Adafruit_ICM20X_Gyro::getSensor(sensor_t *sensor) {
 */
 /**************************************************************************/
 bool Adafruit_ICM20X_Gyro::getEvent(sensors_event_t *event) {
-  _theICM20X->_read();
-  _theICM20X->fillGyroEvent(event, millis());
+  _theICM20X->_readIfStale(ICM20X_SENSOR_GYRO);
+  _theICM20X->fillGyroEvent(event, _theICM20X->sampleMillis());
 
   return true;
 }
@@ -1053,8 +2802,8 @@ void Adafruit_ICM20X_Magnetometer::getSensor(sensor_t *sensor) {
 */
 /**************************************************************************/
 bool Adafruit_ICM20X_Magnetometer::getEvent(sensors_event_t *event) {
-  _theICM20X->_read();
-  _theICM20X->fillMagEvent(event, millis());
+  _theICM20X->_readIfStale(ICM20X_SENSOR_MAG);
+  _theICM20X->fillMagEvent(event, _theICM20X->sampleMillis());
 
   return true;
 }
@@ -1088,8 +2837,109 @@ void Adafruit_ICM20X_Temp::getSensor(sensor_t *sensor) {
 */
 /**************************************************************************/
 bool Adafruit_ICM20X_Temp::getEvent(sensors_event_t *event) {
-  _theICM20X->_read();
-  _theICM20X->fillTempEvent(event, millis());
+  _theICM20X->_readIfStale(ICM20X_SENSOR_TEMP);
+  _theICM20X->fillTempEvent(event, _theICM20X->sampleMillis());
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Create a sample ring on top of caller supplied storage
+    @param  buffer Storage for the samples
+    @param  capacity The number of elements in `buffer`. One element is kept
+            free to tell a full ring from an empty one, so the ring holds
+            `capacity - 1` samples
+*/
+/**************************************************************************/
+Adafruit_ICM20X_SampleRing::Adafruit_ICM20X_SampleRing(
+    icm20x_raw_sample_t *buffer, uint16_t capacity) {
+  _buffer = buffer;
+  _capacity = capacity;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a sample to the ring. Only call from the producer side
+    @param  sample The sample to copy in
+    @returns True if the sample was stored, false if the ring was full
+*/
+/**************************************************************************/
+bool Adafruit_ICM20X_SampleRing::push(const icm20x_raw_sample_t *sample) {
+  uint16_t head = _head;
+  uint16_t next = head + 1;
+  if (next >= _capacity) {
+    next = 0;
+  }
+  if (next == _tail) {
+    return false;
+  }
+  // the consumer is done with the slot before it is overwritten
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  _buffer[head] = *sample;
+  // the sample is stored before the consumer can see the new head
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  _head = next;
+  return true;
+}
 
+/**************************************************************************/
+/*!
+    @brief  Remove the oldest sample from the ring. Only call from the consumer
+            side
+    @param  sample The sample to copy out to
+    @returns True if a sample was returned, false if the ring was empty
+*/
+/**************************************************************************/
+bool Adafruit_ICM20X_SampleRing::pop(icm20x_raw_sample_t *sample) {
+  uint16_t tail = _tail;
+  if (tail == _head) {
+    return false;
+  }
+  // the sample is read after the head that published it
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  *sample = _buffer[tail];
+  tail++;
+  if (tail >= _capacity) {
+    tail = 0;
+  }
+  // the sample is copied out before the producer can reuse its slot
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  _tail = tail;
   return true;
 }
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of samples waiting in the ring
+    @returns The number of samples that can be popped
+*/
+/**************************************************************************/
+uint16_t Adafruit_ICM20X_SampleRing::available(void) {
+  uint16_t head = _head;
+  uint16_t tail = _tail;
+  if (head >= tail) {
+    return head - tail;
+  }
+  return _capacity - tail + head;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Get the number of free slots in the ring
+    @returns The number of samples that can be pushed
+*/
+/**************************************************************************/
+uint16_t Adafruit_ICM20X_SampleRing::space(void) {
+  if (!_capacity) {
+    return 0;
+  }
+  return _capacity - 1 - available();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drop all samples. Not safe while the producer is pushing
+*/
+/**************************************************************************/
+void Adafruit_ICM20X_SampleRing::clear(void) { _tail = _head; }
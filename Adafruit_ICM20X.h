@@ -30,43 +30,79 @@
   5 ///< The number of times to try resetting a stuck I2C master before giving
     ///< up
 #define NUM_FINISHED_CHECKS                                                    \
-  100 ///< How many times to poll I2C_SLV4_DONE before giving up and resetting
+  100 ///< How many times to poll I2C_SLV4_DONE before giving up on an
+      ///< auxillary I2C transaction
+#define ICM20X_AUX_QUEUE_LEN                                                   \
+  4 ///< Auxillary I2C operations that can be queued without blocking
+#define ICM20X_AUX_RESET_SETTLE_US                                             \
+  100000 ///< Time to let the I2C master settle after a reset
+#define ICM20X_RESET_TIMEOUT_MS                                                \
+  100 ///< Longest time to wait for a reset to finish
+#define ICM20X_STARTUP_TIMEOUT_MS                                              \
+  20 ///< Longest time to wait for the first sample after `begin`
+#define ICM20X_SPI_CONFIG_FREQ                                                 \
+  1000000 ///< SPI clock used for configuration register access
+#define ICM20X_SPI_MAX_FREQ                                                    \
+  7000000 ///< Fastest SPI clock allowed for sensor and interrupt registers
+#define ICM20X_DEFAULT_GYRO_RATE_HZ                                            \
+  100.0 ///< Gyro output data rate set by `begin`
+#define ICM20X_DEFAULT_ACCEL_RATE_HZ                                           \
+  53.57 ///< Accelerometer output data rate set by `begin`
+#define ICM20X_WOM_MG_PER_LSB                                                  \
+  4 ///< Wake on motion threshold step in milli-g
 
 // Bank 0
-#define ICM20X_B0_WHOAMI 0x00         ///< Chip ID register
-#define ICM20X_B0_USER_CTRL 0x03      ///< User Control Reg. Includes I2C Master
-#define ICM20X_B0_LP_CONFIG 0x05      ///< Low Power config
-#define ICM20X_B0_REG_INT_PIN_CFG 0xF ///< Interrupt config register
-#define ICM20X_B0_REG_INT_ENABLE 0x10 ///< Interrupt enable register 0
+#define ICM20X_B0_WHOAMI 0x00           ///< Chip ID register
+#define ICM20X_B0_USER_CTRL 0x03        ///< User Control Reg. Includes I2C Master
+#define ICM20X_B0_LP_CONFIG 0x05        ///< Low Power config
+#define ICM20X_B0_REG_INT_PIN_CFG 0xF   ///< Interrupt config register
+#define ICM20X_B0_REG_INT_ENABLE 0x10   ///< Interrupt enable register 0
 #define ICM20X_B0_REG_INT_ENABLE_1 0x11 ///< Interrupt enable register 1
 #define ICM20X_B0_I2C_MST_STATUS                                               \
   0x17 ///< Records if I2C master bus data is finished
-#define ICM20X_B0_REG_BANK_SEL 0x7F ///< register bank selection register
-#define ICM20X_B0_PWR_MGMT_1 0x06   ///< primary power management register
-#define ICM20X_B0_ACCEL_XOUT_H 0x2D ///< first byte of accel data
-#define ICM20X_B0_GYRO_XOUT_H 0x33  ///< first byte of accel data
+#define ICM20X_B0_REG_INT_ENABLE_2 0x12 ///< FIFO overflow interrupt enable
+#define ICM20X_B0_REG_INT_ENABLE_3 0x13 ///< FIFO watermark interrupt enable
+#define ICM20X_B0_INT_STATUS 0x19       ///< Wake on motion interrupt status
+#define ICM20X_B0_INT_STATUS_1 0x1A     ///< Raw data ready interrupt status
+#define ICM20X_B0_INT_STATUS_2 0x1B     ///< FIFO overflow interrupt status
+#define ICM20X_B0_INT_STATUS_3 0x1C     ///< FIFO watermark interrupt status
+#define ICM20X_B0_REG_BANK_SEL 0x7F     ///< register bank selection register
+#define ICM20X_B0_PWR_MGMT_1 0x06       ///< primary power management register
+#define ICM20X_B0_PWR_MGMT_2 0x07       ///< accel and gyro axis enables
+#define ICM20X_B0_ACCEL_XOUT_H 0x2D     ///< first byte of accel data
+#define ICM20X_B0_GYRO_XOUT_H 0x33      ///< first byte of accel data
+#define ICM20X_B0_FIFO_EN_1 0x66        ///< FIFO enable for the I2C slave data
+#define ICM20X_B0_FIFO_EN_2 0x67        ///< FIFO enable for accel, gyro and temp
+#define ICM20X_B0_FIFO_RST 0x68         ///< FIFO reset
+#define ICM20X_B0_FIFO_MODE 0x69        ///< FIFO stream or snapshot mode
+#define ICM20X_B0_FIFO_COUNT_H 0x70     ///< First byte of the FIFO byte count
+#define ICM20X_B0_FIFO_R_W 0x72         ///< FIFO data port
 
 // Bank 1
-#define ICM20X_B1_SELF_TEST_X_GYRO 0x02         ///< Gyro X self-test output generated during manufacturing tests
-#define ICM20X_B1_SELF_TEST_Y_GYRO 0x03         ///< Gyro Y self-test output generated during manufacturing tests
-#define ICM20X_B1_SELF_TEST_X_GYRO 0x04         ///< Gyro Z self-test output generated during manufacturing tests
-#define ICM20X_B1_SELF_TEST_X_ACCEL 0x0E        ///< Accel X self-test output generated during manufacturing tests
-#define ICM20X_B1_SELF_TEST_Y_ACCEL 0x0F        ///< Accel Y self-test output generated during manufacturing tests
-#define ICM20X_B1_SELF_TEST_X_ACCEL 0x10        ///< Accel Z self-test output generated during manufacturing tests
-#define ICM20X_B1_XA_OFFS_H 0x14                ///< Upper bits of the X accelerometer offset cancellation
-#define ICM20X_B1_XA_OFFS_L 0x15                ///< Lower bits of the X accelerometer offset cancellation
-#define ICM20X_B1_YA_OFFS_H 0x17                ///< Upper bits of the Y accelerometer offset cancellation
-#define ICM20X_B1_YA_OFFS_L 0x18                ///< Lower bits of the Y accelerometer offset cancellation
-#define ICM20X_B1_ZA_OFFS_H 0x1A                ///< Upper bits of the Z accelerometer offset cancellation
-#define ICM20X_B1_ZA_OFFS_L 0x1B                ///< Lower bits of the Z accelerometer offset cancellation
-#define ICM20X_B1_TIMEBASE_CORRECTION_PLL 0x28  ///< System PLL clock period error (signed, [-10%, +10%]).
+#define ICM20X_B1_SELF_TEST_X_GYRO 0x02        ///< Gyro X self-test output generated during manufacturing tests
+#define ICM20X_B1_SELF_TEST_Y_GYRO 0x03        ///< Gyro Y self-test output generated during manufacturing tests
+#define ICM20X_B1_SELF_TEST_Z_GYRO 0x04        ///< Gyro Z self-test output generated during manufacturing tests
+#define ICM20X_B1_SELF_TEST_X_ACCEL 0x0E       ///< Accel X self-test output generated during manufacturing tests
+#define ICM20X_B1_SELF_TEST_Y_ACCEL 0x0F       ///< Accel Y self-test output generated during manufacturing tests
+#define ICM20X_B1_SELF_TEST_Z_ACCEL 0x10       ///< Accel Z self-test output generated during manufacturing tests
+#define ICM20X_B1_XA_OFFS_H 0x14               ///< Upper bits of the X accelerometer offset cancellation
+#define ICM20X_B1_XA_OFFS_L 0x15               ///< Lower bits of the X accelerometer offset cancellation
+#define ICM20X_B1_YA_OFFS_H 0x17               ///< Upper bits of the Y accelerometer offset cancellation
+#define ICM20X_B1_YA_OFFS_L 0x18               ///< Lower bits of the Y accelerometer offset cancellation
+#define ICM20X_B1_ZA_OFFS_H 0x1A               ///< Upper bits of the Z accelerometer offset cancellation
+#define ICM20X_B1_ZA_OFFS_L 0x1B               ///< Lower bits of the Z accelerometer offset cancellation
+#define ICM20X_B1_TIMEBASE_CORRECTION_PLL 0x28 ///< System PLL clock period error (signed, [-10%, +10%]).
 
 // Bank 2
 #define ICM20X_B2_GYRO_SMPLRT_DIV 0x00    ///< Gyroscope data rate divisor
 #define ICM20X_B2_GYRO_CONFIG_1 0x01      ///< Gyro config for range setting
+#define ICM20X_B2_GYRO_CONFIG_2 0x02      ///< Gyro self test and averaging
 #define ICM20X_B2_ACCEL_SMPLRT_DIV_1 0x10 ///< Accel data rate divisor MSByte
 #define ICM20X_B2_ACCEL_SMPLRT_DIV_2 0x11 ///< Accel data rate divisor LSByte
+#define ICM20X_B2_ACCEL_INTEL_CTRL 0x12   ///< Wake on motion logic control
+#define ICM20X_B2_ACCEL_WOM_THR 0x13      ///< Wake on motion threshold
 #define ICM20X_B2_ACCEL_CONFIG_1 0x14     ///< Accel config for setting range
+#define ICM20X_B2_ACCEL_CONFIG_2 0x15     ///< Accel self test and averaging
 
 // Bank 3
 #define ICM20X_B3_I2C_MST_ODR_CONFIG 0x0 ///< Sets ODR for I2C master bus
@@ -78,6 +114,8 @@
   0x4 ///< Sets register address for I2C master bus slave 0
 #define ICM20X_B3_I2C_SLV0_CTRL 0x5 ///< Controls for I2C master bus slave 0
 #define ICM20X_B3_I2C_SLV0_DO 0x6   ///< Sets I2C master bus slave 0 data out
+#define ICM20X_B3_I2C_SLV1_ADDR                                                \
+  0x7 ///< Sets I2C address for I2C master bus slave 1
 
 #define ICM20X_B3_I2C_SLV4_ADDR                                                \
   0x13 ///< Sets I2C address for I2C master bus slave 4
@@ -87,6 +125,70 @@
 #define ICM20X_B3_I2C_SLV4_DO 0x16   ///< Sets I2C master bus slave 4 data out
 #define ICM20X_B3_I2C_SLV4_DI 0x17   ///< Sets I2C master bus slave 4 data in
 
+#define ICM20X_DATA_SIZE                                                       \
+  23 ///< Bytes of accel, gyro, temp and proxied magnetometer data
+#define ICM20X_FIFO_FRAME_SIZE                                                 \
+  14 ///< Bytes per FIFO frame of accel, gyro and temp data
+#define ICM20X_FIFO_MAG_FRAME_SIZE                                             \
+  23 ///< Bytes per FIFO frame including the 9 proxied magnetometer bytes
+#define ICM20X_FIFO_MAX_BURST                                                  \
+  240 ///< Largest single FIFO burst read in bytes; also the size of the
+      ///< stack buffer used to drain the FIFO
+
+#define ICM20X_SHADOW_SIZE                                                     \
+  45 ///< Configuration registers mirrored by the shadow register file
+
+#define ICM20X_SCALE_Q_BITS                                                    \
+  30 ///< Fractional bits in the `icm20x_fixed_scale_t` scale factors
+#define ICM20X_SCALE_Q(x)                                                      \
+  ((int32_t)((x) * (double)(1UL << ICM20X_SCALE_Q_BITS) +                      \
+             0.5)) ///< Convert a constant scale factor to fixed point
+#define ICM20X_TEMP_OFFSET_Q16                                                 \
+  (21L << 16) ///< Temperature at a raw reading of 0, in Q16.16 degrees C
+#define ICM20X_TEMP_C_PER_LSB                                                  \
+  (1 / 333.87F) ///< Temperature sensor sensitivity in degrees C per LSB
+#define ICM20X_TEMP_OFFSET_C                                                   \
+  21.0F ///< Temperature at a raw reading of 0, in degrees C
+
+#define ICM20X_TIMEBASE_PLL_UNITY                                              \
+  1270 ///< TIMEBASE_CORRECTION_PLL step is 1/1270 of the sample clock
+#define ICM20X_GYRO_BASE_RATE_HZ                                               \
+  1100 ///< Gyro rate before the divisor, with the DLPF enabled
+#define ICM20X_ACCEL_BASE_RATE_HZ                                              \
+  1125 ///< Accelerometer rate before the divisor, with the DLPF enabled
+#define ICM20X_GYRO_BYPASS_RATE_HZ                                             \
+  9000 ///< Gyro rate with the DLPF bypassed, the divisor is ignored
+#define ICM20X_ACCEL_BYPASS_RATE_HZ                                            \
+  4500 ///< Accelerometer rate with the DLPF bypassed, the divisor is ignored
+#define ICM20X_GYRO_MAX_DIVISOR 255   ///< Largest gyro rate divisor
+#define ICM20X_ACCEL_MAX_DIVISOR 4095 ///< Largest accelerometer rate divisor
+
+#define ICM20X_SNAPSHOT_DATA_PERIOD                                            \
+  0xFFFFFFFF ///< `setSnapshotMaxAge` value to reuse a reading for one output
+             ///< data period
+
+// Uncomment to count bus transactions and time them by kind and by calling
+// function with `getBusStats`. Adds about 300 bytes of RAM and a `micros()`
+// call around every transfer, so it is off by default
+// #define ICM20X_BUS_STATS
+
+#ifndef ICM20X_BUS_STATS_SITES
+#define ICM20X_BUS_STATS_SITES 16 ///< Calling functions `getBusStats` tracks
+#endif
+
+#ifdef ICM20X_BUS_STATS
+// The register helpers take the name of the function that called them, filled
+// in by the compiler at each call site, and pass it down to the transfer
+#define ICM20X_BUS_SITE_PARAM                                                  \
+  , const char *site = __builtin_FUNCTION() ///< Declare the caller parameter
+#define ICM20X_BUS_SITE_DEF , const char *site ///< Define the caller parameter
+#define ICM20X_BUS_SITE_ARG , site             ///< Pass the caller on
+#else
+#define ICM20X_BUS_SITE_PARAM ///< No caller parameter without stats
+#define ICM20X_BUS_SITE_DEF   ///< No caller parameter without stats
+#define ICM20X_BUS_SITE_ARG   ///< No caller parameter without stats
+#endif
+
 #define ICM20948_CHIP_ID 0xEA ///< ICM20948 default device id from WHOAMI
 #define ICM20649_CHIP_ID 0xE1 ///< ICM20649 default device id from WHOAMI
 
@@ -114,6 +216,148 @@ typedef enum {
 
 } icm20x_gyro_cutoff_t;
 
+/** Kinds of bus transaction tracked by `getBusStats` */
+typedef enum {
+  ICM20X_BUS_OP_BANK,   ///< REG_BANK_SEL writes
+  ICM20X_BUS_OP_DATA,   ///< Sensor data and FIFO bursts
+  ICM20X_BUS_OP_AUX,    ///< Auxillary I2C master (SLV4) transactions
+  ICM20X_BUS_OP_CONFIG, ///< Everything else
+  ICM20X_BUS_OP_COUNT,  ///< Number of op kinds
+} icm20x_bus_op_t;
+
+/** Counters and timing for one kind of bus transaction */
+typedef struct {
+  uint32_t transactions; ///< Reads and writes issued
+  uint32_t bytes;        ///< Register bytes moved, excluding addresses
+  uint32_t total_us;     ///< Sum of transaction times, for the average
+  uint32_t min_us;       ///< Shortest transaction, 0xFFFFFFFF if none
+  uint32_t max_us;       ///< Longest transaction
+} icm20x_bus_op_stats_t;
+
+/** Counters and timing for the transactions of one calling function */
+typedef struct {
+  const char *site;      ///< The driver function, NULL for an unused entry
+  uint32_t transactions; ///< Reads and writes issued
+  uint32_t bytes;        ///< Register bytes moved, excluding addresses
+  uint32_t total_us;     ///< Sum of transaction times, for the average
+} icm20x_bus_site_stats_t;
+
+/** Bus statistics snapshot, indexed by `icm20x_bus_op_t`, and per calling
+ * function in the order they first used the bus */
+typedef struct {
+  icm20x_bus_op_stats_t op[ICM20X_BUS_OP_COUNT]; ///< Stats per op kind
+  icm20x_bus_site_stats_t
+      site[ICM20X_BUS_STATS_SITES]; ///< Stats per calling function
+  uint32_t untracked; ///< Transactions from functions after `site` filled up
+} icm20x_bus_stats_t;
+
+/** State of the queued auxillary I2C transactions, see
+ * `serviceAuxTransactions` */
+typedef enum {
+  ICM20X_AUX_IDLE,   ///< Nothing queued, everything finished successfully
+  ICM20X_AUX_BUSY,   ///< Operations are still queued or in progress
+  ICM20X_AUX_FAILED, ///< An operation timed out or was NACKed; the queue was
+                     ///< flushed
+} icm20x_aux_status_t;
+
+/** Called when a queued auxillary I2C operation finishes.
+ * `value` is the byte read for reads and the byte written for writes */
+typedef void (*icm20x_aux_callback_t)(uint8_t slv_addr, uint8_t reg_addr,
+                                      uint8_t value, bool success);
+
+/** Status of the magnetometer reading in a sample, combine with `|` */
+typedef enum {
+  ICM20X_SAMPLE_MAG_NEW = 0x01, ///< The magnetometer reading is new; the
+                                     ///< mag runs at most 100Hz so most
+                                     ///< samples repeat the last one
+  ICM20X_SAMPLE_MAG_OVERFLOW = 0x02, ///< The magnetic field was too strong to
+                                     ///< measure, the reading is not valid
+} icm20x_sample_flag_t;
+
+/** A single set of raw, unscaled measurements */
+typedef struct {
+  int16_t accel[3];      ///< Raw accelerometer X, Y and Z
+  int16_t gyro[3];       ///< Raw gyro X, Y and Z
+  int16_t temperature;   ///< Raw temperature
+  int16_t mag[3];        ///< Raw magnetometer X, Y and Z
+  uint32_t timestamp_us; ///< `micros()` when the sample was taken
+  uint8_t flags;         ///< `icm20x_sample_flag_t` values
+} icm20x_raw_sample_t;
+
+/** Fixed point scale factors for the current measurement ranges, in SI units
+ * per LSB with `ICM20X_SCALE_Q_BITS` fractional bits. Use `icm20x_raw_to_q16`
+ * to apply them */
+typedef struct {
+  int32_t accel;       ///< m/s^2 per LSB
+  int32_t gyro;        ///< rad/s per LSB
+  int32_t mag;         ///< uT per LSB, 0 if there is no magnetometer
+  int32_t temperature; ///< degrees C per LSB, add `ICM20X_TEMP_OFFSET_Q16`
+} icm20x_fixed_scale_t;
+
+/** Per-chip scale factors for every measurement range, indexed by the range
+ * register value. Floats are multipliers to SI units, the `_q` entries hold the
+ * same factors in fixed point with `ICM20X_SCALE_Q_BITS` fractional bits */
+typedef struct {
+  float accel[4];     ///< m/s^2 per LSB for each accelerometer range
+  float gyro[4];      ///< rad/s per LSB for each gyro range
+  float mag;          ///< uT per LSB, 0 if there is no magnetometer
+  int32_t accel_q[4]; ///< m/s^2 per LSB for each accelerometer range
+  int32_t gyro_q[4];  ///< rad/s per LSB for each gyro range
+  int32_t mag_q;      ///< uT per LSB, 0 if there is no magnetometer
+} icm20x_scale_table_t;
+
+/*!
+ *    @brief  Scale a raw value without using floating point
+ *    @param  raw The raw sensor value
+ *    @param  scale The matching factor from an `icm20x_fixed_scale_t`
+ *    @return The value in SI units as Q16.16 fixed point
+ */
+static inline int32_t icm20x_raw_to_q16(int16_t raw, int32_t scale) {
+  return (int32_t)(((int64_t)raw * scale) >> (ICM20X_SCALE_Q_BITS - 16));
+}
+
+/*!
+ *    @brief  Fixed size ring of raw samples backed by caller supplied storage.
+ *            One side may push while the other pops without locking, as long
+ *            as there is a single producer and a single consumer. Fences
+ *            order the sample copies against the index updates, so the two
+ *            sides may also run on different cores.
+ */
+class Adafruit_ICM20X_SampleRing {
+public:
+  Adafruit_ICM20X_SampleRing(icm20x_raw_sample_t *buffer, uint16_t capacity);
+
+  bool push(const icm20x_raw_sample_t *sample);
+  bool pop(icm20x_raw_sample_t *sample);
+  uint16_t available(void);
+  uint16_t space(void);
+  void clear(void);
+
+private:
+  icm20x_raw_sample_t *_buffer;
+  uint16_t _capacity;
+  volatile uint16_t _head = 0;
+  volatile uint16_t _tail = 0;
+};
+
+/** Interrupt sources that can be routed to INT1, combine with `|` */
+typedef enum {
+  ICM20X_INT_DATA_READY = 0x01,     ///< New sensor data is ready
+  ICM20X_INT_FIFO_OVERFLOW = 0x02,  ///< The FIFO overflowed
+  ICM20X_INT_FIFO_WATERMARK = 0x04, ///< The FIFO reached its watermark
+  ICM20X_INT_WAKE_ON_MOTION = 0x08, ///< Motion over the wake on motion
+                                    ///< threshold, see `enableWakeOnMotion`
+} icm20x_int_source_t;
+
+/** Sensors inside the chip that can be powered up or down, combine with `|` */
+typedef enum {
+  ICM20X_SENSOR_ACCEL = 0x01, ///< Accelerometer
+  ICM20X_SENSOR_GYRO = 0x02,  ///< Gyro
+  ICM20X_SENSOR_TEMP = 0x04,  ///< Temperature sensor
+  ICM20X_SENSOR_MAG = 0x08,   ///< Magnetometer, on the ICM20948 only
+  ICM20X_SENSOR_ALL = 0x0F,   ///< Every sensor
+} icm20x_sensor_t;
+
 class Adafruit_ICM20X;
 
 /** Adafruit Unified Sensor interface for accelerometer component of ICM20X */
@@ -189,6 +433,8 @@ public:
                  int32_t sensor_id = 0);
   bool begin_SPI(int8_t cs_pin, int8_t sck_pin, int8_t miso_pin,
                  int8_t mosi_pin, int32_t sensor_id = 0);
+  bool setSPIDataFrequency(uint32_t frequency);
+  uint32_t getLastBurstMicros(void);
 
   uint8_t getGyroRateDivisor(void);
   void setGyroRateDivisor(uint8_t new_gyro_divisor);
@@ -196,6 +442,12 @@ public:
   uint16_t getAccelRateDivisor(void);
   void setAccelRateDivisor(uint16_t new_accel_divisor);
 
+  float getGyroDataRate(void);
+  float setGyroDataRate(float rate_hz);
+
+  float getAccelDataRate(void);
+  float setAccelDataRate(float rate_hz);
+
   bool enableAccelDLPF(bool enable, icm20x_accel_cutoff_t cutoff_freq);
   bool enableGyrolDLPF(bool enable, icm20x_gyro_cutoff_t cutoff_freq);
     
@@ -210,10 +462,49 @@ public:
 
   void reset(void);
 
+  void invalidateBankCache(void);
+  uint32_t getBankWritesIssued(void);
+  uint32_t getBankWritesSkipped(void);
+
+  void setWarmStart(bool warm_start);
+  bool wasWarmStart(void);
+  uint32_t getStartupMicros(void);
+
+  void beginConfig(void);
+  bool commitConfig(void);
+  bool refreshShadow(void);
+  void invalidateShadow(void);
+
+  bool getBusStats(icm20x_bus_stats_t *stats);
+  void resetBusStats(void);
+  void printBusStats(Print *out = &Serial);
+
+  bool enableFIFO(bool enable, bool include_mag = false);
+  void resetFIFO(void);
+  uint16_t getFIFOCount(void);
+  uint16_t readFIFO(Adafruit_ICM20X_SampleRing *ring,
+                    uint16_t max_frames = 0xFFFF);
+  uint32_t getFIFOOverflowCount(void);
+
   // TODO: bool-ify
   void setInt1ActiveLow(bool active_low);
   void setInt2ActiveLow(bool active_low);
 
+  bool enableInterrupts(uint8_t sources);
+  uint8_t getInterruptStatus(void);
+  void setInterruptCallback(void (*callback)(void));
+  void handleInterrupt(void);
+  bool interruptPending(void);
+  uint16_t serviceInterrupts(Adafruit_ICM20X_SampleRing *ring);
+
+  bool setPoweredSensors(uint8_t sensors);
+  uint8_t getPoweredSensors(void);
+  bool enableLowPower(bool enable);
+  bool isLowPowerEnabled(void);
+  bool setSleep(bool sleep);
+  bool isSleeping(void);
+  bool enableWakeOnMotion(bool enable, uint16_t threshold_mg = 100);
+
   Adafruit_Sensor *getAccelerometerSensor(void);
   Adafruit_Sensor *getGyroSensor(void);
   Adafruit_Sensor *getMagnetometerSensor(void);
@@ -222,7 +513,26 @@ public:
   bool getEvent(sensors_event_t *accel, sensors_event_t *gyro,
                 sensors_event_t *temp, sensors_event_t *mag = NULL);
 
+  uint32_t getSampleMicros(void);
+  uint32_t getSamplePeriodNanos(void);
+  int8_t getTimebaseCorrection(void);
+
+  void setSnapshotMaxAge(uint32_t max_age_us);
+  uint32_t getSnapshotGeneration(void);
+
+  bool readRaw(icm20x_raw_sample_t *sample);
+  uint8_t getSampleFlags(void);
+  void getFixedScale(icm20x_fixed_scale_t *scale);
+
   uint8_t readExternalRegister(uint8_t slv_addr, uint8_t reg_addr);
+  bool queueExternalRead(uint8_t slv_addr, uint8_t reg_addr);
+  bool queueExternalWrite(uint8_t slv_addr, uint8_t reg_addr, uint8_t value);
+  bool queueAuxDelay(uint32_t delay_us);
+  bool queueI2CMasterReset(void);
+  icm20x_aux_status_t serviceAuxTransactions(void);
+  icm20x_aux_status_t getAuxStatus(void);
+  uint8_t getExternalReadValue(void);
+  void setAuxCallback(icm20x_aux_callback_t callback);
   bool writeExternalRegister(uint8_t slv_addr, uint8_t reg_addr, uint8_t value);
   bool configureI2CMaster(void);
   bool enableI2CMaster(bool enable_i2c_master);
@@ -243,20 +553,36 @@ protected:
 
   Adafruit_I2CDevice *i2c_dev = NULL; ///< Pointer to I2C bus interface
   Adafruit_SPIDevice *spi_dev = NULL; ///< Pointer to SPI bus interface
-
-  Adafruit_ICM20X_Accelerometer *accel_sensor =
-      NULL;                                 ///< Accelerometer data object
-  Adafruit_ICM20X_Gyro *gyro_sensor = NULL; ///< Gyro data object
-  Adafruit_ICM20X_Magnetometer *mag_sensor =
-      NULL;                                 ///< Magnetometer sensor data object
-  Adafruit_ICM20X_Temp *temp_sensor = NULL; ///< Temp sensor data object
-  uint16_t _sensorid_accel,                 ///< ID number for accelerometer
-      _sensorid_gyro,                       ///< ID number for gyro
-      _sensorid_mag,                        ///< ID number for mag
-      _sensorid_temp;                       ///< ID number for temperature
-
-  void _read(void);
+  Adafruit_SPIDevice *spi_data_dev =
+      NULL;                                        ///< SPI interface at the data clock, NULL to use `spi_dev`
+  uint32_t spi_data_freq = ICM20X_SPI_CONFIG_FREQ; ///< SPI data burst clock
+
+  int8_t spi_cs = -1,       ///< SPI chip select pin
+      spi_sck = -1,         ///< Software SPI clock pin, -1 for hardware SPI
+      spi_miso = -1,        ///< Software SPI MISO pin
+      spi_mosi = -1;        ///< Software SPI MOSI pin
+  SPIClass *spi_bus = NULL; ///< Hardware SPI bus
+
+  uint32_t last_burst_us = 0; ///< Duration of the last data burst
+
+  Adafruit_ICM20X_Accelerometer accel_sensor; ///< Accelerometer data object
+  Adafruit_ICM20X_Gyro gyro_sensor;           ///< Gyro data object
+  Adafruit_ICM20X_Magnetometer mag_sensor;    ///< Magnetometer data object
+  Adafruit_ICM20X_Temp temp_sensor;           ///< Temp sensor data object
+  uint16_t _sensorid_accel,                   ///< ID number for accelerometer
+      _sensorid_gyro,                         ///< ID number for gyro
+      _sensorid_mag,                          ///< ID number for mag
+      _sensorid_temp;                         ///< ID number for temperature
+
+  bool _read(uint8_t sensors);
+  bool _readIfStale(uint8_t sensors);
+  virtual bool _readRaw(uint8_t sensors);
+  bool setupDataSPI(void);
+  Adafruit_SPIDevice *dataSPIDevice(void);
+  uint32_t dataPeriodMicros(void);
   virtual void scaleValues(void);
+  virtual bool setupMag(void);
+  void updateScales(void);
   virtual bool begin_I2C(uint8_t i2c_add, TwoWire *wire, int32_t sensor_id);
   // virtual bool _init(int32_t sensor_id);
   bool _init(int32_t sensor_id);
@@ -271,10 +597,77 @@ protected:
       rawMagY,     ///< temp variables
       rawMagZ;     ///< temp variables
 
+  uint8_t chip_id = 0;         ///< WHOAMI value found by `begin`
   uint8_t current_accel_range; ///< accelerometer range cache
   uint8_t current_gyro_range;  ///< gyro range cache
+
+  const icm20x_scale_table_t *scale_table = NULL;  ///< Set by each chip
+  float accel_scale = 0,                           ///< m/s^2 per LSB for the current range
+      gyro_scale = 0,                              ///< rad/s per LSB for the current range
+      mag_scale = 0;                               ///< uT per LSB
+  icm20x_fixed_scale_t fixed_scale = {0, 0, 0, 0}; ///< Scales for the ranges
+
+  uint8_t current_gyro_divisor = 0;   ///< gyro rate divisor cache
+  uint16_t current_accel_divisor = 0; ///< accelerometer rate divisor cache
+
+  uint32_t sample_time_us = 0; ///< `micros()` when the last reading was taken
+  uint8_t sample_flags = 0;    ///< `icm20x_sample_flag_t` for the last reading
+  bool mag_updated = false;    ///< Did the last reading change the raw mag
+  int8_t timebase_pll = 0;     ///< Sample clock error, 1/1270 per step
+  virtual uint32_t sampleMillis(void);
+  uint64_t gyroPeriodNanos(void);
+  uint64_t accelPeriodNanos(void);
+  uint16_t nearestDivisor(uint32_t base_hz, float rate_hz,
+                          uint16_t max_divisor);
+  uint32_t sampleTime(uint32_t read_us);
+
+  bool snapshot_valid = false;      ///< Is the last reading still usable
+  uint32_t snapshot_time_us = 0;    ///< `micros()` of the last reading
+  uint32_t snapshot_generation = 0; ///< Count of readings taken
+  uint32_t snapshot_max_age_us = 0; ///< Longest time to reuse a reading
+  uint8_t snapshot_sensors = 0;     ///< Sensors in the last reading
+
+  bool warm_start = false;       ///< Try to keep the chip's state in `begin`
+  bool warm_started = false;     ///< Did the last `begin` skip the reset
+  uint32_t startup_begin_us = 0; ///< `micros()` when `begin` started
+  uint32_t startup_us = 0;       ///< How long the last `begin` took
+
+  uint8_t current_bank = 0xFF;      ///< Active register bank, 0xFF if unknown
+  uint32_t bank_writes_issued = 0;  ///< REG_BANK_SEL writes sent to the chip
+  uint32_t bank_writes_skipped = 0; ///< REG_BANK_SEL writes avoided by caching
   // virtual void _setBank(uint8_t bank_number);
-  void _setBank(uint8_t bank_number);
+  void _setBank(uint8_t bank_number ICM20X_BUS_SITE_PARAM);
+
+  bool readRegisters(uint8_t reg, uint8_t *buffer, uint8_t len,
+                     icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                         ICM20X_BUS_SITE_PARAM);
+  bool writeRegisters(uint8_t reg, const uint8_t *buffer, uint8_t len,
+                      icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                          ICM20X_BUS_SITE_PARAM);
+  uint8_t readRegister(uint8_t reg, icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                                        ICM20X_BUS_SITE_PARAM);
+  bool writeRegister(uint8_t reg, uint8_t value,
+                     icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                         ICM20X_BUS_SITE_PARAM);
+  uint8_t readRegisterBits(uint8_t reg, uint8_t bits, uint8_t shift,
+                           icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                               ICM20X_BUS_SITE_PARAM);
+  bool writeRegisterBits(uint8_t reg, uint8_t bits, uint8_t shift,
+                         uint8_t value,
+                         icm20x_bus_op_t op = ICM20X_BUS_OP_CONFIG
+                             ICM20X_BUS_SITE_PARAM);
+
+  uint8_t readConfig(uint8_t bank, uint8_t reg);
+  bool writeConfig(uint8_t bank, uint8_t reg, uint8_t value);
+  uint8_t readConfigBits(uint8_t bank, uint8_t reg, uint8_t bits,
+                         uint8_t shift);
+  bool writeConfigBits(uint8_t bank, uint8_t reg, uint8_t bits, uint8_t shift,
+                       uint8_t value);
+
+  uint8_t auxQueueSpace(void);
+  bool finishAuxTransactions(void);
+
+  uint32_t fifo_overflows = 0; ///< Number of FIFO overflows seen
 
   uint8_t readAccelRange(void);
   void writeAccelRange(uint8_t new_accel_range);
@@ -282,6 +675,9 @@ protected:
   uint8_t readGyroRange(void);
   void writeGyroRange(uint8_t new_gyro_range);
 
+  virtual bool powerMag(bool enable);
+  virtual bool dmpOwnsFIFO(void);
+
 private:
   friend class Adafruit_ICM20X_Accelerometer; ///< Gives access to private
                                               ///< members to Accelerometer
@@ -295,12 +691,68 @@ private:
   friend class Adafruit_ICM20X_Temp; ///< Gives access to private members to
                                      ///< Temp data object
 
+  friend class Adafruit_ICM20X_Recorder; ///< Gives access to the ranges and
+                                         ///< last reading to the log recorder
+
+  uint8_t fifo_frame_size = 0;     ///< Bytes per FIFO frame, 0 when disabled
+  int16_t fifo_mag[3] = {0, 0, 0}; ///< Last magnetometer reading in the FIFO
+  void decodeFIFOFrame(const uint8_t *buffer, icm20x_raw_sample_t *sample);
+
+  uint8_t shadow_regs[ICM20X_SHADOW_SIZE];            ///< Register copies
+  uint8_t shadow_valid[(ICM20X_SHADOW_SIZE + 7) / 8]; ///< Copies known good
+  uint8_t shadow_dirty[(ICM20X_SHADOW_SIZE + 7) / 8]; ///< Copies to write
+  uint8_t config_depth = 0;                           ///< Nesting of `beginConfig` calls
+  void applyResetDefaults(void);
+  void discardUnchanged(const uint8_t *chip_regs);
+  void waitForData(void);
+
+#ifdef ICM20X_BUS_STATS
+  icm20x_bus_stats_t bus_stats; ///< Running bus statistics
+  void recordBusOp(icm20x_bus_op_t op, const char *site, uint8_t bytes,
+                   uint32_t elapsed_us);
+#endif
+  void fillRawSample(icm20x_raw_sample_t *sample);
+
+  volatile uint8_t int_count = 0;    ///< Interrupts seen by the ISR
+  uint8_t int_serviced = 0;          ///< `int_count` when last serviced
+  void (*int_callback)(void) = NULL; ///< Called from `handleInterrupt`
+
+  uint8_t int_sources = 0;              ///< Enabled interrupt sources
+  volatile uint32_t int_edge_us = 0;    ///< `micros()` of the last interrupt
+  volatile bool int_edge_valid = false; ///< Has `int_edge_us` been set
+
   void fillAccelEvent(sensors_event_t *accel, uint32_t timestamp);
   void fillGyroEvent(sensors_event_t *gyro, uint32_t timestamp);
   void fillTempEvent(sensors_event_t *temp, uint32_t timestamp);
   void fillMagEvent(sensors_event_t *mag, uint32_t timestamp);
   uint8_t auxillaryRegisterTransaction(bool read, uint8_t slv_addr,
                                        uint8_t reg_addr, uint8_t value = -1);
+
+  /** One queued auxillary I2C master operation */
+  typedef struct {
+    uint8_t type;     ///< read, write, delay or master reset
+    uint8_t slv_addr; ///< 7-bit address of the device on the aux bus
+    uint8_t reg_addr; ///< Register to read or write
+    uint8_t value;    ///< Byte to write
+    uint32_t wait_us; ///< Time to wait for a delay
+  } aux_op_t;
+
+  aux_op_t aux_queue[ICM20X_AUX_QUEUE_LEN]; ///< Pending aux operations
+
+  uint8_t aux_head = 0;       ///< Index of the operation in progress
+  uint8_t aux_count = 0;      ///< Number of queued operations
+  bool aux_started = false;   ///< Has the head operation been started
+  uint8_t aux_polls = 0;      ///< Status reads for the head operation
+  uint32_t aux_start_us = 0;  ///< `micros()` when the head op started
+  uint8_t aux_read_value = 0; ///< Last byte read from the aux bus
+
+  icm20x_aux_status_t aux_status = ICM20X_AUX_IDLE; ///< Result of the queue
+  icm20x_aux_callback_t aux_callback = NULL;        ///< Completion callback
+
+  bool queueAuxOp(uint8_t type, uint8_t slv_addr, uint8_t reg_addr,
+                  uint8_t value, uint32_t wait_us);
+  bool startAuxOp(aux_op_t *op);
+  void finishAuxOp(bool success);
 };
 
 #endif
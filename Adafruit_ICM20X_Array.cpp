@@ -0,0 +1,107 @@
+/*!
+ *  @file Adafruit_ICM20X_Array.cpp
+ *
+ *  Reads a group of ICM20X sensors, possibly spread over several buses, one
+ *  after another into one frame per tick, with the time of each sample
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Arduino.h"
+
+#include "Adafruit_ICM20X_Array.h"
+
+/*!
+ *    @brief  Instantiates an empty sensor array
+ */
+Adafruit_ICM20X_Array::Adafruit_ICM20X_Array(void) {}
+
+/*!
+ *    @brief  Add a sensor to the array. The sensor must already have been
+ *            set up with one of its `begin` methods and must outlive the array
+ *    @param  device
+ *            The sensor to add
+ *    @return True if the sensor was added, false if the array is full
+ */
+bool Adafruit_ICM20X_Array::addDevice(Adafruit_ICM20X *device) {
+  if (!device || count >= ICM20X_ARRAY_MAX_DEVICES) {
+    return false;
+  }
+
+  devices[count] = device;
+  count++;
+  return true;
+}
+
+/*!
+ *    @brief  Get the number of sensors in the array
+ *    @return The sensor count
+ */
+uint8_t Adafruit_ICM20X_Array::getDeviceCount(void) { return count; }
+
+/*!
+ *    @brief  Get one of the sensors in the array
+ *    @param  index
+ *            The sensor's index, in the order they were added
+ *    @return The sensor, or NULL if the index is out of range
+ */
+Adafruit_ICM20X *Adafruit_ICM20X_Array::getDevice(uint8_t index) {
+  if (index >= count) {
+    return NULL;
+  }
+  return devices[index];
+}
+
+/*!
+ *    @brief  Get the fixed point scale factors for one sensor's samples
+ *    @param  index
+ *            The sensor's index, in the order they were added
+ *    @param  scale
+ *            Where to store the scale factors
+ */
+void Adafruit_ICM20X_Array::getFixedScale(uint8_t index,
+                                          icm20x_fixed_scale_t *scale) {
+  if (index >= count) {
+    memset(scale, 0, sizeof(icm20x_fixed_scale_t));
+    return;
+  }
+  devices[index]->getFixedScale(scale);
+}
+
+/*!
+ *    @brief  Read one sample from every sensor into a frame. The sensors are
+ *            read one after another, each with a single burst of its data
+ *            registers, even if its FIFO is enabled. When each sample was
+ *            taken is recorded in `offset_us`
+ *    @param  frame
+ *            Where to store the samples
+ *    @return True if every sensor was read, false if any read failed. The
+ *            `valid` bits say which ones succeeded
+ */
+bool Adafruit_ICM20X_Array::read(icm20x_array_frame_t *frame) {
+  frame->timestamp_us = micros();
+  frame->count = count;
+  frame->valid = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    icm20x_raw_sample_t sample;
+
+    if (devices[i]->readRaw(&sample)) {
+      frame->valid |= 1 << i;
+      frame->offset_us[i] =
+          (int32_t)(sample.timestamp_us - frame->timestamp_us);
+    } else {
+      memset(&sample, 0, sizeof(sample));
+      frame->offset_us[i] = 0;
+    }
+
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      frame->accel[axis][i] = sample.accel[axis];
+      frame->gyro[axis][i] = sample.gyro[axis];
+      frame->mag[axis][i] = sample.mag[axis];
+    }
+    frame->temperature[i] = sample.temperature;
+  }
+
+  return frame->valid == (uint8_t)((1 << count) - 1);
+}
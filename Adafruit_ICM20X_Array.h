@@ -0,0 +1,70 @@
+/*!
+ *  @file Adafruit_ICM20X_Array.h
+ *
+ * 	Reads a group of ICM20X sensors, possibly spread over several buses, one
+ * 	after another into one frame per tick, with the time of each sample
+ *
+ * 	This is a library for the Adafruit ICM20X breakouts:
+ * 	https://www.adafruit.com/product/4464
+ * 	https://www.adafruit.com/product/4554
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_ICM20X_ARRAY_H
+#define _ADAFRUIT_ICM20X_ARRAY_H
+
+#include "Adafruit_ICM20X.h"
+
+#define ICM20X_ARRAY_MAX_DEVICES                                               \
+  8 ///< Most sensors one `Adafruit_ICM20X_Array` can manage
+
+/** One tick of raw samples for every device in an array, stored as a
+ * structure of arrays indexed by device so all devices can be processed in a
+ * single pass. Use `Adafruit_ICM20X_Array::getFixedScale` to scale them, and
+ * `offset_us` to align them in time */
+typedef struct {
+  uint32_t timestamp_us; ///< `micros()` when the tick started
+  uint8_t count;         ///< Number of devices in the frame
+  uint8_t valid;         ///< Bit per device, set if its read succeeded
+
+  /** When each device's sample was taken, relative to `timestamp_us`. This
+   * is the start of its read, or its data ready edge if it handles data ready
+   * interrupts, which can be before the tick. 0 if the read failed */
+  int32_t offset_us[ICM20X_ARRAY_MAX_DEVICES];
+
+  int16_t accel[3][ICM20X_ARRAY_MAX_DEVICES];    ///< Raw accel [axis][device]
+  int16_t gyro[3][ICM20X_ARRAY_MAX_DEVICES];     ///< Raw gyro [axis][device]
+  int16_t mag[3][ICM20X_ARRAY_MAX_DEVICES];      ///< Raw mag [axis][device]
+  int16_t temperature[ICM20X_ARRAY_MAX_DEVICES]; ///< Raw temperature
+} icm20x_array_frame_t;
+
+/*!
+ *    @brief  Class that reads a group of already initialized ICM20X sensors
+ *            into frames. The sensors are read one at a time in the order
+ *            they were added, each with one blocking data burst, so the
+ *            samples in a frame are skewed by the read times; `offset_us`
+ *            records by how much
+ */
+class Adafruit_ICM20X_Array {
+public:
+  Adafruit_ICM20X_Array(void);
+
+  bool addDevice(Adafruit_ICM20X *device);
+  uint8_t getDeviceCount(void);
+  Adafruit_ICM20X *getDevice(uint8_t index);
+  void getFixedScale(uint8_t index, icm20x_fixed_scale_t *scale);
+
+  bool read(icm20x_array_frame_t *frame);
+
+private:
+  Adafruit_ICM20X *devices[ICM20X_ARRAY_MAX_DEVICES]; ///< Managed sensors
+  uint8_t count = 0;                                  ///< Number of sensors
+};
+
+#endif
@@ -0,0 +1,558 @@
+/*!
+ *  @file Adafruit_ICM20X_Fusion.cpp
+ *
+ *  Mahony and Madgwick orientation filters fed directly with raw ICM20X
+ *  samples
+ *
+ *  The filters follow Sebastian Madgwick's reference implementations of his
+ *  own filter and of Robert Mahony's. Accelerometer and magnetometer readings
+ *  are only used as directions, so they are normalized straight from their
+ *  raw values; only the gyro needs scaling to rad/s.
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Arduino.h"
+
+#include "Adafruit_ICM20X_Fusion.h"
+
+// Only a new, valid magnetometer reading is worth a correction step; most
+// samples repeat the last one
+static inline bool newMag(const icm20x_raw_sample_t *sample) {
+  return (sample->flags &
+          (ICM20X_SAMPLE_MAG_NEW | ICM20X_SAMPLE_MAG_OVERFLOW)) ==
+         ICM20X_SAMPLE_MAG_NEW;
+}
+
+#ifdef ICM20X_FUSION_FIXED
+#define FUSION_ONE ((int32_t)1 << ICM20X_FUSION_Q_BITS)
+#define FUSION_HALF ((int32_t)1 << (ICM20X_FUSION_Q_BITS - 1))
+
+// Multiply two values with ICM20X_FUSION_Q_BITS fractional bits
+static inline int32_t qmul(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b) >> ICM20X_FUSION_Q_BITS);
+}
+
+// Integer square root, rounded down
+static uint32_t isqrt(uint64_t x) {
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit) {
+    if (x >= result + bit) {
+      x -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+// Scale a raw vector to unit length with ICM20X_FUSION_Q_BITS fractional bits.
+// Returns false for a zero vector
+static bool unitVector(int32_t x, int32_t y, int32_t z, int32_t *out) {
+  uint32_t norm = isqrt((uint64_t)((int64_t)x * x + (int64_t)y * y +
+                                   (int64_t)z * z));
+  if (!norm) {
+    return false;
+  }
+  out[0] = (int64_t)x * FUSION_ONE / norm;
+  out[1] = (int64_t)y * FUSION_ONE / norm;
+  out[2] = (int64_t)z * FUSION_ONE / norm;
+  return true;
+}
+#else
+// Scale a vector to unit length. Returns false for a zero vector
+static bool unitVector(float x, float y, float z, float *out) {
+  float norm_sq = x * x + y * y + z * z;
+  if (norm_sq == 0.0f) {
+    return false;
+  }
+  float recip = 1.0f / sqrtf(norm_sq);
+  out[0] = x * recip;
+  out[1] = y * recip;
+  out[2] = z * recip;
+  return true;
+}
+#endif
+
+/*!
+ *    @brief  Instantiates an orientation filter. Call `setScale` before the
+ *            first update
+ *    @param  algorithm
+ *            The filter to run
+ */
+Adafruit_ICM20X_Fusion::Adafruit_ICM20X_Fusion(
+    icm20x_fusion_algorithm_t algorithm) {
+  this->algorithm = algorithm;
+  setMahonyGains(0.5, 0.0);
+#ifndef ICM20X_FUSION_FIXED
+  setMadgwickBeta(0.1);
+#endif
+  reset();
+}
+
+/*!
+ *    @brief  Set the gyro scale to use, from the sensor's current range. Call
+ *            again whenever the gyro range changes
+ *    @param  scale
+ *            The scale factors from `Adafruit_ICM20X::getFixedScale`
+ */
+void Adafruit_ICM20X_Fusion::setScale(const icm20x_fixed_scale_t *scale) {
+#ifdef ICM20X_FUSION_FIXED
+  gyro_scale = scale->gyro;
+#else
+  gyro_scale = (float)scale->gyro / (1UL << ICM20X_SCALE_Q_BITS);
+#endif
+}
+
+/*!
+ *    @brief  Set the Mahony filter's feedback gains
+ *    @param  kp
+ *            Proportional gain; higher trusts the accelerometer and
+ *            magnetometer more. Defaults to 0.5
+ *    @param  ki
+ *            Integral gain, which learns the gyro bias. Defaults to 0
+ */
+void Adafruit_ICM20X_Fusion::setMahonyGains(float kp, float ki) {
+#ifdef ICM20X_FUSION_FIXED
+  this->kp = kp * (1L << ICM20X_FUSION_RATE_Q_BITS);
+  this->ki = ki * (1L << ICM20X_FUSION_RATE_Q_BITS);
+#else
+  this->kp = kp;
+  this->ki = ki;
+#endif
+}
+
+#ifndef ICM20X_FUSION_FIXED
+/*!
+ *    @brief  Set the Madgwick filter's gain
+ *    @param  beta
+ *            How fast to correct gyro drift; higher trusts the accelerometer
+ *            and magnetometer more. Defaults to 0.1
+ */
+void Adafruit_ICM20X_Fusion::setMadgwickBeta(float beta) { this->beta = beta; }
+#endif
+
+/*!
+ *    @brief  Go back to the starting orientation and forget the timing of
+ *            the last sample
+ */
+void Adafruit_ICM20X_Fusion::reset(void) {
+#ifdef ICM20X_FUSION_FIXED
+  q[0] = FUSION_ONE;
+#else
+  q[0] = 1.0f;
+#endif
+  q[1] = q[2] = q[3] = 0;
+  integral[0] = integral[1] = integral[2] = 0;
+  have_last = false;
+  update_count = 0;
+}
+
+/*!
+ *    @brief  Update the orientation with one raw sample. The time step comes
+ *            from the sample timestamps; the first sample after `reset`, or
+ *            after a gap longer than `ICM20X_FUSION_MAX_DT_US`, only starts
+ *            the timing. The magnetometer is only used when the sample's
+ *            `ICM20X_SAMPLE_MAG_NEW` flag is set, so 6 axis samples from the
+ *            ICM20649 work too
+ *    @param  sample
+ *            The sample, from `readRaw` or a FIFO ring
+ */
+void Adafruit_ICM20X_Fusion::update(const icm20x_raw_sample_t *sample) {
+  uint32_t dt_us = sample->timestamp_us - last_us;
+  bool had_last = have_last;
+  last_us = sample->timestamp_us;
+  have_last = true;
+  if (!had_last || dt_us == 0 || dt_us > ICM20X_FUSION_MAX_DT_US) {
+    return;
+  }
+
+#ifdef ICM20X_FUSION_FIXED
+  mahonyFixed(sample, dt_us);
+#else
+  float dt = dt_us * 1e-6f;
+  if (algorithm == ICM20X_FUSION_MADGWICK) {
+    madgwick(sample, dt);
+  } else {
+    mahony(sample, dt);
+  }
+#endif
+  update_count++;
+}
+
+/*!
+ *    @brief  Update the orientation with every sample waiting in a ring, such
+ *            as one filled by `Adafruit_ICM20X::readFIFO`, and time the batch
+ *            for `getUpdateMicros`
+ *    @param  ring
+ *            The ring to drain
+ *    @param  max_samples
+ *            The most samples to use in this call
+ *    @return The number of samples used
+ */
+uint16_t Adafruit_ICM20X_Fusion::update(Adafruit_ICM20X_SampleRing *ring,
+                                        uint16_t max_samples) {
+  icm20x_raw_sample_t sample;
+  uint16_t count = 0;
+
+  uint32_t start_us = micros();
+  while (count < max_samples && ring->pop(&sample)) {
+    update(&sample);
+    count++;
+  }
+  if (count) {
+    update_us = (micros() - start_us) / count;
+  }
+  return count;
+}
+
+/*!
+ *    @brief  Get the current orientation
+ *    @param  w
+ *            Where to store the real part
+ *    @param  x
+ *            Where to store the X component
+ *    @param  y
+ *            Where to store the Y component
+ *    @param  z
+ *            Where to store the Z component
+ */
+void Adafruit_ICM20X_Fusion::getQuaternion(float *w, float *x, float *y,
+                                           float *z) {
+#ifdef ICM20X_FUSION_FIXED
+  const float scale = 1.0f / FUSION_ONE;
+#else
+  const float scale = 1.0f;
+#endif
+  *w = q[0] * scale;
+  *x = q[1] * scale;
+  *y = q[2] * scale;
+  *z = q[3] * scale;
+}
+
+#ifdef ICM20X_FUSION_FIXED
+/*!
+ *    @brief  Get the current orientation without any floating point math
+ *    @param  w
+ *            Where to store the real part, with `ICM20X_FUSION_Q_BITS`
+ *            fractional bits
+ *    @param  x
+ *            Where to store the X component
+ *    @param  y
+ *            Where to store the Y component
+ *    @param  z
+ *            Where to store the Z component
+ */
+void Adafruit_ICM20X_Fusion::getQuaternionFixed(int32_t *w, int32_t *x,
+                                                int32_t *y, int32_t *z) {
+  *w = q[0];
+  *x = q[1];
+  *y = q[2];
+  *z = q[3];
+}
+#endif
+
+/*!
+ *    @brief  Get the current orientation as aerospace sequence Euler angles
+ *    @param  roll
+ *            Where to store the rotation about X, in radians
+ *    @param  pitch
+ *            Where to store the rotation about Y, in radians
+ *    @param  yaw
+ *            Where to store the rotation about Z, in radians
+ */
+void Adafruit_ICM20X_Fusion::getEuler(float *roll, float *pitch, float *yaw) {
+  float w, x, y, z;
+  getQuaternion(&w, &x, &y, &z);
+
+  *roll = atan2f(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+  float sin_pitch = 2 * (w * y - z * x);
+  if (sin_pitch > 1) {
+    sin_pitch = 1;
+  } else if (sin_pitch < -1) {
+    sin_pitch = -1;
+  }
+  *pitch = asinf(sin_pitch);
+  *yaw = atan2f(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+}
+
+/*!
+ *    @brief  Get the number of samples integrated since `reset`
+ *    @return The update count
+ */
+uint32_t Adafruit_ICM20X_Fusion::getUpdateCount(void) { return update_count; }
+
+/*!
+ *    @brief  Get the measured cost of one update, averaged over the last
+ *            batch passed to `update(Adafruit_ICM20X_SampleRing *)`. Per
+ *            update the float Mahony filter does one square root without the
+ *            magnetometer and three with it; Madgwick does two and four. The
+ *            fixed point filter does the same number of integer square roots
+ *            and no floating point math
+ *    @return The time per update in microseconds
+ */
+uint32_t Adafruit_ICM20X_Fusion::getUpdateMicros(void) { return update_us; }
+
+#ifdef ICM20X_FUSION_FIXED
+/*!
+ *    @brief  One step of the Mahony filter in fixed point. Unit vectors and
+ *            the quaternion have `ICM20X_FUSION_Q_BITS` fractional bits and
+ *            rates `ICM20X_FUSION_RATE_Q_BITS`
+ *    @param  sample
+ *            The raw sample
+ *    @param  dt_us
+ *            Time since the last sample in microseconds
+ */
+void Adafruit_ICM20X_Fusion::mahonyFixed(const icm20x_raw_sample_t *sample,
+                                         uint32_t dt_us) {
+  const uint8_t rate_shift = ICM20X_SCALE_Q_BITS - ICM20X_FUSION_RATE_Q_BITS;
+  int32_t g[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    g[i] = ((int64_t)sample->gyro[i] * gyro_scale) >> rate_shift;
+  }
+
+  int32_t a[3], m[3];
+  int32_t half_e[3] = {0, 0, 0};
+  if (unitVector(sample->accel[0], sample->accel[1], sample->accel[2], a)) {
+    int32_t q0q0 = qmul(q[0], q[0]), q0q1 = qmul(q[0], q[1]),
+            q0q2 = qmul(q[0], q[2]), q0q3 = qmul(q[0], q[3]),
+            q1q1 = qmul(q[1], q[1]), q1q2 = qmul(q[1], q[2]),
+            q1q3 = qmul(q[1], q[3]), q2q2 = qmul(q[2], q[2]),
+            q2q3 = qmul(q[2], q[3]), q3q3 = qmul(q[3], q[3]);
+
+    // the AK09916's Y and Z axes point the other way to the accel and gyro
+    if (newMag(sample) &&
+        unitVector(sample->mag[0], -sample->mag[1], -sample->mag[2], m)) {
+      // reference direction of Earth's magnetic field
+      int32_t hx = 2 * (qmul(m[0], FUSION_HALF - q2q2 - q3q3) +
+                        qmul(m[1], q1q2 - q0q3) + qmul(m[2], q1q3 + q0q2));
+      int32_t hy = 2 * (qmul(m[0], q1q2 + q0q3) +
+                        qmul(m[1], FUSION_HALF - q1q1 - q3q3) +
+                        qmul(m[2], q2q3 - q0q1));
+      int32_t bx = isqrt((uint64_t)((int64_t)hx * hx + (int64_t)hy * hy));
+      int32_t bz = 2 * (qmul(m[0], q1q3 - q0q2) + qmul(m[1], q2q3 + q0q1) +
+                        qmul(m[2], FUSION_HALF - q1q1 - q2q2));
+
+      // estimated direction of the field, and its error
+      int32_t half_w[3] = {
+          qmul(bx, FUSION_HALF - q2q2 - q3q3) + qmul(bz, q1q3 - q0q2),
+          qmul(bx, q1q2 - q0q3) + qmul(bz, q0q1 + q2q3),
+          qmul(bx, q0q2 + q1q3) + qmul(bz, FUSION_HALF - q1q1 - q2q2)};
+      half_e[0] += qmul(m[1], half_w[2]) - qmul(m[2], half_w[1]);
+      half_e[1] += qmul(m[2], half_w[0]) - qmul(m[0], half_w[2]);
+      half_e[2] += qmul(m[0], half_w[1]) - qmul(m[1], half_w[0]);
+    }
+
+    // estimated direction of gravity, and its error
+    int32_t half_v[3] = {q1q3 - q0q2, q0q1 + q2q3, q0q0 - FUSION_HALF + q3q3};
+    half_e[0] += qmul(a[1], half_v[2]) - qmul(a[2], half_v[1]);
+    half_e[1] += qmul(a[2], half_v[0]) - qmul(a[0], half_v[2]);
+    half_e[2] += qmul(a[0], half_v[1]) - qmul(a[1], half_v[0]);
+
+    for (uint8_t i = 0; i < 3; i++) {
+      if (ki > 0) {
+        integral[i] += ((2 * (int64_t)ki * half_e[i]) >> ICM20X_FUSION_Q_BITS) *
+                       dt_us / 1000000;
+        g[i] += integral[i];
+      }
+      g[i] += (2 * (int64_t)kp * half_e[i]) >> ICM20X_FUSION_Q_BITS;
+    }
+  }
+
+  // half the rotation over the time step, as a unit vector scaled quaternion
+  const uint8_t angle_shift = ICM20X_FUSION_Q_BITS - ICM20X_FUSION_RATE_Q_BITS;
+  for (uint8_t i = 0; i < 3; i++) {
+    g[i] = (int64_t)g[i] * dt_us * (1 << angle_shift) / 2000000;
+  }
+  int32_t qa = q[0], qb = q[1], qc = q[2];
+  q[0] += -qmul(qb, g[0]) - qmul(qc, g[1]) - qmul(q[3], g[2]);
+  q[1] += qmul(qa, g[0]) + qmul(qc, g[2]) - qmul(q[3], g[1]);
+  q[2] += qmul(qa, g[1]) - qmul(qb, g[2]) + qmul(q[3], g[0]);
+  q[3] += qmul(qa, g[2]) + qmul(qb, g[1]) - qmul(qc, g[0]);
+
+  uint32_t norm = isqrt((uint64_t)((int64_t)q[0] * q[0] + (int64_t)q[1] * q[1] +
+                                   (int64_t)q[2] * q[2] + (int64_t)q[3] * q[3]));
+  for (uint8_t i = 0; i < 4; i++) {
+    q[i] = (int64_t)q[i] * FUSION_ONE / norm;
+  }
+}
+#else
+/*!
+ *    @brief  One step of the Mahony filter
+ *    @param  sample
+ *            The raw sample
+ *    @param  dt
+ *            Time since the last sample in seconds
+ */
+void Adafruit_ICM20X_Fusion::mahony(const icm20x_raw_sample_t *sample,
+                                    float dt) {
+  float g[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    g[i] = sample->gyro[i] * gyro_scale;
+  }
+
+  float a[3], m[3];
+  float half_e[3] = {0, 0, 0};
+  if (unitVector(sample->accel[0], sample->accel[1], sample->accel[2], a)) {
+    float q0q0 = q[0] * q[0], q0q1 = q[0] * q[1], q0q2 = q[0] * q[2],
+          q0q3 = q[0] * q[3], q1q1 = q[1] * q[1], q1q2 = q[1] * q[2],
+          q1q3 = q[1] * q[3], q2q2 = q[2] * q[2], q2q3 = q[2] * q[3],
+          q3q3 = q[3] * q[3];
+
+    // the AK09916's Y and Z axes point the other way to the accel and gyro
+    if (newMag(sample) &&
+        unitVector(sample->mag[0], -sample->mag[1], -sample->mag[2], m)) {
+      // reference direction of Earth's magnetic field
+      float hx = 2 * (m[0] * (0.5f - q2q2 - q3q3) + m[1] * (q1q2 - q0q3) +
+                      m[2] * (q1q3 + q0q2));
+      float hy = 2 * (m[0] * (q1q2 + q0q3) + m[1] * (0.5f - q1q1 - q3q3) +
+                      m[2] * (q2q3 - q0q1));
+      float bx = sqrtf(hx * hx + hy * hy);
+      float bz = 2 * (m[0] * (q1q3 - q0q2) + m[1] * (q2q3 + q0q1) +
+                      m[2] * (0.5f - q1q1 - q2q2));
+
+      // estimated direction of the field, and its error
+      float half_w[3] = {bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2),
+                         bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3),
+                         bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2)};
+      half_e[0] += m[1] * half_w[2] - m[2] * half_w[1];
+      half_e[1] += m[2] * half_w[0] - m[0] * half_w[2];
+      half_e[2] += m[0] * half_w[1] - m[1] * half_w[0];
+    }
+
+    // estimated direction of gravity, and its error
+    float half_v[3] = {q1q3 - q0q2, q0q1 + q2q3, q0q0 - 0.5f + q3q3};
+    half_e[0] += a[1] * half_v[2] - a[2] * half_v[1];
+    half_e[1] += a[2] * half_v[0] - a[0] * half_v[2];
+    half_e[2] += a[0] * half_v[1] - a[1] * half_v[0];
+
+    for (uint8_t i = 0; i < 3; i++) {
+      if (ki > 0) {
+        integral[i] += 2 * ki * half_e[i] * dt;
+        g[i] += integral[i];
+      }
+      g[i] += 2 * kp * half_e[i];
+    }
+  }
+
+  for (uint8_t i = 0; i < 3; i++) {
+    g[i] *= 0.5f * dt;
+  }
+  float qa = q[0], qb = q[1], qc = q[2];
+  q[0] += -qb * g[0] - qc * g[1] - q[3] * g[2];
+  q[1] += qa * g[0] + qc * g[2] - q[3] * g[1];
+  q[2] += qa * g[1] - qb * g[2] + q[3] * g[0];
+  q[3] += qa * g[2] + qb * g[1] - qc * g[0];
+
+  float recip =
+      1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  for (uint8_t i = 0; i < 4; i++) {
+    q[i] *= recip;
+  }
+}
+
+/*!
+ *    @brief  One step of the Madgwick filter
+ *    @param  sample
+ *            The raw sample
+ *    @param  dt
+ *            Time since the last sample in seconds
+ */
+void Adafruit_ICM20X_Fusion::madgwick(const icm20x_raw_sample_t *sample,
+                                      float dt) {
+  float gx = sample->gyro[0] * gyro_scale, gy = sample->gyro[1] * gyro_scale,
+        gz = sample->gyro[2] * gyro_scale;
+  float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+  // rate of change of the quaternion from the gyro
+  float dq0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float dq1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float dq2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float dq3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  float a[3], m[3];
+  if (unitVector(sample->accel[0], sample->accel[1], sample->accel[2], a)) {
+    float ax = a[0], ay = a[1], az = a[2];
+    float s0, s1, s2, s3;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+    float _2q0 = 2 * q0, _2q1 = 2 * q1, _2q2 = 2 * q2, _2q3 = 2 * q3;
+
+    // the AK09916's Y and Z axes point the other way to the accel and gyro
+    if (newMag(sample) &&
+        unitVector(sample->mag[0], -sample->mag[1], -sample->mag[2], m)) {
+      float mx = m[0], my = m[1], mz = m[2];
+      float _2q0mx = 2 * q0 * mx, _2q0my = 2 * q0 * my, _2q0mz = 2 * q0 * mz,
+            _2q1mx = 2 * q1 * mx;
+      float _2q0q2 = 2 * q0 * q2, _2q2q3 = 2 * q2 * q3;
+      float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3, q1q2 = q1 * q2,
+            q1q3 = q1 * q3, q2q3 = q2 * q3;
+
+      // reference direction of Earth's magnetic field
+      float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 +
+                 _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+      float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 -
+                 my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+      float _2bx = sqrtf(hx * hx + hy * hy);
+      float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 -
+                   mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+      float _4bx = 2 * _2bx, _4bz = 2 * _2bz;
+
+      // objective function errors for gravity and the field
+      float fa0 = 2 * q1q3 - _2q0q2 - ax;
+      float fa1 = 2 * q0q1 + _2q2q3 - ay;
+      float fa2 = 1 - 2 * q1q1 - 2 * q2q2 - az;
+      float fm0 = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+      float fm1 = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+      float fm2 = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+      // gradient of the objective function
+      s0 = -_2q2 * fa0 + _2q1 * fa1 - _2bz * q2 * fm0 +
+           (-_2bx * q3 + _2bz * q1) * fm1 + _2bx * q2 * fm2;
+      s1 = _2q3 * fa0 + _2q0 * fa1 - 4 * q1 * fa2 + _2bz * q3 * fm0 +
+           (_2bx * q2 + _2bz * q0) * fm1 + (_2bx * q3 - _4bz * q1) * fm2;
+      s2 = -_2q0 * fa0 + _2q3 * fa1 - 4 * q2 * fa2 +
+           (-_4bx * q2 - _2bz * q0) * fm0 + (_2bx * q1 + _2bz * q3) * fm1 +
+           (_2bx * q0 - _4bz * q2) * fm2;
+      s3 = _2q1 * fa0 + _2q2 * fa1 + (-_4bx * q3 + _2bz * q1) * fm0 +
+           (-_2bx * q0 + _2bz * q2) * fm1 + _2bx * q1 * fm2;
+    } else {
+      float _4q0 = 4 * q0, _4q1 = 4 * q1, _4q2 = 4 * q2, _8q1 = 8 * q1,
+            _8q2 = 8 * q2;
+
+      // gradient of the objective function for gravity alone
+      s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+      s1 = _4q1 * q3q3 - _2q3 * ax + 4 * q0q0 * q1 - _2q0 * ay - _4q1 +
+           _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+      s2 = 4 * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 +
+           _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+      s3 = 4 * q1q1 * q3 - _2q1 * ax + 4 * q2q2 * q3 - _2q2 * ay;
+    }
+
+    float norm_sq = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (norm_sq > 0) {
+      float recip = beta / sqrtf(norm_sq);
+      dq0 -= recip * s0;
+      dq1 -= recip * s1;
+      dq2 -= recip * s2;
+      dq3 -= recip * s3;
+    }
+  }
+
+  q0 += dq0 * dt;
+  q1 += dq1 * dt;
+  q2 += dq2 * dt;
+  q3 += dq3 * dt;
+
+  float recip = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q[0] = q0 * recip;
+  q[1] = q1 * recip;
+  q[2] = q2 * recip;
+  q[3] = q3 * recip;
+}
+#endif
@@ -0,0 +1,96 @@
+/*!
+ *  @file Adafruit_ICM20X_Fusion.h
+ *
+ * 	Mahony and Madgwick orientation filters fed directly with raw ICM20X
+ * 	samples
+ *
+ * 	This is a library for the Adafruit ICM20X breakouts:
+ * 	https://www.adafruit.com/product/4464
+ * 	https://www.adafruit.com/product/4554
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_ICM20X_FUSION_H
+#define _ADAFRUIT_ICM20X_FUSION_H
+
+#include "Adafruit_ICM20X.h"
+
+// Uncomment to build the integer only filter for boards without an FPU. Only
+// the Mahony filter is available in this build
+// #define ICM20X_FUSION_FIXED
+
+#define ICM20X_FUSION_Q_BITS                                                   \
+  28 ///< Fractional bits of the quaternion and unit vectors in fixed builds
+#define ICM20X_FUSION_RATE_Q_BITS                                              \
+  24 ///< Fractional bits of angular rates in rad/s in fixed builds
+#define ICM20X_FUSION_MAX_DT_US                                                \
+  500000 ///< Longer gaps between samples restart timing instead of integrating
+
+/** Orientation filters `Adafruit_ICM20X_Fusion` can run */
+typedef enum {
+  ICM20X_FUSION_MAHONY, ///< Mahony complementary filter, PI feedback
+#ifndef ICM20X_FUSION_FIXED
+  ICM20X_FUSION_MADGWICK, ///< Madgwick gradient descent filter
+#endif
+} icm20x_fusion_algorithm_t;
+
+/*!
+ *    @brief  Class that tracks orientation from raw ICM20X samples, using the
+ *            magnetometer when a sample has a new reading
+ */
+class Adafruit_ICM20X_Fusion {
+public:
+  Adafruit_ICM20X_Fusion(
+      icm20x_fusion_algorithm_t algorithm = ICM20X_FUSION_MAHONY);
+
+  void setScale(const icm20x_fixed_scale_t *scale);
+  void setMahonyGains(float kp, float ki);
+#ifndef ICM20X_FUSION_FIXED
+  void setMadgwickBeta(float beta);
+#endif
+  void reset(void);
+
+  void update(const icm20x_raw_sample_t *sample);
+  uint16_t update(Adafruit_ICM20X_SampleRing *ring,
+                  uint16_t max_samples = 0xFFFF);
+
+  void getQuaternion(float *w, float *x, float *y, float *z);
+#ifdef ICM20X_FUSION_FIXED
+  void getQuaternionFixed(int32_t *w, int32_t *x, int32_t *y, int32_t *z);
+#endif
+  void getEuler(float *roll, float *pitch, float *yaw);
+
+  uint32_t getUpdateCount(void);
+  uint32_t getUpdateMicros(void);
+
+private:
+  icm20x_fusion_algorithm_t algorithm; ///< Filter to run
+  uint32_t last_us = 0;                ///< Timestamp of the last sample
+  bool have_last = false;              ///< Is `last_us` set
+  uint32_t update_count = 0;           ///< Samples integrated since `reset`
+  uint32_t update_us = 0;              ///< Mean cost of the last batch
+
+#ifdef ICM20X_FUSION_FIXED
+  int32_t gyro_scale = 0;          ///< rad/s per LSB, Q30
+  int32_t q[4];                    ///< Orientation, Q28
+  int32_t kp = 0, ki = 0;          ///< Mahony gains, Q24
+  int32_t integral[3] = {0, 0, 0}; ///< Mahony integral error, Q24 rad/s
+  void mahonyFixed(const icm20x_raw_sample_t *sample, uint32_t dt_us);
+#else
+  float gyro_scale = 0;          ///< rad/s per LSB
+  float q[4];                    ///< Orientation quaternion
+  float kp = 0, ki = 0;          ///< Mahony gains
+  float integral[3] = {0, 0, 0}; ///< Mahony integral error
+  float beta = 0;                ///< Madgwick gain
+  void mahony(const icm20x_raw_sample_t *sample, float dt);
+  void madgwick(const icm20x_raw_sample_t *sample, float dt);
+#endif
+};
+
+#endif
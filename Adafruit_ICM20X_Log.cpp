@@ -0,0 +1,545 @@
+/*!
+ *  @file Adafruit_ICM20X_Log.cpp
+ *
+ *  Compact binary log of raw ICM20X samples, with a recorder that writes it
+ *  and a replay driver that reads it back through the normal driver API
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Arduino.h"
+
+#include "Adafruit_ICM20649.h"
+#include "Adafruit_ICM20948.h"
+#include "Adafruit_ICM20X_Log.h"
+
+#define LOG_SENSORS_MASK 0x0F  ///< Frame contents bits for the sensors
+#define LOG_FLAGS_SHIFT 4      ///< Frame contents shift for the sample flags
+#define LOG_FLAGS_MASK 0x30    ///< Frame contents bits for the sample flags
+#define LOG_ABSOLUTE_TIME 0x40 ///< Frame contents bit for an absolute time
+
+static constexpr uint8_t log_magic[4] = {'I', 'C', 'M', 'L'};
+
+static uint8_t putInt16(uint8_t *buffer, int16_t value) {
+  buffer[0] = value & 0xFF;
+  buffer[1] = (uint16_t)value >> 8;
+  return 2;
+}
+
+static int16_t getInt16(const uint8_t *buffer) {
+  return (int16_t)(buffer[0] | buffer[1] << 8);
+}
+
+/*!
+ *    @brief  Instantiates a recorder that writes to a stream
+ *    @param  sink
+ *            Where to write the log, such as `Serial` or an open SD file
+ */
+Adafruit_ICM20X_Recorder::Adafruit_ICM20X_Recorder(Print *sink) {
+  this->sink = sink;
+}
+
+/*!
+ *    @brief  Instantiates a recorder that writes to memory
+ *    @param  buffer
+ *            Where to write the log
+ *    @param  size
+ *            Bytes `buffer` can hold. Frames that do not fit are dropped
+ */
+Adafruit_ICM20X_Recorder::Adafruit_ICM20X_Recorder(uint8_t *buffer,
+                                                   uint32_t size) {
+  this->buffer = buffer;
+  buffer_size = size;
+}
+
+/*!
+ *    @brief  Start a new log of a sensor and write the stream header. By
+ *            default every sensor that is powered now is recorded
+ *    @param  device
+ *            The sensor to record. It must already have been set up with one
+ *            of its `begin` methods
+ *    @return True if the header was written
+ */
+bool Adafruit_ICM20X_Recorder::begin(Adafruit_ICM20X *device) {
+  this->device = device;
+  sensors = device->getPoweredSensors();
+  have_last = false;
+  frame_count = 0;
+  byte_count = 0;
+  dropped_count = 0;
+  pending_len = 0;
+
+  uint8_t header[ICM20X_LOG_HEADER_SIZE];
+  return write(header, encodeHeader(device->chip_id, header));
+}
+
+/*!
+ *    @brief  Choose which sensors' values go in each frame. Leaving out
+ *            sensors that are not needed makes the frames smaller
+ *    @param  sensors
+ *            A combination of `icm20x_sensor_t` values
+ */
+void Adafruit_ICM20X_Recorder::setSensors(uint8_t sensors) {
+  this->sensors = sensors & ICM20X_SENSOR_ALL;
+}
+
+/*!
+ *    @brief  Record the sensor's last reading, as taken by `getEvent`,
+ *            `readRaw` or one of the Unified Sensor objects
+ *    @return True if the frame was written
+ */
+bool Adafruit_ICM20X_Recorder::record(void) {
+  icm20x_raw_sample_t sample;
+  device->fillRawSample(&sample);
+  return record(&sample);
+}
+
+/*!
+ *    @brief  Record one raw sample, with the sensor's current ranges
+ *    @param  sample
+ *            The sample to record
+ *    @return True if the frame was written
+ */
+bool Adafruit_ICM20X_Recorder::record(const icm20x_raw_sample_t *sample) {
+  icm20x_log_frame_t frame;
+  frame.sample = *sample;
+  frame.sensors = sensors;
+  frame.accel_range = device->current_accel_range;
+  frame.gyro_range = device->current_gyro_range;
+
+  uint8_t encoded[ICM20X_LOG_MAX_FRAME_SIZE];
+  uint8_t len = encodeFrame(&frame, last_us, have_last, encoded);
+  if (!write(encoded, len)) {
+    dropped_count++;
+    return false;
+  }
+
+  last_us = sample->timestamp_us;
+  have_last = true;
+  frame_count++;
+  return true;
+}
+
+/*!
+ *    @brief  Record the samples in a ring, such as one filled by `readFIFO`.
+ *            The samples are removed from the ring
+ *    @param  ring
+ *            The ring to drain
+ *    @param  max_samples
+ *            Most samples to record
+ *    @return The number of samples taken from the ring, including any that
+ *            were dropped
+ */
+uint16_t Adafruit_ICM20X_Recorder::record(Adafruit_ICM20X_SampleRing *ring,
+                                          uint16_t max_samples) {
+  icm20x_raw_sample_t sample;
+  uint16_t count = 0;
+
+  while (count < max_samples && ring->pop(&sample)) {
+    record(&sample);
+    count++;
+  }
+  return count;
+}
+
+/*!
+ *    @brief  Get the number of frames written since `begin`
+ *    @return The frame count
+ */
+uint32_t Adafruit_ICM20X_Recorder::getFrameCount(void) { return frame_count; }
+
+/*!
+ *    @brief  Get the number of bytes written since `begin`, including the
+ *            header. When recording to memory this is the log's length
+ *    @return The byte count
+ */
+uint32_t Adafruit_ICM20X_Recorder::getByteCount(void) { return byte_count; }
+
+/*!
+ *    @brief  Get the number of frames that did not fit in the buffer or that
+ *            the stream did not accept
+ *    @return The dropped frame count
+ */
+uint32_t Adafruit_ICM20X_Recorder::getDroppedCount(void) {
+  return dropped_count;
+}
+
+/*!
+ *    @brief  Encode a stream header
+ *    @param  chip_id
+ *            The recorded chip's WHOAMI value
+ *    @param  buffer
+ *            Where to store the header, `ICM20X_LOG_HEADER_SIZE` bytes
+ *    @return The number of bytes stored
+ */
+uint8_t Adafruit_ICM20X_Recorder::encodeHeader(uint8_t chip_id,
+                                               uint8_t *buffer) {
+  memcpy(buffer, log_magic, sizeof(log_magic));
+  buffer[4] = ICM20X_LOG_VERSION;
+  buffer[5] = chip_id;
+  return ICM20X_LOG_HEADER_SIZE;
+}
+
+/*!
+ *    @brief  Encode one frame
+ *    @param  frame
+ *            The frame to encode
+ *    @param  last_us
+ *            Timestamp of the previous frame
+ *    @param  relative
+ *            True to store the time relative to `last_us` when it fits,
+ *            false for the first frame of a log
+ *    @param  buffer
+ *            Where to store the frame, up to `ICM20X_LOG_MAX_FRAME_SIZE`
+ *            bytes
+ *    @return The number of bytes stored
+ */
+uint8_t Adafruit_ICM20X_Recorder::encodeFrame(const icm20x_log_frame_t *frame,
+                                              uint32_t last_us, bool relative,
+                                              uint8_t *buffer) {
+  const icm20x_raw_sample_t *sample = &frame->sample;
+  uint32_t delta_us = sample->timestamp_us - last_us;
+  bool absolute = !relative || delta_us > 0xFFFF;
+
+  buffer[0] = (frame->sensors & LOG_SENSORS_MASK) |
+              ((sample->flags << LOG_FLAGS_SHIFT) & LOG_FLAGS_MASK) |
+              (absolute ? LOG_ABSOLUTE_TIME : 0);
+  buffer[1] = (frame->accel_range & 0x3) | (frame->gyro_range & 0x3) << 2;
+
+  uint8_t len = 2;
+  if (absolute) {
+    for (uint8_t i = 0; i < 4; i++) {
+      buffer[len++] = sample->timestamp_us >> (8 * i);
+    }
+  } else {
+    buffer[len++] = delta_us & 0xFF;
+    buffer[len++] = delta_us >> 8;
+  }
+
+  if (frame->sensors & ICM20X_SENSOR_ACCEL) {
+    for (uint8_t i = 0; i < 3; i++) {
+      len += putInt16(buffer + len, sample->accel[i]);
+    }
+  }
+  if (frame->sensors & ICM20X_SENSOR_GYRO) {
+    for (uint8_t i = 0; i < 3; i++) {
+      len += putInt16(buffer + len, sample->gyro[i]);
+    }
+  }
+  if (frame->sensors & ICM20X_SENSOR_TEMP) {
+    len += putInt16(buffer + len, sample->temperature);
+  }
+  if (frame->sensors & ICM20X_SENSOR_MAG) {
+    for (uint8_t i = 0; i < 3; i++) {
+      len += putInt16(buffer + len, sample->mag[i]);
+    }
+  }
+  return len;
+}
+
+/*!
+ *    @brief  Write out the rest of a frame the stream could only take part
+ *            of. `record` does this before each new frame; call it when
+ *            recording stops to finish the last one
+ *    @return True if no part of a frame is left to write
+ */
+bool Adafruit_ICM20X_Recorder::flush(void) {
+  if (!sink || !pending_len) {
+    return true;
+  }
+
+  size_t written = sink->write(pending, pending_len);
+  byte_count += written;
+  pending_len -= written;
+  memmove(pending, pending + written, pending_len);
+  return !pending_len;
+}
+
+/*!
+ *    @brief  Write bytes to the stream or buffer. A frame is only started if
+ *            the stream reports room for all of it, or all of it fits in the
+ *            buffer. If a stream still takes only part of it, the rest is
+ *            kept and written before the next frame, so frames never
+ *            interleave
+ *    @param  data
+ *            The bytes to write
+ *    @param  len
+ *            The number of bytes
+ *    @return True if the frame was written or will be finished by `flush`,
+ *            false if it was dropped
+ */
+bool Adafruit_ICM20X_Recorder::write(const uint8_t *data, uint8_t len) {
+  if (sink) {
+    if (!flush()) {
+      return false;
+    }
+    // the Print default of 0 means the stream doesn't know, so only a known
+    // shortfall drops the frame
+    int room = sink->availableForWrite();
+    if (room > 0 && room < len) {
+      return false;
+    }
+
+    size_t written = sink->write(data, len);
+    byte_count += written;
+    pending_len = len - written;
+    memcpy(pending, data + written, pending_len);
+    return true;
+  }
+
+  if (!buffer || byte_count + len > buffer_size) {
+    return false;
+  }
+  memcpy(buffer + byte_count, data, len);
+  byte_count += len;
+  return true;
+}
+
+/*!
+ *    @brief  Instantiates a replay driver with no log
+ */
+Adafruit_ICM20X_Replay::Adafruit_ICM20X_Replay(void) {}
+
+/*!
+ *    @brief  Start replaying a log
+ *    @param  log
+ *            The log, starting with its stream header. It must stay valid
+ *            while it is replayed
+ *    @param  len
+ *            Bytes in the log
+ *    @param  sensor_id
+ *            An optional parameter to set the sensor ids to differentiate
+ * similar sensors The passed value is assigned to the accelerometer and the
+ * gyro get +1, the magnetometer +2 and the temperature sensor +3.
+ *    @return True if the log has a header this library can replay
+ */
+bool Adafruit_ICM20X_Replay::begin(const uint8_t *log, uint32_t len,
+                                   int32_t sensor_id) {
+  uint8_t log_chip_id;
+  if (!decodeHeader(log, len, &log_chip_id)) {
+    return false;
+  }
+
+  if (log_chip_id == ICM20948_CHIP_ID) {
+    scale_table = &icm20948_scales;
+  } else if (log_chip_id == ICM20649_CHIP_ID) {
+    scale_table = &icm20649_scales;
+  } else {
+    return false;
+  }
+  chip_id = log_chip_id;
+
+  _sensorid_accel = sensor_id;
+  _sensorid_gyro = sensor_id + 1;
+  _sensorid_mag = sensor_id + 2;
+  _sensorid_temp = sensor_id + 3;
+
+  this->log = log;
+  log_len = len;
+  current_accel_range = 0;
+  current_gyro_range = 0;
+  updateScales();
+  rewind();
+  return true;
+}
+
+/*!
+ *    @brief  Go back to the first frame of the log
+ */
+void Adafruit_ICM20X_Replay::rewind(void) {
+  log_pos = ICM20X_LOG_HEADER_SIZE;
+  last_us = 0;
+  frame_count = 0;
+  snapshot_valid = false;
+}
+
+/*!
+ *    @brief  Check if every frame has been replayed
+ *    @return True if there are no more complete frames
+ */
+bool Adafruit_ICM20X_Replay::atEnd(void) {
+  icm20x_log_frame_t frame;
+  uint32_t time_us = last_us;
+  return !log ||
+         !decodeFrame(log + log_pos, log_len - log_pos, &time_us, &frame);
+}
+
+/*!
+ *    @brief  Get the number of frames replayed since `begin` or `rewind`
+ *    @return The frame count
+ */
+uint32_t Adafruit_ICM20X_Replay::getFrameCount(void) { return frame_count; }
+
+/*!
+ *    @brief  Check and decode a stream header
+ *    @param  buffer
+ *            The start of the log
+ *    @param  len
+ *            Bytes in the log
+ *    @param  chip_id
+ *            Where to store the recorded chip's WHOAMI value
+ *    @return True if the header is complete and its version is supported
+ */
+bool Adafruit_ICM20X_Replay::decodeHeader(const uint8_t *buffer, uint32_t len,
+                                          uint8_t *chip_id) {
+  if (!buffer || len < ICM20X_LOG_HEADER_SIZE ||
+      memcmp(buffer, log_magic, sizeof(log_magic)) ||
+      buffer[4] != ICM20X_LOG_VERSION) {
+    return false;
+  }
+  *chip_id = buffer[5];
+  return true;
+}
+
+/*!
+ *    @brief  Decode one frame
+ *    @param  buffer
+ *            The start of the frame
+ *    @param  len
+ *            Bytes available at `buffer`
+ *    @param  last_us
+ *            Timestamp of the previous frame, updated to this frame's
+ *    @param  frame
+ *            Where to store the frame
+ *    @return The number of bytes used, or 0 if the frame is incomplete or
+ *            not valid
+ */
+uint8_t Adafruit_ICM20X_Replay::decodeFrame(const uint8_t *buffer,
+                                            uint32_t len, uint32_t *last_us,
+                                            icm20x_log_frame_t *frame) {
+  if (len < 2 || buffer[0] & 0x80 || buffer[1] & 0xF0) {
+    return 0;
+  }
+
+  uint8_t contents = buffer[0];
+  uint8_t sensors = contents & LOG_SENSORS_MASK;
+  bool absolute = contents & LOG_ABSOLUTE_TIME;
+  uint8_t needed = 2 + (absolute ? 4 : 2) +
+                   (sensors & ICM20X_SENSOR_ACCEL ? 6 : 0) +
+                   (sensors & ICM20X_SENSOR_GYRO ? 6 : 0) +
+                   (sensors & ICM20X_SENSOR_TEMP ? 2 : 0) +
+                   (sensors & ICM20X_SENSOR_MAG ? 6 : 0);
+  if (len < needed) {
+    return 0;
+  }
+
+  memset(frame, 0, sizeof(icm20x_log_frame_t));
+  icm20x_raw_sample_t *sample = &frame->sample;
+  frame->sensors = sensors;
+  frame->accel_range = buffer[1] & 0x3;
+  frame->gyro_range = (buffer[1] >> 2) & 0x3;
+  sample->flags = (contents & LOG_FLAGS_MASK) >> LOG_FLAGS_SHIFT;
+
+  uint8_t pos = 2;
+  if (absolute) {
+    sample->timestamp_us = (uint32_t)buffer[2] | (uint32_t)buffer[3] << 8 |
+                           (uint32_t)buffer[4] << 16 |
+                           (uint32_t)buffer[5] << 24;
+    pos += 4;
+  } else {
+    sample->timestamp_us = *last_us + (buffer[2] | buffer[3] << 8);
+    pos += 2;
+  }
+  *last_us = sample->timestamp_us;
+
+  if (sensors & ICM20X_SENSOR_ACCEL) {
+    for (uint8_t i = 0; i < 3; i++, pos += 2) {
+      sample->accel[i] = getInt16(buffer + pos);
+    }
+  }
+  if (sensors & ICM20X_SENSOR_GYRO) {
+    for (uint8_t i = 0; i < 3; i++, pos += 2) {
+      sample->gyro[i] = getInt16(buffer + pos);
+    }
+  }
+  if (sensors & ICM20X_SENSOR_TEMP) {
+    sample->temperature = getInt16(buffer + pos);
+    pos += 2;
+  }
+  if (sensors & ICM20X_SENSOR_MAG) {
+    for (uint8_t i = 0; i < 3; i++, pos += 2) {
+      sample->mag[i] = getInt16(buffer + pos);
+    }
+  }
+  return pos;
+}
+
+/*!
+ *     @brief  Take the next frame of the log in place of a data burst. Like
+ *             a real read, only the requested sensors change, and requested
+ *             sensors that were not recorded read as zero
+ *     @param  sensors
+ *             A combination of `icm20x_sensor_t` values for the sensors to
+ *             read
+ *     @returns True if there was another frame
+ */
+bool Adafruit_ICM20X_Replay::_readRaw(uint8_t sensors) {
+  if (!log) {
+    return false;
+  }
+
+  icm20x_log_frame_t frame;
+  uint8_t used =
+      decodeFrame(log + log_pos, log_len - log_pos, &last_us, &frame);
+  if (!used) {
+    return false;
+  }
+  log_pos += used;
+  frame_count++;
+
+  if (frame.accel_range != current_accel_range ||
+      frame.gyro_range != current_gyro_range) {
+    current_accel_range = frame.accel_range;
+    current_gyro_range = frame.gyro_range;
+    updateScales();
+  }
+
+  const icm20x_raw_sample_t *sample = &frame.sample;
+  last_burst_us = 0;
+  sample_time_us = sample->timestamp_us;
+
+  if (sensors & ICM20X_SENSOR_ACCEL) {
+    rawAccX = sample->accel[0];
+    rawAccY = sample->accel[1];
+    rawAccZ = sample->accel[2];
+  }
+
+  if (sensors & ICM20X_SENSOR_GYRO) {
+    rawGyroX = sample->gyro[0];
+    rawGyroY = sample->gyro[1];
+    rawGyroZ = sample->gyro[2];
+  }
+
+  if (sensors & ICM20X_SENSOR_TEMP) {
+    rawTemp = sample->temperature;
+  }
+
+  // a log can start between magnetometer readings, so a changed value counts
+  // as new as well
+  sample_flags = 0;
+  mag_updated = false;
+  if (sensors & ICM20X_SENSOR_MAG) {
+    if (frame.sensors & ICM20X_SENSOR_MAG) {
+      sample_flags = sample->flags;
+      mag_updated = (sample->flags & ICM20X_SAMPLE_MAG_NEW) ||
+                    sample->mag[0] != rawMagX || sample->mag[1] != rawMagY ||
+                    sample->mag[2] != rawMagZ;
+    } else {
+      mag_updated = true;
+    }
+    rawMagX = sample->mag[0];
+    rawMagY = sample->mag[1];
+    rawMagZ = sample->mag[2];
+  }
+
+  return true;
+}
+
+/*!
+ *    @brief  Use the recorded timestamp for Unified Sensor events, so
+ *            replayed events are the same every time
+ *    @returns The recorded timestamp in milliseconds
+ */
+uint32_t Adafruit_ICM20X_Replay::sampleMillis(void) {
+  return sample_time_us / 1000;
+}
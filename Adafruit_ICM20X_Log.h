@@ -0,0 +1,127 @@
+/*!
+ *  @file Adafruit_ICM20X_Log.h
+ *
+ * 	Compact binary log of raw ICM20X samples, with a recorder that writes it
+ * 	and a replay driver that reads it back through the normal driver API
+ *
+ * 	This is a library for the Adafruit ICM20X breakouts:
+ * 	https://www.adafruit.com/product/4464
+ * 	https://www.adafruit.com/product/4554
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_ICM20X_LOG_H
+#define _ADAFRUIT_ICM20X_LOG_H
+
+#include "Adafruit_ICM20X.h"
+
+// A log is a stream header followed by frames. All values are little endian
+//
+// Header: 'I' 'C' 'M' 'L', format version, chip WHOAMI
+// Frame:  contents  bits 0-3 `icm20x_sensor_t` values in the frame
+//                   bits 4-5 `icm20x_sample_flag_t` values
+//                   bit 6    set if the time is absolute
+//         ranges    bits 0-1 accel range, bits 2-3 gyro range
+//         time      uint16 microseconds since the previous frame, or uint32
+//                   `micros()` timestamp when absolute
+//         data      int16 accel X Y Z, gyro X Y Z, temperature, mag X Y Z,
+//                   only for the sensors in the frame
+
+#define ICM20X_LOG_VERSION 1     ///< Format version in the stream header
+#define ICM20X_LOG_HEADER_SIZE 6 ///< Bytes in the stream header
+#define ICM20X_LOG_MAX_FRAME_SIZE                                              \
+  26 ///< Bytes in a frame with every sensor and an absolute time
+
+/** One decoded log frame */
+typedef struct {
+  icm20x_raw_sample_t sample; ///< Raw values, zero for absent sensors
+  uint8_t sensors;            ///< `icm20x_sensor_t` values in the frame
+  uint8_t accel_range;        ///< Accelerometer range register value
+  uint8_t gyro_range;         ///< Gyro range register value
+} icm20x_log_frame_t;
+
+/*!
+ *    @brief  Class that writes raw samples from an ICM20X as log frames to a
+ *            `Print` such as `Serial` or an SD card file, or to a buffer
+ */
+class Adafruit_ICM20X_Recorder {
+public:
+  Adafruit_ICM20X_Recorder(Print *sink);
+  Adafruit_ICM20X_Recorder(uint8_t *buffer, uint32_t size);
+
+  bool begin(Adafruit_ICM20X *device);
+  void setSensors(uint8_t sensors);
+
+  bool record(void);
+  bool record(const icm20x_raw_sample_t *sample);
+  uint16_t record(Adafruit_ICM20X_SampleRing *ring,
+                  uint16_t max_samples = 0xFFFF);
+
+  bool flush(void);
+
+  uint32_t getFrameCount(void);
+  uint32_t getByteCount(void);
+  uint32_t getDroppedCount(void);
+
+  static uint8_t encodeHeader(uint8_t chip_id, uint8_t *buffer);
+  static uint8_t encodeFrame(const icm20x_log_frame_t *frame, uint32_t last_us,
+                             bool relative, uint8_t *buffer);
+
+private:
+  Print *sink = NULL;             ///< Output stream, NULL to use `buffer`
+  uint8_t *buffer = NULL;         ///< Output buffer
+  uint32_t buffer_size = 0;       ///< Bytes `buffer` can hold
+  Adafruit_ICM20X *device = NULL; ///< Sensor being recorded
+  uint8_t sensors = 0;            ///< `icm20x_sensor_t` values to record
+  uint32_t last_us = 0;           ///< Timestamp of the last frame
+  bool have_last = false;         ///< Is `last_us` set
+  uint32_t frame_count = 0;       ///< Frames written
+  uint32_t byte_count = 0;        ///< Bytes written, including the header
+  uint32_t dropped_count = 0;     ///< Frames the sink could not take
+  uint8_t pending_len = 0;        ///< Bytes in `pending`
+  /** The rest of a frame the stream took only part of */
+  uint8_t pending[ICM20X_LOG_MAX_FRAME_SIZE];
+
+  bool write(const uint8_t *data, uint8_t len);
+};
+
+/*!
+ *    @brief  Class that plays a log back through the driver API. Every data
+ *            read takes the next frame, so `getEvent`, `readRaw` and the
+ *            Unified Sensor objects return the recorded samples, scaled for
+ *            the recorded ranges. Nothing touches a bus, so a log replays
+ *            the same way on any board or on a desktop build
+ */
+class Adafruit_ICM20X_Replay : public Adafruit_ICM20X {
+public:
+  Adafruit_ICM20X_Replay(void);
+
+  bool begin(const uint8_t *log, uint32_t len, int32_t sensor_id = 0);
+  void rewind(void);
+  bool atEnd(void);
+  uint32_t getFrameCount(void);
+
+  static bool decodeHeader(const uint8_t *buffer, uint32_t len,
+                           uint8_t *chip_id);
+  static uint8_t decodeFrame(const uint8_t *buffer, uint32_t len,
+                             uint32_t *last_us, icm20x_log_frame_t *frame);
+
+protected:
+  bool _readRaw(uint8_t sensors);
+  uint32_t sampleMillis(void);
+
+private:
+  const uint8_t *log = NULL; ///< Log being replayed
+  uint32_t log_len = 0;      ///< Bytes in `log`
+  uint32_t log_pos = 0;      ///< Offset of the next frame
+  uint32_t last_us = 0;      ///< Timestamp of the last frame
+  uint32_t frame_count = 0;  ///< Frames replayed since `begin` or `rewind`
+};
+
+#endif
@@ -0,0 +1,499 @@
+/*!
+ *  @file Adafruit_ICM20X_Telemetry.cpp
+ *
+ *  Compressed stream of raw ICM20X samples for slow UART or radio links.
+ *  Only uses stdint, so the decoder also builds on a desktop
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <string.h>
+
+#include "Adafruit_ICM20X_Telemetry.h"
+
+#define TELEMETRY_KEYFRAME 0x80 ///< Block flags bit for a keyframe block
+
+/** First channel and channel count of each `icm20x_telemetry_sensor_t` */
+typedef struct {
+  uint8_t sensor; ///< `icm20x_telemetry_sensor_t` value
+  uint8_t first;  ///< Index of its first channel
+  uint8_t count;  ///< Number of channels
+} channel_group_t;
+
+static constexpr channel_group_t channel_groups[] = {
+    {ICM20X_TELEMETRY_ACCEL, 0, 3},
+    {ICM20X_TELEMETRY_GYRO, 3, 3},
+    {ICM20X_TELEMETRY_TEMP, 6, 1},
+    {ICM20X_TELEMETRY_MAG, 7, 3},
+};
+#define CHANNEL_GROUPS (sizeof(channel_groups) / sizeof(channel_groups[0]))
+
+static bool channelSent(uint8_t sensors, uint8_t channel) {
+  for (uint8_t i = 0; i < CHANNEL_GROUPS; i++) {
+    const channel_group_t *group = &channel_groups[i];
+    if (channel >= group->first && channel < group->first + group->count) {
+      return sensors & group->sensor;
+    }
+  }
+  return false;
+}
+
+static uint16_t zigzag16(int16_t value) {
+  return ((uint16_t)value << 1) ^ (uint16_t)(value >> 15);
+}
+
+static int16_t unzigzag16(uint16_t value) {
+  return (int16_t)((value >> 1) ^ (uint16_t)-(int16_t)(value & 1));
+}
+
+static uint32_t zigzag32(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag32(uint32_t value) {
+  return (int32_t)((value >> 1) ^ (uint32_t)-(int32_t)(value & 1));
+}
+
+static uint8_t bitWidth(uint32_t value) {
+  uint8_t width = 0;
+  while (value) {
+    width++;
+    value >>= 1;
+  }
+  return width;
+}
+
+static uint16_t fletcher16(const uint8_t *data, uint16_t len) {
+  uint16_t sum1 = 0, sum2 = 0;
+  for (uint16_t i = 0; i < len; i++) {
+    sum1 = (sum1 + data[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  return sum2 << 8 | sum1;
+}
+
+/** Packs values LSB first into a byte buffer */
+typedef struct {
+  uint8_t *buffer; ///< Next byte to fill
+  uint32_t bits;   ///< Bits waiting to be stored
+  uint8_t count;   ///< Number of waiting bits
+} bit_writer_t;
+
+static void writeBits(bit_writer_t *writer, uint32_t value, uint8_t width) {
+  // at most 16 bits at a time so the accumulator cannot overflow
+  while (width) {
+    uint8_t chunk = width > 16 ? 16 : width;
+    writer->bits |= (value & ((1UL << chunk) - 1)) << writer->count;
+    writer->count += chunk;
+    value >>= chunk;
+    width -= chunk;
+    while (writer->count >= 8) {
+      *writer->buffer++ = writer->bits & 0xFF;
+      writer->bits >>= 8;
+      writer->count -= 8;
+    }
+  }
+}
+
+static void flushBits(bit_writer_t *writer) {
+  if (writer->count) {
+    *writer->buffer++ = writer->bits & 0xFF;
+  }
+  writer->bits = 0;
+  writer->count = 0;
+}
+
+/** Unpacks values stored by `writeBits` */
+typedef struct {
+  const uint8_t *buffer; ///< Next byte to load
+  const uint8_t *end;    ///< End of the packed data
+  uint32_t bits;         ///< Loaded bits not yet used
+  uint8_t count;         ///< Number of loaded bits
+} bit_reader_t;
+
+static bool readBits(bit_reader_t *reader, uint8_t width, uint32_t *value) {
+  *value = 0;
+  uint8_t shift = 0;
+  while (width) {
+    uint8_t chunk = width > 16 ? 16 : width;
+    while (reader->count < chunk) {
+      if (reader->buffer >= reader->end) {
+        return false;
+      }
+      reader->bits |= (uint32_t)*reader->buffer++ << reader->count;
+      reader->count += 8;
+    }
+    *value |= (reader->bits & ((1UL << chunk) - 1)) << shift;
+    reader->bits >>= chunk;
+    reader->count -= chunk;
+    shift += chunk;
+    width -= chunk;
+  }
+  return true;
+}
+
+static uint8_t getWidth(const uint8_t *widths, uint8_t channel) {
+  uint8_t width = (widths[channel / 2] >> (4 * (channel % 2))) & 0xF;
+  return width == 15 ? 16 : width;
+}
+
+/*!
+ *    @brief  Instantiates an encoder
+ *    @param  sensors
+ *            A combination of `icm20x_telemetry_sensor_t` values for the
+ *            sensors to send. Leave out the magnetometer for the ICM20649
+ *    @param  block_samples
+ *            Samples per block, up to `ICM20X_TELEMETRY_MAX_BLOCK`. Larger
+ *            blocks compress better but arrive later
+ *    @param  keyframe_blocks
+ *            Blocks from one keyframe to the next. A lost block loses the
+ *            rest of the blocks until the next keyframe
+ */
+Adafruit_ICM20X_TelemetryEncoder::Adafruit_ICM20X_TelemetryEncoder(
+    uint8_t sensors, uint8_t block_samples, uint8_t keyframe_blocks) {
+  this->sensors = sensors & ICM20X_TELEMETRY_ALL;
+  if (block_samples < 1) {
+    block_samples = 1;
+  }
+  if (block_samples > ICM20X_TELEMETRY_MAX_BLOCK) {
+    block_samples = ICM20X_TELEMETRY_MAX_BLOCK;
+  }
+  this->block_samples = block_samples;
+  this->keyframe_blocks = keyframe_blocks ? keyframe_blocks : 1;
+  reset();
+}
+
+/*!
+ *    @brief  Drop any samples not yet written and start the next block with a
+ *            keyframe
+ */
+void Adafruit_ICM20X_TelemetryEncoder::reset(void) {
+  keyframe = true;
+  since_key = 0;
+  count = 0;
+  packed = 0;
+  memset(delta_bits, 0, sizeof(delta_bits));
+  period_bits = 0;
+  sample_count = 0;
+  byte_count = 0;
+}
+
+/*!
+ *    @brief  Add a sample to the current block, and write the block out once
+ *            it is full
+ *    @param  sample
+ *            The sample to add
+ *    @param  buffer
+ *            Where to write a full block, at least
+ *            `ICM20X_TELEMETRY_BUFFER_SIZE` bytes
+ *    @return The number of bytes written to `buffer`, 0 until the block is
+ *            full
+ */
+uint16_t Adafruit_ICM20X_TelemetryEncoder::encode(
+    const icm20x_telemetry_sample_t *sample, uint8_t *buffer) {
+  if (keyframe && count == 0) {
+    memcpy(key, sample->values, sizeof(key));
+    key_us = sample->timestamp_us;
+    last_period_us = 0;
+  } else {
+    int32_t period_us = (int32_t)(sample->timestamp_us - last_us);
+    period_deltas[packed] = zigzag32(period_us - last_period_us);
+    period_bits |= period_deltas[packed];
+    last_period_us = period_us;
+
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      // wraps around, which the decoder undoes
+      int16_t change = (int16_t)(uint16_t)(sample->values[c] - last[c]);
+      deltas[packed][c] = zigzag16(change);
+      delta_bits[c] |= deltas[packed][c];
+    }
+    packed++;
+  }
+
+  memcpy(last, sample->values, sizeof(last));
+  last_us = sample->timestamp_us;
+  count++;
+  sample_count++;
+
+  if (count < block_samples) {
+    return 0;
+  }
+  return writeBlock(buffer);
+}
+
+/*!
+ *    @brief  Write out the current block even if it is not full
+ *    @param  buffer
+ *            Where to write the block, at least
+ *            `ICM20X_TELEMETRY_BUFFER_SIZE` bytes
+ *    @return The number of bytes written, 0 if the block was empty
+ */
+uint16_t Adafruit_ICM20X_TelemetryEncoder::flush(uint8_t *buffer) {
+  if (!count) {
+    return 0;
+  }
+  return writeBlock(buffer);
+}
+
+/*!
+ *    @brief  Get the number of samples encoded since `reset`
+ *    @return The sample count
+ */
+uint32_t Adafruit_ICM20X_TelemetryEncoder::getSampleCount(void) {
+  return sample_count;
+}
+
+/*!
+ *    @brief  Get the number of bytes written since `reset`. Divide by
+ *            `getSampleCount` for the bytes per sample
+ *    @return The byte count
+ */
+uint32_t Adafruit_ICM20X_TelemetryEncoder::getByteCount(void) {
+  return byte_count;
+}
+
+/*!
+ *    @brief  Write out the current block and start the next one
+ *    @param  buffer
+ *            Where to write the block
+ *    @return The number of bytes written
+ */
+uint16_t Adafruit_ICM20X_TelemetryEncoder::writeBlock(uint8_t *buffer) {
+  uint8_t *payload = buffer + ICM20X_TELEMETRY_HEADER_SIZE;
+  uint8_t *out = payload;
+
+  if (keyframe) {
+    for (uint8_t i = 0; i < 4; i++) {
+      *out++ = key_us >> (8 * i);
+    }
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      if (channelSent(sensors, c)) {
+        *out++ = (uint16_t)key[c] & 0xFF;
+        *out++ = (uint16_t)key[c] >> 8;
+      }
+    }
+  }
+
+  // widths of 15 and 16 bits share a code, 15 bit values use 16
+  uint8_t period_width = bitWidth(period_bits);
+  uint8_t widths[ICM20X_TELEMETRY_CHANNELS];
+  *out++ = period_width;
+  memset(out, 0, (ICM20X_TELEMETRY_CHANNELS + 1) / 2);
+  for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+    uint8_t width = bitWidth(delta_bits[c]);
+    if (width == 15) {
+      width = 16;
+    }
+    widths[c] = channelSent(sensors, c) ? width : 0;
+    out[c / 2] |= (widths[c] == 16 ? 15 : widths[c]) << (4 * (c % 2));
+  }
+  out += (ICM20X_TELEMETRY_CHANNELS + 1) / 2;
+
+  bit_writer_t writer = {out, 0, 0};
+  for (uint8_t i = 0; i < packed; i++) {
+    writeBits(&writer, period_deltas[i], period_width);
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      writeBits(&writer, deltas[i][c], widths[c]);
+    }
+  }
+  flushBits(&writer);
+  out = writer.buffer;
+
+  uint16_t payload_len = out - payload;
+  buffer[0] = ICM20X_TELEMETRY_SYNC;
+  buffer[1] = (keyframe ? TELEMETRY_KEYFRAME : 0) |
+              ICM20X_TELEMETRY_VERSION << 4 | sensors;
+  buffer[2] = count;
+  buffer[3] = sequence;
+  buffer[4] = payload_len & 0xFF;
+  buffer[5] = payload_len >> 8;
+
+  uint16_t checksum = fletcher16(buffer + 1, out - buffer - 1);
+  *out++ = checksum & 0xFF;
+  *out++ = checksum >> 8;
+
+  // start the next block
+  sequence++;
+  since_key++;
+  if (since_key >= keyframe_blocks) {
+    since_key = 0;
+    keyframe = true;
+  } else {
+    keyframe = false;
+  }
+  count = 0;
+  packed = 0;
+  memset(delta_bits, 0, sizeof(delta_bits));
+  period_bits = 0;
+
+  uint16_t len = out - buffer;
+  byte_count += len;
+  return len;
+}
+
+/*!
+ *    @brief  Instantiates a decoder, which waits for a keyframe
+ */
+Adafruit_ICM20X_TelemetryDecoder::Adafruit_ICM20X_TelemetryDecoder(void) {
+  memset(last, 0, sizeof(last));
+}
+
+/*!
+ *    @brief  Forget the stream so far and wait for the next keyframe
+ */
+void Adafruit_ICM20X_TelemetryDecoder::reset(void) {
+  synced = false;
+  block_count = 0;
+  dropped_count = 0;
+}
+
+/*!
+ *    @brief  Get the size of the block at the start of a buffer, so a reader
+ *            knows how many bytes to collect before calling `decode`
+ *    @param  buffer
+ *            Received bytes
+ *    @param  len
+ *            Number of received bytes
+ *    @return The size of the whole block, which may be more than `len`, or 0
+ *            if `buffer` does not start with a block header. Skip a byte and
+ *            try again to find the next block
+ */
+uint16_t Adafruit_ICM20X_TelemetryDecoder::blockSize(const uint8_t *buffer,
+                                                     uint16_t len) {
+  if (len < ICM20X_TELEMETRY_HEADER_SIZE ||
+      buffer[0] != ICM20X_TELEMETRY_SYNC ||
+      ((buffer[1] >> 4) & 0x7) != ICM20X_TELEMETRY_VERSION) {
+    return 0;
+  }
+  uint16_t payload_len = buffer[4] | buffer[5] << 8;
+  if (payload_len > ICM20X_TELEMETRY_BUFFER_SIZE) {
+    return 0;
+  }
+  return ICM20X_TELEMETRY_HEADER_SIZE + payload_len + 2;
+}
+
+/*!
+ *    @brief  Decode one block
+ *    @param  buffer
+ *            The block
+ *    @param  len
+ *            Bytes available at `buffer`
+ *    @param  samples
+ *            Where to store the block's samples
+ *    @param  max_samples
+ *            Room in `samples`. `ICM20X_TELEMETRY_MAX_BLOCK` fits any block
+ *            from an encoder on the same kind of board; AVR boards default
+ *            to smaller blocks than the rest
+ *    @return The number of samples decoded, 0 if the block is incomplete or
+ *            corrupt, or follows a lost block and is not a keyframe
+ */
+uint8_t Adafruit_ICM20X_TelemetryDecoder::decode(
+    const uint8_t *buffer, uint16_t len, icm20x_telemetry_sample_t *samples,
+    uint8_t max_samples) {
+  uint16_t size = blockSize(buffer, len);
+  if (!size || size > len) {
+    return 0;
+  }
+  uint16_t checksum = buffer[size - 2] | buffer[size - 1] << 8;
+  uint8_t count = buffer[2];
+  if (fletcher16(buffer + 1, size - 3) != checksum || !count ||
+      count > max_samples) {
+    synced = false;
+    dropped_count++;
+    return 0;
+  }
+
+  bool keyframe = buffer[1] & TELEMETRY_KEYFRAME;
+  uint8_t sensors = buffer[1] & ICM20X_TELEMETRY_ALL;
+  if (synced && buffer[3] != sequence) {
+    dropped_count += (uint8_t)(buffer[3] - sequence);
+    synced = false;
+  }
+  sequence = buffer[3] + 1;
+  if (!keyframe && !synced) {
+    dropped_count++;
+    return 0;
+  }
+
+  const uint8_t *in = buffer + ICM20X_TELEMETRY_HEADER_SIZE;
+  const uint8_t *end = buffer + size - 2;
+  uint8_t n = 0;
+  if (keyframe) {
+    uint8_t key_size = 4;
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      key_size += channelSent(sensors, c) ? 2 : 0;
+    }
+    if (end - in < key_size) {
+      synced = false;
+      dropped_count++;
+      return 0;
+    }
+    last_us = (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+              (uint32_t)in[3] << 24;
+    in += 4;
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      last[c] = 0;
+      if (channelSent(sensors, c)) {
+        last[c] = (int16_t)(in[0] | in[1] << 8);
+        in += 2;
+      }
+    }
+    last_period_us = 0;
+    memcpy(samples[n].values, last, sizeof(last));
+    samples[n].timestamp_us = last_us;
+    n++;
+  }
+
+  if (end - in < 1 + (ICM20X_TELEMETRY_CHANNELS + 1) / 2) {
+    synced = false;
+    dropped_count++;
+    return 0;
+  }
+  uint8_t period_width = *in++;
+  const uint8_t *widths = in;
+  in += (ICM20X_TELEMETRY_CHANNELS + 1) / 2;
+
+  bit_reader_t reader = {in, end, 0, 0};
+  for (; n < count; n++) {
+    uint32_t value;
+    if (period_width > 32 || !readBits(&reader, period_width, &value)) {
+      synced = false;
+      dropped_count++;
+      return 0;
+    }
+    last_period_us += unzigzag32(value);
+    last_us += last_period_us;
+
+    for (uint8_t c = 0; c < ICM20X_TELEMETRY_CHANNELS; c++) {
+      if (!readBits(&reader, getWidth(widths, c), &value)) {
+        synced = false;
+        dropped_count++;
+        return 0;
+      }
+      last[c] = (int16_t)(last[c] + unzigzag16(value));
+    }
+    memcpy(samples[n].values, last, sizeof(last));
+    samples[n].timestamp_us = last_us;
+  }
+
+  synced = true;
+  block_count++;
+  return count;
+}
+
+/*!
+ *    @brief  Get the number of blocks decoded since `reset`
+ *    @return The block count
+ */
+uint32_t Adafruit_ICM20X_TelemetryDecoder::getBlockCount(void) {
+  return block_count;
+}
+
+/*!
+ *    @brief  Get the number of blocks that were missing, corrupt, or could
+ *            not be decoded because an earlier block was lost
+ *    @return The dropped block count
+ */
+uint32_t Adafruit_ICM20X_TelemetryDecoder::getDroppedCount(void) {
+  return dropped_count;
+}
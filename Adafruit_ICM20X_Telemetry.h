@@ -0,0 +1,151 @@
+/*!
+ *  @file Adafruit_ICM20X_Telemetry.h
+ *
+ * 	Compressed stream of raw ICM20X samples for slow UART or radio links.
+ * 	Only uses stdint, so the decoder also builds on a desktop
+ *
+ * 	This is a library for the Adafruit ICM20X breakouts:
+ * 	https://www.adafruit.com/product/4464
+ * 	https://www.adafruit.com/product/4554
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_ICM20X_TELEMETRY_H
+#define _ADAFRUIT_ICM20X_TELEMETRY_H
+
+#include <stdint.h>
+
+// The stream is a series of blocks. A keyframe block starts with one sample
+// stored whole; every other sample is stored as the change from the one
+// before it, so a block after a keyframe needs all the blocks since. All
+// values are little endian
+//
+// Header:   sync byte, flags (bit 7 keyframe, bits 4-6 version, bits 0-3
+//           sensors), sample count, sequence number, uint16 payload length
+// Payload:  keyframes only: uint32 timestamp and int16 values
+//           uint8 timestamp width, then a 4 bit width per channel, 15
+//           meaning 16 bits
+//           for every other sample, LSB first: the zigzag change in the
+//           sample period, then the zigzag change of each channel, each
+//           using its width
+// Trailer:  Fletcher-16 checksum of everything after the sync byte
+
+#define ICM20X_TELEMETRY_CHANNELS                                              \
+  10 ///< Accel X Y Z, gyro X Y Z, temperature, mag X Y Z
+#ifndef ICM20X_TELEMETRY_MAX_BLOCK
+#if defined(__AVR__)
+// 2K of RAM can't spare the encoder's 768 bytes of deltas for 32 samples
+#define ICM20X_TELEMETRY_MAX_BLOCK                                             \
+  8 ///< Most samples in a block, each costs the encoder 24 bytes of RAM
+#else
+#define ICM20X_TELEMETRY_MAX_BLOCK                                             \
+  32 ///< Most samples in a block, each costs the encoder 24 bytes of RAM
+#endif
+#endif
+#define ICM20X_TELEMETRY_VERSION 1     ///< Format version in every block
+#define ICM20X_TELEMETRY_SYNC 0xB5     ///< First byte of every block
+#define ICM20X_TELEMETRY_HEADER_SIZE 6 ///< Bytes before a block's payload
+#define ICM20X_TELEMETRY_BUFFER_SIZE                                           \
+  (ICM20X_TELEMETRY_HEADER_SIZE + 30 + ICM20X_TELEMETRY_MAX_BLOCK * 24 +      \
+   2) ///< Largest possible block
+
+/** Sensors to include in the stream, the same values as `icm20x_sensor_t` */
+typedef enum {
+  ICM20X_TELEMETRY_ACCEL = 0x01, ///< Accelerometer X, Y and Z
+  ICM20X_TELEMETRY_GYRO = 0x02,  ///< Gyro X, Y and Z
+  ICM20X_TELEMETRY_TEMP = 0x04,  ///< Temperature
+  ICM20X_TELEMETRY_MAG = 0x08,   ///< Magnetometer X, Y and Z
+  ICM20X_TELEMETRY_ALL = 0x0F,   ///< Every sensor
+} icm20x_telemetry_sensor_t;
+
+/** One raw sample in the stream */
+typedef struct {
+  /** Raw accel X, Y, Z, gyro X, Y, Z, temperature and mag X, Y, Z, in the
+   * same order as `icm20x_raw_sample_t`. Sensors left out of the stream
+   * decode as zero */
+  int16_t values[ICM20X_TELEMETRY_CHANNELS];
+  uint32_t timestamp_us; ///< When the sample was taken
+} icm20x_telemetry_sample_t;
+
+/*!
+ *    @brief  Class that packs raw samples into compressed blocks
+ */
+class Adafruit_ICM20X_TelemetryEncoder {
+public:
+  Adafruit_ICM20X_TelemetryEncoder(
+      uint8_t sensors = ICM20X_TELEMETRY_ALL,
+      uint8_t block_samples = ICM20X_TELEMETRY_MAX_BLOCK,
+      uint8_t keyframe_blocks = 8);
+
+  void reset(void);
+  uint16_t encode(const icm20x_telemetry_sample_t *sample, uint8_t *buffer);
+  uint16_t flush(uint8_t *buffer);
+
+  uint32_t getSampleCount(void);
+  uint32_t getByteCount(void);
+
+private:
+  uint8_t sensors;         ///< `icm20x_telemetry_sensor_t` values to send
+  uint8_t block_samples;   ///< Samples per block
+  uint8_t keyframe_blocks; ///< Blocks from one keyframe to the next
+
+  uint8_t sequence = 0;  ///< Sequence number of the current block
+  uint8_t since_key = 0; ///< Blocks since the last keyframe
+  bool keyframe = true;  ///< Does the current block start with a keyframe
+  uint8_t count = 0;     ///< Samples in the current block
+  uint8_t packed = 0;    ///< Samples stored as changes in the current block
+
+  int16_t key[ICM20X_TELEMETRY_CHANNELS];  ///< Keyframe values
+  uint32_t key_us = 0;                     ///< Keyframe timestamp
+  int16_t last[ICM20X_TELEMETRY_CHANNELS]; ///< Previous sample's values
+  uint32_t last_us = 0;                    ///< Previous sample's timestamp
+  int32_t last_period_us = 0;              ///< Time between the last two
+
+  /** Zigzag changes of each channel for the current block */
+  uint16_t deltas[ICM20X_TELEMETRY_MAX_BLOCK][ICM20X_TELEMETRY_CHANNELS];
+  uint32_t period_deltas[ICM20X_TELEMETRY_MAX_BLOCK]; ///< Zigzag period change
+  uint16_t delta_bits[ICM20X_TELEMETRY_CHANNELS];     ///< OR of each channel's
+                                                  ///< `deltas`
+  uint32_t period_bits = 0; ///< OR of `period_deltas`
+
+  uint32_t sample_count = 0; ///< Samples encoded since `reset`
+  uint32_t byte_count = 0;   ///< Block bytes written since `reset`
+
+  uint16_t writeBlock(uint8_t *buffer);
+};
+
+/*!
+ *    @brief  Class that unpacks blocks made by
+ *            `Adafruit_ICM20X_TelemetryEncoder`
+ */
+class Adafruit_ICM20X_TelemetryDecoder {
+public:
+  Adafruit_ICM20X_TelemetryDecoder(void);
+
+  void reset(void);
+  static uint16_t blockSize(const uint8_t *buffer, uint16_t len);
+  uint8_t decode(const uint8_t *buffer, uint16_t len,
+                 icm20x_telemetry_sample_t *samples, uint8_t max_samples);
+
+  uint32_t getBlockCount(void);
+  uint32_t getDroppedCount(void);
+
+private:
+  bool synced = false;  ///< Has a keyframe been decoded since the last gap
+  uint8_t sequence = 0; ///< Sequence number of the next block
+
+  int16_t last[ICM20X_TELEMETRY_CHANNELS]; ///< Previous sample's values
+  uint32_t last_us = 0;                    ///< Previous sample's timestamp
+  int32_t last_period_us = 0;              ///< Time between the last two
+
+  uint32_t block_count = 0;   ///< Blocks decoded
+  uint32_t dropped_count = 0; ///< Blocks lost, corrupt or not decodable
+};
+
+#endif
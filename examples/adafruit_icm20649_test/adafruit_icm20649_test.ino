@@ -66,22 +66,22 @@ void setup(void) {
     break;
   }
 
-  //  icm.setAccelRateDivisor(4095);
+  //  icm.setAccelDataRate(100);
   uint16_t accel_divisor = icm.getAccelRateDivisor();
-  float accel_rate = 1125 / (1.0 + accel_divisor);
+  float accel_rate = icm.getAccelDataRate();
 
   Serial.print("Accelerometer data rate divisor set to: ");
   Serial.println(accel_divisor);
-  Serial.print("Accelerometer data rate (Hz) is approximately: ");
+  Serial.print("Accelerometer data rate (Hz) is: ");
   Serial.println(accel_rate);
 
-  //  icm.setGyroRateDivisor(255);
+  //  icm.setGyroDataRate(100);
   uint8_t gyro_divisor = icm.getGyroRateDivisor();
-  float gyro_rate = 1100 / (1.0 + gyro_divisor);
+  float gyro_rate = icm.getGyroDataRate();
 
   Serial.print("Gyro data rate divisor set to: ");
   Serial.println(gyro_divisor);
-  Serial.print("Gyro data rate (Hz) is approximately: ");
+  Serial.print("Gyro data rate (Hz) is: ");
   Serial.println(gyro_rate);
   Serial.println();
 }
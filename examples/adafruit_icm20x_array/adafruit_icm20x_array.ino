@@ -0,0 +1,62 @@
+/**************************************************/
+/* ICM20X Sensor Array Demo
+This example reads two ICM20948s, one after the other, into one frame per
+loop. The frame keeps each axis for every sensor side by side, so all of them
+can be processed in one pass, and says when each sample was taken */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20948.h>
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20X_Array.h>
+
+Adafruit_ICM20948 icm_a;
+Adafruit_ICM20948 icm_b;
+Adafruit_ICM20X_Array imus;
+
+// For SPI mode, we need a CS pin
+#define ICM_CS 10
+
+icm20x_array_frame_t frame;
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+
+  // one sensor on each I2C address; either could be on SPI instead, such as
+  // icm_b.begin_SPI(ICM_CS)
+  if (!icm_a.begin_I2C(0x68) || !icm_b.begin_I2C(0x69)) {
+    Serial.println("Failed to find both ICM20948 chips");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  imus.addDevice(&icm_a);
+  imus.addDevice(&icm_b);
+}
+
+void loop() {
+  if (!imus.read(&frame)) {
+    Serial.println("read failed");
+  }
+
+  // average the Z acceleration across the array
+  int32_t sum = 0;
+  for (uint8_t i = 0; i < frame.count; i++) {
+    sum += frame.accel[2][i];
+  }
+
+  icm20x_fixed_scale_t scale;
+  imus.getFixedScale(0, &scale);
+  Serial.print("Mean accel Z: ");
+  Serial.print(icm20x_raw_to_q16(sum / frame.count, scale.accel) / 65536.0);
+  Serial.print(" m/s^2, read skew: ");
+  Serial.print(frame.offset_us[frame.count - 1]);
+  Serial.println(" us");
+
+  delay(100);
+}
@@ -0,0 +1,70 @@
+/**************************************************/
+/* ICM20X FIFO Demo
+This example buffers samples in the sensor's FIFO and drains them in bursts
+into a sample ring, so the loop is free to do other work between reads */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+#define ICM_CS 10
+// For software-SPI mode we need SCK/MOSI/MISO pins
+#define ICM_SCK 13
+#define ICM_MISO 12
+#define ICM_MOSI 11
+
+#define RING_SIZE 16
+icm20x_raw_sample_t ring_storage[RING_SIZE];
+Adafruit_ICM20X_SampleRing ring(ring_storage, RING_SIZE);
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+  if (!icm.begin_I2C()) {
+    // if (!icm.begin_SPI(ICM_CS)) {
+    // if (!icm.begin_SPI(ICM_CS, ICM_SCK, ICM_MISO, ICM_MOSI)) {
+    Serial.println("Failed to find ICM20X chip");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  // matching divisors keep every FIFO frame complete
+  icm.setGyroRateDivisor(10);
+  icm.setAccelRateDivisor(10);
+
+  // pass true to also buffer the ICM20948's magnetometer
+  icm.enableFIFO(true, false);
+}
+
+void loop() {
+  uint16_t drained = icm.readFIFO(&ring);
+
+  icm20x_raw_sample_t sample;
+  while (ring.pop(&sample)) {
+    Serial.print(sample.accel[0]);
+    Serial.print(",");
+    Serial.print(sample.accel[1]);
+    Serial.print(",");
+    Serial.print(sample.accel[2]);
+    Serial.print(",");
+    Serial.print(sample.gyro[0]);
+    Serial.print(",");
+    Serial.print(sample.gyro[1]);
+    Serial.print(",");
+    Serial.println(sample.gyro[2]);
+  }
+
+  if (!drained) {
+    delay(10); // the FIFO keeps collecting while we're away
+  }
+}
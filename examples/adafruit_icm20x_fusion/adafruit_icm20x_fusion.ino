@@ -0,0 +1,80 @@
+/**************************************************/
+/* ICM20X Fusion Demo
+This example drains the sensor's FIFO into a sample ring and feeds every
+sample to an orientation filter, so orientation is tracked at the sensor's
+own rate. Paste the output into the Arduino serial plotter */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20X_Fusion.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+// or use ICM20X_FUSION_MADGWICK
+Adafruit_ICM20X_Fusion fusion(ICM20X_FUSION_MAHONY);
+
+#define ICM_CS 10
+// For software-SPI mode we need SCK/MOSI/MISO pins
+#define ICM_SCK 13
+#define ICM_MISO 12
+#define ICM_MOSI 11
+
+#define RING_SIZE 32
+icm20x_raw_sample_t ring_storage[RING_SIZE];
+Adafruit_ICM20X_SampleRing ring(ring_storage, RING_SIZE);
+
+uint32_t last_print = 0;
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+  if (!icm.begin_I2C()) {
+    // if (!icm.begin_SPI(ICM_CS)) {
+    // if (!icm.begin_SPI(ICM_CS, ICM_SCK, ICM_MISO, ICM_MOSI)) {
+    Serial.println("Failed to find ICM20X chip");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  // matching rates keep every FIFO frame complete
+  icm.setGyroDataRate(225);
+  icm.setAccelDataRate(225);
+
+  // the filter needs the gyro scale; set it again after changing the range
+  icm20x_fixed_scale_t scale;
+  icm.getFixedScale(&scale);
+  fusion.setScale(&scale);
+
+  // pass false to skip the ICM20948's magnetometer
+  icm.enableFIFO(true, true);
+}
+
+void loop() {
+  icm.readFIFO(&ring);
+  fusion.update(&ring);
+
+  if (millis() - last_print < 50) {
+    return;
+  }
+  last_print = millis();
+
+  float roll, pitch, yaw;
+  fusion.getEuler(&roll, &pitch, &yaw);
+  Serial.print(roll * RAD_TO_DEG);
+  Serial.print(",");
+  Serial.print(pitch * RAD_TO_DEG);
+  Serial.print(",");
+  Serial.print(yaw * RAD_TO_DEG);
+  Serial.print(",");
+  // microseconds per filter update
+  Serial.println(fusion.getUpdateMicros());
+}
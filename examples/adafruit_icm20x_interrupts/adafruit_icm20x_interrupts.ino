@@ -0,0 +1,58 @@
+/**************************************************/
+/* ICM20X Data Ready Interrupt Demo
+This example routes the data ready interrupt to the INT pin and only talks to
+the sensor when new data is waiting, instead of polling it continuously.
+
+Connect the breakout's INT pin to an interrupt capable pin */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+#define ICM_INT 2
+
+#define RING_SIZE 8
+icm20x_raw_sample_t ring_storage[RING_SIZE];
+Adafruit_ICM20X_SampleRing ring(ring_storage, RING_SIZE);
+
+void icm_isr(void) { icm.handleInterrupt(); }
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+  if (!icm.begin_I2C()) {
+    Serial.println("Failed to find ICM20X chip");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  pinMode(ICM_INT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ICM_INT), icm_isr, RISING);
+  icm.enableInterrupts(ICM20X_INT_DATA_READY);
+}
+
+void loop() {
+  if (!icm.interruptPending()) {
+    return; // free to do other work or sleep here
+  }
+  icm.serviceInterrupts(&ring);
+
+  icm20x_raw_sample_t sample;
+  while (ring.pop(&sample)) {
+    Serial.print(sample.accel[0]);
+    Serial.print(",");
+    Serial.print(sample.accel[1]);
+    Serial.print(",");
+    Serial.println(sample.accel[2]);
+  }
+}
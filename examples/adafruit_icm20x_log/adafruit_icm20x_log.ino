@@ -0,0 +1,96 @@
+/**************************************************/
+/* ICM20X Log Demo
+This example records raw samples into a compact binary log in memory, then
+plays the log back through a replay driver, which returns the same events the
+sensor did. To log to a card or the host instead, pass a stream such as an
+SD `File` or `&Serial` to the recorder */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20X_Log.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+#define ICM_CS 10
+// For software-SPI mode we need SCK/MOSI/MISO pins
+#define ICM_SCK 13
+#define ICM_MISO 12
+#define ICM_MOSI 11
+
+#define LOG_FRAMES 50
+uint8_t log_buffer[ICM20X_LOG_HEADER_SIZE +
+                   LOG_FRAMES * ICM20X_LOG_MAX_FRAME_SIZE];
+Adafruit_ICM20X_Recorder recorder(log_buffer, sizeof(log_buffer));
+
+Adafruit_ICM20X_Replay replay;
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+  if (!icm.begin_I2C()) {
+    // if (!icm.begin_SPI(ICM_CS)) {
+    // if (!icm.begin_SPI(ICM_CS, ICM_SCK, ICM_MISO, ICM_MOSI)) {
+    Serial.println("Failed to find ICM20X chip");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  // leave out sensors you don't need to make the frames smaller
+  recorder.begin(&icm);
+  recorder.setSensors(ICM20X_SENSOR_ACCEL | ICM20X_SENSOR_GYRO);
+
+  sensors_event_t accel, gyro;
+  for (uint8_t i = 0; i < LOG_FRAMES; i++) {
+    icm.getEvent(&accel, &gyro, NULL);
+    recorder.record();
+    delay(20);
+  }
+
+  Serial.print("Recorded ");
+  Serial.print(recorder.getFrameCount());
+  Serial.print(" frames in ");
+  Serial.print(recorder.getByteCount());
+  Serial.println(" bytes");
+
+  if (!replay.begin(log_buffer, recorder.getByteCount())) {
+    Serial.println("Failed to replay the log");
+    while (1) {
+      delay(10);
+    }
+  }
+}
+
+void loop() {
+  sensors_event_t accel, gyro;
+
+  // the replay driver works like the real one until the log runs out
+  if (replay.atEnd()) {
+    replay.rewind();
+    Serial.println("Rewind");
+  }
+  replay.getEvent(&accel, &gyro, NULL);
+
+  Serial.print(accel.timestamp);
+  Serial.print(",");
+  Serial.print(accel.acceleration.x);
+  Serial.print(",");
+  Serial.print(accel.acceleration.y);
+  Serial.print(",");
+  Serial.print(accel.acceleration.z);
+  Serial.print(",");
+  Serial.print(gyro.gyro.x);
+  Serial.print(",");
+  Serial.print(gyro.gyro.y);
+  Serial.print(",");
+  Serial.println(gyro.gyro.z);
+  delay(100);
+}
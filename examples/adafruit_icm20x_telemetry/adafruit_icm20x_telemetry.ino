@@ -0,0 +1,107 @@
+/**************************************************/
+/* ICM20X Telemetry Demo
+This example drains the sensor's FIFO, compresses the samples and sends the
+compressed blocks over a second serial port, such as a UART radio. The
+compression ratio is printed on the USB serial port once a second. Boards
+without a second port, like the Uno, send the blocks on Serial instead and
+print nothing else. Use Adafruit_ICM20X_TelemetryDecoder on the receiving
+end */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20X_Telemetry.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649, and leave ICM20X_TELEMETRY_MAG out below
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+#define ICM_CS 10
+// For software-SPI mode we need SCK/MOSI/MISO pins
+#define ICM_SCK 13
+#define ICM_MISO 12
+#define ICM_MOSI 11
+
+// the slow link the blocks are sent over
+#if defined(__AVR__) && !defined(HAVE_HWSERIAL1)
+#define LINK Serial
+#define LINK_IS_SERIAL
+#else
+#define LINK Serial1
+#endif
+
+// one block of samples; smaller on boards with little RAM
+#define RING_SIZE (ICM20X_TELEMETRY_MAX_BLOCK + 1)
+icm20x_raw_sample_t ring_storage[RING_SIZE];
+Adafruit_ICM20X_SampleRing ring(ring_storage, RING_SIZE);
+
+// a keyframe every 8 blocks of the largest size
+Adafruit_ICM20X_TelemetryEncoder encoder(ICM20X_TELEMETRY_ALL,
+                                         ICM20X_TELEMETRY_MAX_BLOCK, 8);
+uint8_t block[ICM20X_TELEMETRY_BUFFER_SIZE];
+
+uint32_t last_print = 0;
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+#ifndef LINK_IS_SERIAL
+  LINK.begin(115200);
+#endif
+
+  if (!icm.begin_I2C()) {
+    // if (!icm.begin_SPI(ICM_CS)) {
+    // if (!icm.begin_SPI(ICM_CS, ICM_SCK, ICM_MISO, ICM_MOSI)) {
+#ifndef LINK_IS_SERIAL
+    Serial.println("Failed to find ICM20X chip");
+#endif
+    while (1) {
+      delay(10);
+    }
+  }
+
+  icm.setGyroDataRate(225);
+  icm.setAccelDataRate(225);
+
+  // pass false to skip the ICM20948's magnetometer
+  icm.enableFIFO(true, true);
+}
+
+void loop() {
+  icm.readFIFO(&ring);
+
+  icm20x_raw_sample_t raw;
+  while (ring.pop(&raw)) {
+    icm20x_telemetry_sample_t sample;
+    for (uint8_t i = 0; i < 3; i++) {
+      sample.values[i] = raw.accel[i];
+      sample.values[3 + i] = raw.gyro[i];
+      sample.values[7 + i] = raw.mag[i];
+    }
+    sample.values[6] = raw.temperature;
+    sample.timestamp_us = raw.timestamp_us;
+
+    uint16_t len = encoder.encode(&sample, block);
+    if (len) {
+      LINK.write(block, len);
+    }
+  }
+
+#ifndef LINK_IS_SERIAL
+  if (millis() - last_print < 1000 || !encoder.getByteCount()) {
+    return;
+  }
+  last_print = millis();
+
+  // a raw sample is 20 bytes of values and a 4 byte timestamp
+  Serial.print("Bytes per sample: ");
+  Serial.print((float)encoder.getByteCount() / encoder.getSampleCount());
+  Serial.print(" ratio: ");
+  Serial.println(24.0 * encoder.getSampleCount() / encoder.getByteCount());
+#endif
+}
@@ -0,0 +1,71 @@
+/**************************************************/
+/* ICM20X Wake on Motion Demo
+This example powers down everything but the accelerometer, duty cycles it at
+a low rate and raises an interrupt when the sensor is moved, so the MCU can
+sleep until something happens.
+
+Connect the breakout's INT pin to an interrupt capable pin */
+/**************************************************/
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+#include <Adafruit_ICM20X.h>
+#include <Adafruit_ICM20948.h>
+Adafruit_ICM20948 icm;
+
+// uncomment to use the ICM20649
+//#include <Adafruit_ICM20649.h>
+// Adafruit_ICM20649 icm
+
+#define ICM_INT 2
+
+volatile bool motion = false;
+
+void icm_isr(void) { motion = true; }
+
+void setup(void) {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10); // will pause Zero, Leonardo, etc until serial console opens
+  if (!icm.begin_I2C()) {
+    Serial.println("Failed to find ICM20X chip");
+    while (1) {
+      delay(10);
+    }
+  }
+
+  // the accelerometer alone, waking about 17 times a second
+  icm.setPoweredSensors(ICM20X_SENSOR_ACCEL);
+  icm.setAccelDataRate(17);
+  icm.enableLowPower(true);
+
+  pinMode(ICM_INT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ICM_INT), icm_isr, RISING);
+  if (!icm.enableWakeOnMotion(true, 100)) {
+    Serial.println("Failed to enable wake on motion");
+  }
+
+  Serial.print("Powered sensors: 0x");
+  Serial.println(icm.getPoweredSensors(), HEX);
+  Serial.print("Low power: ");
+  Serial.println(icm.isLowPowerEnabled() ? "on" : "off");
+}
+
+void loop() {
+  if (!motion) {
+    return; // put the MCU to sleep here
+  }
+  motion = false;
+
+  if (icm.getInterruptStatus() & ICM20X_INT_WAKE_ON_MOTION) {
+    sensors_event_t accel;
+    icm.getAccelerometerSensor()->getEvent(&accel);
+    Serial.print("Motion! Accel X: ");
+    Serial.print(accel.acceleration.x);
+    Serial.print(" \tY: ");
+    Serial.print(accel.acceleration.y);
+    Serial.print(" \tZ: ");
+    Serial.println(accel.acceleration.z);
+  }
+}
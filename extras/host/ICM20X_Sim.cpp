@@ -0,0 +1,982 @@
+/*!
+ *  @file ICM20X_Sim.cpp
+ *
+ *  Register level simulation of the ICM20948 and ICM20649, see ICM20X_Sim.h
+ *
+ *  BSD license (see license.txt)
+ */
+
+#include "ICM20X_Sim.h"
+#include <Adafruit_ICM20948.h>
+
+#define ICM20X_B0_EXT_SLV_SENS_DATA_00 0x3B ///< First proxied slave byte
+#define ICM20X_B0_FIFO_COUNT_L 0x71         ///< FIFO byte count LSB
+
+#define AK09916_WIA1 0x00       ///< Company ID register
+#define AK09916_COMPANY_ID 0x48 ///< Value of WIA1
+#define AK09916_TMPS 0x17       ///< Dummy register between the data and ST2
+#define AK09916_SINGLE 0x01     ///< CNTL2 single measurement mode
+#define AK09916_SELF_TEST 0x10  ///< CNTL2 self test mode
+#define AK09916_MAX_UT_SUM 4912 ///< |X|+|Y|+|Z| in uT that sets HOFL
+
+static ICM20X_Sim *attached[ICM20X_SIM_MAX_DEVICES];
+
+// sensor data registers hold big endian values
+static void put16(uint8_t *buffer, int16_t value) {
+  buffer[0] = (uint16_t)value >> 8;
+  buffer[1] = value & 0xFF;
+}
+
+// noise in [-amplitude, amplitude] that only depends on its arguments
+static int16_t noise(uint32_t index, uint8_t channel, int16_t amplitude) {
+  uint32_t x = index * 16 + channel;
+  x ^= x >> 16;
+  x *= 0x7FEB352D;
+  x ^= x >> 15;
+  x *= 0x846CA68B;
+  x ^= x >> 16;
+  return (int16_t)(x % (2 * amplitude + 1)) - amplitude;
+}
+
+// a triangle wave from -amplitude to amplitude
+static int16_t triangle(uint32_t index, uint32_t period, int16_t amplitude) {
+  int32_t phase = index % period;
+  int32_t half = period / 2;
+  int32_t value = phase < half ? phase : period - phase;
+  return (int16_t)(value * 4 * amplitude / period - amplitude);
+}
+
+/*!
+ *    @brief  A generator for a chip on a slowly rocking table, with the
+ *            sensor noise of a real one. Sample `index` is the same on every
+ *            run, so compression and filter results can be repeated
+ *    @param  index The sample number
+ *    @param  sample The sample to fill in
+ */
+void icm20x_sim_noisy_sample(uint32_t index, icm20x_sim_sample_t *sample) {
+  // white noise of about 4 mg, 0.1 dps and 0.3 uT RMS at the widest ranges,
+  // as with the DLPF on, and a swing of about 0.1 g and 1.5 dps every 2000
+  // samples
+  int16_t rock = triangle(index, 2000, 200);
+  sample->accel[0] = 100 + rock + noise(index, 0, 14);
+  sample->accel[1] = -200 - rock / 2 + noise(index, 1, 14);
+  sample->accel[2] = 2048 + noise(index, 2, 14);
+  sample->gyro[0] = 10 + rock / 8 + noise(index, 3, 3);
+  sample->gyro[1] = 20 + noise(index, 4, 3);
+  sample->gyro[2] = -30 - rock / 16 + noise(index, 5, 3);
+  sample->temperature = 333 + noise(index, 6, 2);
+  sample->mag[0] = 1000 + rock / 4 + noise(index, 7, 3);
+  sample->mag[1] = -500 + noise(index, 8, 3);
+  sample->mag[2] = 250 - rock / 4 + noise(index, 9, 3);
+}
+
+/*!
+ *    @brief  Create a powered down AK09916
+ */
+AK09916_Sim::AK09916_Sim(void) {
+  now_us = 0;
+  measurements = 0;
+  reset();
+}
+
+/*!
+ *    @brief  Put every register back to its power on value, like a soft
+ *            reset through CNTL3
+ */
+void AK09916_Sim::reset(void) {
+  mode = AK09916_MAG_DATARATE_SHUTDOWN;
+  drdy = dor = hofl = false;
+  data[0] = data[1] = data[2] = 0;
+  single_pending = false;
+  last_us = now_us;
+}
+
+/*!
+ *    @brief  Take any measurements that are due
+ *    @param  now_us The current `micros()` time
+ *    @param  field The magnetic field to measure, in LSB
+ */
+void AK09916_Sim::update(uint32_t now_us, const int16_t *field) {
+  this->now_us = now_us;
+
+  if (single_pending) {
+    single_pending = false;
+    if (mode == AK09916_SELF_TEST) {
+      // the internal magnet, within the datasheet's self test limits
+      const int16_t self_test[3] = {0, 0, -600};
+      measure(self_test);
+    } else {
+      measure(field);
+    }
+    mode = AK09916_MAG_DATARATE_SHUTDOWN;
+    return;
+  }
+
+  uint32_t period_us;
+  switch (mode) {
+  case AK09916_MAG_DATARATE_10_HZ:
+    period_us = 100000;
+    break;
+  case AK09916_MAG_DATARATE_20_HZ:
+    period_us = 50000;
+    break;
+  case AK09916_MAG_DATARATE_50_HZ:
+    period_us = 20000;
+    break;
+  case AK09916_MAG_DATARATE_100_HZ:
+    period_us = 10000;
+    break;
+  default:
+    return;
+  }
+
+  uint32_t due = (now_us - last_us) / period_us;
+  if (!due) {
+    return;
+  }
+  last_us += due * period_us;
+  // only the last of several missed measurements can still be read
+  measurements += due - 1;
+  measure(field);
+  if (due > 1) {
+    dor = true;
+  }
+}
+
+/*!
+ *    @brief  Store a new measurement and set the status bits
+ *    @param  field The magnetic field to measure, in LSB
+ */
+void AK09916_Sim::measure(const int16_t *field) {
+  int32_t sum = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    data[i] = field[i];
+    sum += (field[i] < 0) ? -field[i] : field[i];
+  }
+  hofl = sum * ICM20948_UT_PER_LSB >= AK09916_MAX_UT_SUM;
+  if (drdy) {
+    dor = true;
+  }
+  drdy = true;
+  measurements++;
+}
+
+/*!
+ *    @brief  Read a register over the auxiliary bus. Reading ST2 ends the
+ *            read of a measurement and clears DRDY and DOR
+ *    @param  reg The register to read
+ *    @return The register value
+ */
+uint8_t AK09916_Sim::read(uint8_t reg) {
+  switch (reg) {
+  case AK09916_WIA1:
+    return AK09916_COMPANY_ID;
+  case AK09916_WIA2:
+    return ICM20948_MAG_ID;
+  case AK09916_ST1:
+    return (drdy ? 0x01 : 0) | (dor ? 0x02 : 0);
+  case AK09916_HXL:
+  case AK09916_HYL:
+  case AK09916_HZL:
+    return data[(reg - AK09916_HXL) / 2] & 0xFF;
+  case AK09916_HXH:
+  case AK09916_HYH:
+  case AK09916_HZH:
+    return (uint16_t)data[(reg - AK09916_HXL) / 2] >> 8;
+  case AK09916_ST2:
+    drdy = dor = false;
+    return hofl ? 0x08 : 0;
+  case AK09916_CNTL2:
+    return mode;
+  default:
+    return 0;
+  }
+}
+
+/*!
+ *    @brief  Write a register over the auxiliary bus
+ *    @param  reg The register to write
+ *    @param  value The value to write
+ */
+void AK09916_Sim::write(uint8_t reg, uint8_t value) {
+  if (reg == AK09916_CNTL3) {
+    if (value & 0x01) { // SRST
+      reset();
+    }
+    return;
+  }
+  if (reg != AK09916_CNTL2) {
+    return;
+  }
+
+  mode = value & 0x1F;
+  single_pending = mode == AK09916_SINGLE || mode == AK09916_SELF_TEST;
+  last_us = now_us;
+}
+
+/*!
+ *    @brief  Get the measurement mode
+ *    @return The CNTL2 value
+ */
+uint8_t AK09916_Sim::getMode(void) { return mode; }
+
+/*!
+ *    @brief  Get the number of measurements taken
+ *    @return Measurements since the object was created
+ */
+uint32_t AK09916_Sim::getMeasurementCount(void) { return measurements; }
+
+/*!
+ *    @brief  Create a simulated chip in its power on state. Attach it with
+ *            `attachI2C` or `attachSPI` before calling `begin`
+ *    @param  chip_id The WHOAMI value, `ICM20948_CHIP_ID` or
+ *            `ICM20649_CHIP_ID`. Only the ICM20948 has a magnetometer
+ */
+ICM20X_Sim::ICM20X_Sim(uint8_t chip_id) {
+  this->chip_id = chip_id;
+  timebase_pll = 0;
+  mag_connected = chip_id == ICM20948_CHIP_ID;
+  generator = NULL;
+  free_running = true;
+  i2c_address = -1;
+  spi_cs = -1;
+
+  // 1 g at the widest accel range, still, about 22 degrees C and 150 uT
+  const icm20x_sim_sample_t sample = {
+      {100, -200, 2048}, {10, 20, -30}, 333, {1000, -500, 250}};
+  fixed = sample;
+
+  resetStats();
+  powerOn();
+}
+
+/*!
+ *    @brief  Detach the chip from the bus
+ */
+ICM20X_Sim::~ICM20X_Sim(void) { detach(); }
+
+/*!
+ *    @brief  Add a chip to the devices the bus stand-ins can find
+ *    @param  sim The chip
+ *    @return True if it is attached, false if too many are attached
+ */
+static bool addDevice(ICM20X_Sim *sim) {
+  for (uint8_t i = 0; i < ICM20X_SIM_MAX_DEVICES; i++) {
+    if (attached[i] == sim) {
+      return true;
+    }
+  }
+  for (uint8_t i = 0; i < ICM20X_SIM_MAX_DEVICES; i++) {
+    if (!attached[i]) {
+      attached[i] = sim;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ *    @brief  Answer I2C transfers to an address
+ *    @param  address The 7-bit address, usually 0x68 or 0x69
+ *    @return True if attached, false if another chip has the address or
+ *            too many are attached
+ */
+bool ICM20X_Sim::attachI2C(uint8_t address) {
+  ICM20X_Sim *other = findI2C(address);
+  if ((other && other != this) || !addDevice(this)) {
+    return false;
+  }
+  i2c_address = address & 0x7F;
+  return true;
+}
+
+/*!
+ *    @brief  Answer SPI transfers selected by a chip select pin
+ *    @param  cs_pin The chip select pin
+ *    @return True if attached, false if another chip has the pin or too many
+ *            are attached
+ */
+bool ICM20X_Sim::attachSPI(int8_t cs_pin) {
+  ICM20X_Sim *other = findSPI(cs_pin);
+  if (cs_pin < 0 || (other && other != this) || !addDevice(this)) {
+    return false;
+  }
+  spi_cs = cs_pin;
+  return true;
+}
+
+/*!
+ *    @brief  Stop answering on the bus, as if the chip was unplugged
+ */
+void ICM20X_Sim::detach(void) {
+  for (uint8_t i = 0; i < ICM20X_SIM_MAX_DEVICES; i++) {
+    if (attached[i] == this) {
+      attached[i] = NULL;
+    }
+  }
+  i2c_address = -1;
+  spi_cs = -1;
+}
+
+/*!
+ *    @brief  Find the chip attached at an I2C address
+ *    @param  address The 7-bit address
+ *    @return The chip, or NULL if nothing answers there
+ */
+ICM20X_Sim *ICM20X_Sim::findI2C(uint8_t address) {
+  for (uint8_t i = 0; i < ICM20X_SIM_MAX_DEVICES; i++) {
+    if (attached[i] && attached[i]->i2c_address == (int8_t)address &&
+        !(address & 0x80)) {
+      return attached[i];
+    }
+  }
+  return NULL;
+}
+
+/*!
+ *    @brief  Find the chip attached to a chip select pin
+ *    @param  cs_pin The chip select pin
+ *    @return The chip, or NULL if nothing is selected by the pin
+ */
+ICM20X_Sim *ICM20X_Sim::findSPI(int8_t cs_pin) {
+  for (uint8_t i = 0; i < ICM20X_SIM_MAX_DEVICES; i++) {
+    if (attached[i] && cs_pin >= 0 && attached[i]->spi_cs == cs_pin) {
+      return attached[i];
+    }
+  }
+  return NULL;
+}
+
+/*!
+ *    @brief  Cycle the power: every register, the FIFO, DMP memory and the
+ *            magnetometer go back to their power on state
+ */
+void ICM20X_Sim::powerOn(void) {
+  memset(dmp_memory, 0, sizeof(dmp_memory));
+  dmp_resets = 0;
+  sample_count = 0;
+  memset(&current, 0, sizeof(current));
+  memset(wom_reference, 0, sizeof(wom_reference));
+  mag = AK09916_Sim();
+  resetRegisters();
+}
+
+/*!
+ *    @brief  Put the register file back to its reset values, as DEVICE_RESET
+ *            does. The magnetometer and DMP memory are left alone
+ */
+void ICM20X_Sim::resetRegisters(void) {
+  memset(regs, 0, sizeof(regs));
+  bank = 0;
+  regs[0][ICM20X_B0_WHOAMI] = chip_id;
+  regs[0][ICM20X_B0_LP_CONFIG] = 0x40;
+  regs[0][ICM20X_B0_PWR_MGMT_1] = 0x41; // asleep, auto clock
+  regs[1][ICM20X_B1_TIMEBASE_CORRECTION_PLL] = timebase_pll;
+  regs[2][ICM20X_B2_GYRO_CONFIG_1] = 0x01;
+  regs[2][ICM20X_B2_ACCEL_CONFIG_1] = 0x01;
+  resetFIFO();
+  period_us = 0;
+}
+
+/*!
+ *    @brief  Set the function that makes each sample
+ *    @param  generator The function, or NULL to repeat the sample given to
+ *            `setSample`
+ */
+void ICM20X_Sim::setGenerator(icm20x_sim_generator_t generator) {
+  this->generator = generator;
+}
+
+/*!
+ *    @brief  Set the sample to repeat when there is no generator
+ *    @param  sample The raw values
+ */
+void ICM20X_Sim::setSample(const icm20x_sim_sample_t *sample) {
+  fixed = *sample;
+}
+
+/*!
+ *    @brief  Choose whether samples are made as the simulated clock passes
+ *            each sample period, or only by `sample`
+ *    @param  free_running true: follow the clock, the default false: only
+ *            sample when told
+ */
+void ICM20X_Sim::setFreeRunning(bool free_running) {
+  this->free_running = free_running;
+  period_us = 0;
+}
+
+/*!
+ *    @brief  Take samples now, as if that many sample periods passed
+ *    @param  count The number of samples
+ */
+void ICM20X_Sim::sample(uint16_t count) {
+  mag.update(micros(), current.mag);
+  while (count--) {
+    generateSample();
+  }
+}
+
+/*!
+ *    @brief  Get the number of samples taken
+ *    @return Samples since `powerOn`
+ */
+uint32_t ICM20X_Sim::getSampleCount(void) { return sample_count; }
+
+/*!
+ *    @brief  Connect or disconnect the AK09916 from the auxiliary bus
+ *    @param  connected true: it answers at `AK09916_SIM_ADDRESS`
+ */
+void ICM20X_Sim::setMagConnected(bool connected) { mag_connected = connected; }
+
+/*!
+ *    @brief  Get the magnetometer on the auxiliary bus
+ *    @return The AK09916
+ */
+AK09916_Sim *ICM20X_Sim::getMag(void) { return &mag; }
+
+/*!
+ *    @brief  Set the factory TIMEBASE_CORRECTION_PLL value
+ *    @param  pll The sign and magnitude register value
+ */
+void ICM20X_Sim::setTimebaseCorrection(uint8_t pll) {
+  timebase_pll = pll;
+  regs[1][ICM20X_B1_TIMEBASE_CORRECTION_PLL] = pll;
+}
+
+/*!
+ *    @brief  Read registers starting at an address in the current bank,
+ *            as one bus transfer. The address advances after each byte
+ *            except for the FIFO and DMP memory ports
+ *    @param  reg The first register
+ *    @param  buffer Where to store the values
+ *    @param  len The number of registers to read
+ */
+void ICM20X_Sim::busRead(uint8_t reg, uint8_t *buffer, size_t len) {
+  update();
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = readRegister(reg);
+    if (autoIncrements(reg)) {
+      reg = (reg + 1) & 0x7F;
+    }
+  }
+}
+
+/*!
+ *    @brief  Write registers starting at an address in the current bank,
+ *            as one bus transfer
+ *    @param  reg The first register
+ *    @param  buffer The values to write
+ *    @param  len The number of registers to write
+ */
+void ICM20X_Sim::busWrite(uint8_t reg, const uint8_t *buffer, size_t len) {
+  update();
+  for (size_t i = 0; i < len; i++) {
+    writeRegister(reg, buffer[i]);
+    if (autoIncrements(reg)) {
+      reg = (reg + 1) & 0x7F;
+    }
+  }
+  // start the new sample period now if the write changed it
+  update();
+}
+
+/*!
+ *    @brief  Add a transfer to the bus statistics. Called by the BusIO
+ *            stand-ins
+ *    @param  bytes Bytes on the bus, including address bytes
+ *    @param  bus_us How long the transfer took
+ */
+void ICM20X_Sim::countTransfer(uint32_t bytes, uint32_t bus_us) {
+  stats.transactions++;
+  stats.bytes += bytes;
+  stats.bus_us += bus_us;
+}
+
+/*!
+ *    @brief  Look at a register without the side effects of a bus read
+ *    @param  bank The register bank
+ *    @param  reg The register
+ *    @return The register value
+ */
+uint8_t ICM20X_Sim::getRegister(uint8_t bank, uint8_t reg) {
+  if (reg == ICM20X_B0_REG_BANK_SEL) {
+    return this->bank << 4;
+  }
+  return regs[bank & 0x03][reg & 0x7F];
+}
+
+/*!
+ *    @brief  Change a register without the side effects of a bus write, i.e.
+ *            to raise a status bit
+ *    @param  bank The register bank
+ *    @param  reg The register
+ *    @param  value The new value
+ */
+void ICM20X_Sim::setRegister(uint8_t bank, uint8_t reg, uint8_t value) {
+  regs[bank & 0x03][reg & 0x7F] = value;
+}
+
+/*!
+ *    @brief  Get the bank selected by REG_BANK_SEL
+ *    @return The bank number
+ */
+uint8_t ICM20X_Sim::getBank(void) { return bank; }
+
+/*!
+ *    @brief  Get the number of bytes in the FIFO
+ *    @return The FIFO byte count
+ */
+uint16_t ICM20X_Sim::getFIFOCount(void) { return fifo_count; }
+
+/*!
+ *    @brief  Add bytes to the FIFO, such as DMP packets
+ *    @param  data The bytes
+ *    @param  len The number of bytes
+ *    @return True if they fit without overflowing
+ */
+bool ICM20X_Sim::pushFIFO(const uint8_t *data, uint16_t len) {
+  bool fits = fifo_count + len <= ICM20X_SIM_FIFO_SIZE;
+  writeFIFO(data, len);
+  return fits;
+}
+
+/*!
+ *    @brief  Get the DMP memory, to check what was loaded
+ *    @return `ICM20X_SIM_DMP_MEMORY_SIZE` bytes, indexed by bank * 256 +
+ *            address
+ */
+const uint8_t *ICM20X_Sim::getDMPMemory(void) { return dmp_memory; }
+
+/*!
+ *    @brief  Get the number of times DMP_RST was set
+ *    @return DMP resets since `powerOn`
+ */
+uint32_t ICM20X_Sim::getDMPResetCount(void) { return dmp_resets; }
+
+/*!
+ *    @brief  Get the bus traffic since the last `resetStats`
+ *    @param  stats The statistics to fill in
+ */
+void ICM20X_Sim::getStats(icm20x_sim_stats_t *stats) { *stats = this->stats; }
+
+/*!
+ *    @brief  Zero the bus statistics
+ */
+void ICM20X_Sim::resetStats(void) { memset(&stats, 0, sizeof(stats)); }
+
+/*!
+ *    @brief  Catch up with the simulated clock before a transfer: take the
+ *            magnetometer measurements and samples that are due
+ */
+void ICM20X_Sim::update(void) {
+  uint32_t now_us = micros();
+  mag.update(now_us, current.mag);
+  if (!free_running) {
+    return;
+  }
+
+  uint32_t period = samplePeriodMicros();
+  if (period != period_us) {
+    // a new rate, or waking up, starts a fresh sample period
+    period_us = period;
+    next_sample_us = now_us + period;
+    return;
+  }
+  if (!period || (int32_t)(now_us - next_sample_us) < 0) {
+    return;
+  }
+
+  uint32_t due = (now_us - next_sample_us) / period + 1;
+  next_sample_us += due * period;
+  if (due > ICM20X_SIM_MAX_CATCH_UP) {
+    due = ICM20X_SIM_MAX_CATCH_UP;
+  }
+  while (due--) {
+    generateSample();
+  }
+}
+
+/*!
+ *    @brief  Work out the sample period from the power, divisor and FCHOICE
+ *            settings
+ *    @return The period of the faster of the gyro and accelerometer in
+ *            microseconds, or 0 if neither is running
+ */
+uint32_t ICM20X_Sim::samplePeriodMicros(void) {
+  if (regs[0][ICM20X_B0_PWR_MGMT_1] & 0x40) {
+    return 0; // asleep
+  }
+
+  uint32_t period = 0;
+  if ((regs[0][ICM20X_B0_PWR_MGMT_2] & 0x07) != 0x07) {
+    uint8_t divisor = regs[2][ICM20X_B2_GYRO_SMPLRT_DIV];
+    period = (regs[2][ICM20X_B2_GYRO_CONFIG_1] & 0x01)
+                 ? (1 + divisor) * 1000000UL / 1100
+                 : 1000000UL / 9000;
+  }
+  if ((regs[0][ICM20X_B0_PWR_MGMT_2] & 0x38) != 0x38) {
+    uint16_t divisor = (regs[2][ICM20X_B2_ACCEL_SMPLRT_DIV_1] & 0x0F) << 8 |
+                       regs[2][ICM20X_B2_ACCEL_SMPLRT_DIV_2];
+    uint32_t accel_period = (regs[2][ICM20X_B2_ACCEL_CONFIG_1] & 0x01)
+                                ? (1 + divisor) * 1000000UL / 1125
+                                : 1000000UL / 4500;
+    if (!period || accel_period < period) {
+      period = accel_period;
+    }
+  }
+  return period;
+}
+
+/*!
+ *    @brief  Take one sample: update the data registers of the powered
+ *            sensors, run slaves 0-3, raise data ready and fill the FIFO
+ */
+void ICM20X_Sim::generateSample(void) {
+  sample_count++;
+  if (generator) {
+    generator(sample_count, &current);
+  } else {
+    current = fixed;
+  }
+
+  uint8_t *data = &regs[0][ICM20X_B0_ACCEL_XOUT_H];
+  if ((regs[0][ICM20X_B0_PWR_MGMT_2] & 0x38) != 0x38) {
+    for (uint8_t i = 0; i < 3; i++) {
+      put16(data + 2 * i, current.accel[i]);
+    }
+    checkWakeOnMotion();
+  }
+  if ((regs[0][ICM20X_B0_PWR_MGMT_2] & 0x07) != 0x07) {
+    for (uint8_t i = 0; i < 3; i++) {
+      put16(data + 6 + 2 * i, current.gyro[i]);
+    }
+  }
+  if (!(regs[0][ICM20X_B0_PWR_MGMT_1] & 0x08)) {
+    put16(data + 12, current.temperature);
+  }
+
+  // frames are in register order: accel, gyro X Y Z, temp, slave data
+  uint8_t frame[14 + ICM20X_SIM_EXT_DATA_SIZE];
+  uint8_t len = 0;
+  uint8_t fifo_en_2 = regs[0][ICM20X_B0_FIFO_EN_2];
+  if (fifo_en_2 & 0x10) {
+    memcpy(frame, data, 6);
+    len += 6;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    if (fifo_en_2 & (0x02 << i)) {
+      memcpy(frame + len, data + 6 + 2 * i, 2);
+      len += 2;
+    }
+  }
+  if (fifo_en_2 & 0x01) {
+    memcpy(frame + len, data + 12, 2);
+    len += 2;
+  }
+  len += runSlaves(frame + len);
+
+  regs[0][ICM20X_B0_INT_STATUS_1] |= 0x01; // RAW_DATA_0_RDY_INT
+
+  if ((regs[0][ICM20X_B0_USER_CTRL] & 0x40) &&
+      !(regs[0][ICM20X_B0_FIFO_RST] & 0x1F) && len) {
+    writeFIFO(frame, len);
+  }
+}
+
+/*!
+ *    @brief  Raise WOM_INT if any accel axis moved further than the
+ *            threshold since the reference sample
+ */
+void ICM20X_Sim::checkWakeOnMotion(void) {
+  uint8_t intel_ctrl = regs[2][ICM20X_B2_ACCEL_INTEL_CTRL];
+  bool compare_previous = intel_ctrl & 0x01;
+  if (!(intel_ctrl & 0x02)) { // ACCEL_INTEL_EN
+    memcpy(wom_reference, current.accel, sizeof(wom_reference));
+    return;
+  }
+
+  uint8_t range = (regs[2][ICM20X_B2_ACCEL_CONFIG_1] >> 1) & 0x03;
+  int32_t lsb_per_g = ((chip_id == ICM20948_CHIP_ID) ? 16384 : 8192) >> range;
+  int32_t threshold = (int32_t)regs[2][ICM20X_B2_ACCEL_WOM_THR] *
+                      ICM20X_WOM_MG_PER_LSB * lsb_per_g / 1000;
+
+  for (uint8_t i = 0; i < 3; i++) {
+    int32_t change = (int32_t)current.accel[i] - wom_reference[i];
+    if (change > threshold || -change > threshold) {
+      regs[0][ICM20X_B0_INT_STATUS] |= 0x08; // WOM_INT
+    }
+  }
+  if (compare_previous) {
+    memcpy(wom_reference, current.accel, sizeof(wom_reference));
+  }
+}
+
+/*!
+ *    @brief  Run the transfers of the enabled slaves 0-3, as the I2C master
+ *            does at every sample. Reads land in EXT_SLV_SENS_DATA one slave
+ *            after another; a slave that isn't answering sets its NACK bit
+ *    @param  fifo_data Where to copy the bytes of slaves with their FIFO
+ *            enable bit set
+ *    @return The number of bytes added to `fifo_data`
+ */
+uint8_t ICM20X_Sim::runSlaves(uint8_t *fifo_data) {
+  if (!(regs[0][ICM20X_B0_USER_CTRL] & 0x20)) { // I2C_MST_EN
+    return 0;
+  }
+
+  uint8_t ext = 0, fifo_len = 0;
+  for (uint8_t slave = 0; slave < 4; slave++) {
+    const uint8_t *slv = &regs[3][ICM20X_B3_I2C_SLV0_ADDR + 4 * slave];
+    uint8_t address = slv[0] & 0x7F, reg = slv[1], ctrl = slv[2];
+    uint8_t len = ctrl & 0x0F;
+    if (!(ctrl & 0x80) || !len) {
+      continue;
+    }
+
+    bool ok = true;
+    if (slv[0] & 0x80) {
+      for (uint8_t i = 0; i < len && ext < ICM20X_SIM_EXT_DATA_SIZE; i++) {
+        uint8_t value;
+        ok = auxRead(address, reg + i, &value);
+        if (!ok) {
+          break;
+        }
+        regs[0][ICM20X_B0_EXT_SLV_SENS_DATA_00 + ext++] = value;
+        if (regs[0][ICM20X_B0_FIFO_EN_1] & (1 << slave)) {
+          fifo_data[fifo_len++] = value;
+        }
+      }
+    } else {
+      ok = auxWrite(address, reg, slv[3]);
+    }
+    if (!ok) {
+      regs[0][ICM20X_B0_I2C_MST_STATUS] |= 1 << slave; // I2C_SLVn_NACK
+    }
+  }
+  return fifo_len;
+}
+
+/*!
+ *    @brief  Run the single transfer set up in the slave 4 registers and
+ *            report it in I2C_MST_STATUS
+ */
+void ICM20X_Sim::runSlave4(void) {
+  uint8_t address = regs[3][ICM20X_B3_I2C_SLV4_ADDR];
+  uint8_t reg = regs[3][ICM20X_B3_I2C_SLV4_REG];
+
+  bool ok;
+  if (address & 0x80) {
+    uint8_t value = 0;
+    ok = auxRead(address & 0x7F, reg, &value);
+    if (ok) {
+      regs[3][ICM20X_B3_I2C_SLV4_DI] = value;
+    }
+  } else {
+    ok = auxWrite(address, reg, regs[3][ICM20X_B3_I2C_SLV4_DO]);
+  }
+
+  // I2C_SLV4_DONE, and I2C_SLV4_NACK if nothing answered
+  regs[0][ICM20X_B0_I2C_MST_STATUS] |= ok ? 0x40 : 0x50;
+  regs[3][ICM20X_B3_I2C_SLV4_CTRL] &= 0x7F; // the enable clears when done
+}
+
+/*!
+ *    @brief  Read a register of a device on the auxiliary bus
+ *    @param  address The 7-bit address
+ *    @param  reg The register
+ *    @param  value Where to store the value
+ *    @return True if a device answered
+ */
+bool ICM20X_Sim::auxRead(uint8_t address, uint8_t reg, uint8_t *value) {
+  if (address != AK09916_SIM_ADDRESS || !mag_connected) {
+    return false;
+  }
+  *value = mag.read(reg);
+  return true;
+}
+
+/*!
+ *    @brief  Write a register of a device on the auxiliary bus
+ *    @param  address The 7-bit address
+ *    @param  reg The register
+ *    @param  value The value to write
+ *    @return True if a device answered
+ */
+bool ICM20X_Sim::auxWrite(uint8_t address, uint8_t reg, uint8_t value) {
+  if (address != AK09916_SIM_ADDRESS || !mag_connected) {
+    return false;
+  }
+  mag.write(reg, value);
+  return true;
+}
+
+/*!
+ *    @brief  Add bytes to the FIFO. When it is full, stream mode drops the
+ *            oldest bytes and snapshot mode drops the new ones; both raise
+ *            FIFO_OVERFLOW_INT
+ *    @param  data The bytes
+ *    @param  len The number of bytes
+ */
+void ICM20X_Sim::writeFIFO(const uint8_t *data, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    if (fifo_count == ICM20X_SIM_FIFO_SIZE) {
+      regs[0][ICM20X_B0_INT_STATUS_2] |= 0x01;
+      if (regs[0][ICM20X_B0_FIFO_MODE] & 0x01) {
+        return; // snapshot
+      }
+      fifo_head = (fifo_head + 1) % ICM20X_SIM_FIFO_SIZE;
+      fifo_count--;
+    }
+    fifo[(fifo_head + fifo_count) % ICM20X_SIM_FIFO_SIZE] = data[i];
+    fifo_count++;
+  }
+}
+
+/*!
+ *    @brief  Empty the FIFO
+ */
+void ICM20X_Sim::resetFIFO(void) {
+  fifo_head = 0;
+  fifo_count = 0;
+}
+
+/*!
+ *    @brief  Read a register in the current bank, with the side effects of
+ *            a bus read: status registers clear and the FIFO and DMP memory
+ *            ports advance
+ *    @param  reg The register
+ *    @return The register value
+ */
+uint8_t ICM20X_Sim::readRegister(uint8_t reg) {
+  reg &= 0x7F;
+  if (reg == ICM20X_B0_REG_BANK_SEL) {
+    return bank << 4;
+  }
+  if (bank != 0) {
+    return regs[bank][reg];
+  }
+
+  uint8_t value = regs[0][reg];
+  switch (reg) {
+  case ICM20X_B0_I2C_MST_STATUS:
+  case ICM20X_B0_INT_STATUS:
+  case ICM20X_B0_INT_STATUS_1:
+  case ICM20X_B0_INT_STATUS_2:
+  case ICM20X_B0_INT_STATUS_3:
+    regs[0][reg] = 0; // clear on read
+    return value;
+
+  case ICM20X_B0_FIFO_COUNT_H:
+    return (fifo_count >> 8) & 0x1F;
+  case ICM20X_B0_FIFO_COUNT_L:
+    return fifo_count & 0xFF;
+
+  case ICM20X_B0_FIFO_R_W:
+    if (!fifo_count) {
+      return 0xFF;
+    }
+    value = fifo[fifo_head];
+    fifo_head = (fifo_head + 1) % ICM20X_SIM_FIFO_SIZE;
+    fifo_count--;
+    return value;
+
+  case ICM20948_B0_MEM_R_W:
+    value = dmp_memory[regs[0][ICM20948_B0_MEM_BANK_SEL] << 8 |
+                       regs[0][ICM20948_B0_MEM_START_ADDR]];
+    regs[0][ICM20948_B0_MEM_START_ADDR]++;
+    return value;
+
+  default:
+    return value;
+  }
+}
+
+/*!
+ *    @brief  Write a register in the current bank, with the side effects of
+ *            a bus write. Read only registers are left alone
+ *    @param  reg The register
+ *    @param  value The value to write
+ */
+void ICM20X_Sim::writeRegister(uint8_t reg, uint8_t value) {
+  reg &= 0x7F;
+  if (reg == ICM20X_B0_REG_BANK_SEL) {
+    bank = (value >> 4) & 0x03;
+    stats.bank_selects++;
+    return;
+  }
+
+  if (bank == 0) {
+    switch (reg) {
+    case ICM20X_B0_WHOAMI:
+    case ICM20X_B0_I2C_MST_STATUS:
+    case ICM20X_B0_INT_STATUS:
+    case ICM20X_B0_INT_STATUS_1:
+    case ICM20X_B0_INT_STATUS_2:
+    case ICM20X_B0_INT_STATUS_3:
+    case ICM20X_B0_FIFO_COUNT_H:
+    case ICM20X_B0_FIFO_COUNT_L:
+      return;
+
+    case ICM20X_B0_USER_CTRL:
+      if (value & 0x08) { // DMP_RST
+        dmp_resets++;
+      }
+      if (value & 0x02) { // I2C_MST_RST
+        regs[0][ICM20X_B0_I2C_MST_STATUS] = 0;
+      }
+      value &= ~0x0E; // the reset bits clear themselves
+      break;
+
+    case ICM20X_B0_PWR_MGMT_1:
+      if (value & 0x80) { // DEVICE_RESET
+        resetRegisters();
+        return;
+      }
+      break;
+
+    case ICM20X_B0_FIFO_RST:
+      if (value & 0x1F) {
+        resetFIFO();
+      }
+      break;
+
+    case ICM20X_B0_FIFO_R_W:
+      writeFIFO(&value, 1);
+      return;
+
+    case ICM20948_B0_MEM_R_W:
+      dmp_memory[regs[0][ICM20948_B0_MEM_BANK_SEL] << 8 |
+                 regs[0][ICM20948_B0_MEM_START_ADDR]] = value;
+      regs[0][ICM20948_B0_MEM_START_ADDR]++;
+      return;
+
+    default:
+      if (reg >= ICM20X_B0_ACCEL_XOUT_H &&
+          reg < ICM20X_B0_EXT_SLV_SENS_DATA_00 + ICM20X_SIM_EXT_DATA_SIZE) {
+        return; // sensor and slave data
+      }
+      break;
+    }
+  } else if ((bank == 1 && reg == ICM20X_B1_TIMEBASE_CORRECTION_PLL) ||
+             (bank == 3 && reg == ICM20X_B3_I2C_SLV4_DI)) {
+    return;
+  }
+
+  regs[bank][reg] = value;
+
+  if (bank == 3 && reg == ICM20X_B3_I2C_SLV4_CTRL && (value & 0x80) &&
+      (regs[0][ICM20X_B0_USER_CTRL] & 0x20)) {
+    runSlave4();
+  }
+}
+
+/*!
+ *    @brief  Check if a burst moves on to the next register after this one
+ *    @param  reg The register just accessed
+ *    @return False for the FIFO and DMP memory ports
+ */
+bool ICM20X_Sim::autoIncrements(uint8_t reg) {
+  return bank != 0 ||
+         (reg != ICM20X_B0_FIFO_R_W && reg != ICM20948_B0_MEM_R_W);
+}
@@ -0,0 +1,180 @@
+/*!
+ *  @file ICM20X_Sim.h
+ *
+ *  Register level simulation of the ICM20948 and ICM20649, for running the
+ *  library on a desktop. The BusIO stand-ins in stubs/ send every transfer
+ *  to the simulated chip attached at the device's I2C address or SPI chip
+ *  select, count the bytes and move the simulated clock by the time the
+ *  transfer would take on the bus
+ *
+ *  Modelled:
+ *  - all four register banks, REG_BANK_SEL and the power on values
+ *  - WHOAMI, DEVICE_RESET, sleep and the per sensor power bits
+ *  - samples at the rate set by the divisors and FCHOICE bits, with the data
+ *    ready and wake on motion interrupt status
+ *  - the FIFO in stream and snapshot mode, with overflow status
+ *  - the I2C master: slaves 0-3 at every sample, slave 4 single transfers
+ *  - an AK09916 on the auxiliary bus of the ICM20948
+ *  - DMP memory, so firmware loads and settings can be checked. The DMP
+ *    itself does not run; push its packets with `pushFIFO`
+ *
+ *  Both sensors sample at the faster of the gyro and accelerometer rates,
+ *  and slave 4 transfers finish as soon as they are started
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_SIM_H
+#define _ICM20X_SIM_H
+
+#include <Adafruit_ICM20X.h>
+
+#define ICM20X_SIM_FIFO_SIZE 512 ///< FIFO bytes
+#define ICM20X_SIM_EXT_DATA_SIZE                                               \
+  24 ///< EXT_SLV_SENS_DATA bytes shared by slaves 0-3
+#define ICM20X_SIM_MAX_CATCH_UP                                                \
+  1000 ///< Most samples generated for one gap in bus traffic
+#define ICM20X_SIM_DMP_MEMORY_SIZE 65536 ///< DMP memory bytes, 256 banks
+#define ICM20X_SIM_MAX_DEVICES 8         ///< Chips that can be attached at once
+#define AK09916_SIM_ADDRESS 0x0C         ///< AK09916 auxiliary bus address
+
+/** One sample of every sensor, as raw register values */
+typedef struct {
+  int16_t accel[3];    ///< Accel X, Y and Z
+  int16_t gyro[3];     ///< Gyro X, Y and Z
+  int16_t temperature; ///< Temperature
+  int16_t mag[3];      ///< Magnetic field measured by the AK09916
+} icm20x_sim_sample_t;
+
+/** Fills in sample number `index`, counting from 1 after `powerOn` */
+typedef void (*icm20x_sim_generator_t)(uint32_t index,
+                                       icm20x_sim_sample_t *sample);
+
+void icm20x_sim_noisy_sample(uint32_t index, icm20x_sim_sample_t *sample);
+
+/** Bus traffic seen by one simulated chip */
+typedef struct {
+  uint32_t transactions; ///< Transfers, each with its own register address
+  uint32_t bytes;        ///< Bytes on the bus, including address bytes
+  uint32_t bus_us;       ///< Time the transfers took at the bus clock
+  uint32_t bank_selects; ///< Writes to REG_BANK_SEL
+} icm20x_sim_stats_t;
+
+/*!
+ *    @brief  Class that simulates the AK09916 magnetometer
+ */
+class AK09916_Sim {
+public:
+  AK09916_Sim(void);
+
+  void reset(void);
+  void update(uint32_t now_us, const int16_t *field);
+  uint8_t read(uint8_t reg);
+  void write(uint8_t reg, uint8_t value);
+
+  uint8_t getMode(void);
+  uint32_t getMeasurementCount(void);
+
+private:
+  uint8_t mode;          ///< CNTL2
+  bool drdy;             ///< ST1 data ready
+  bool dor;              ///< ST1 data overrun
+  bool hofl;             ///< ST2 magnetic sensor overflow
+  int16_t data[3];       ///< Latest measurement
+  bool single_pending;   ///< Measure at the next update
+  uint32_t last_us;      ///< Time of the last continuous measurement
+  uint32_t now_us;       ///< Time of the last update
+  uint32_t measurements; ///< Measurements since power on
+
+  void measure(const int16_t *field);
+};
+
+/*!
+ *    @brief  Class that simulates an ICM20948 or ICM20649 register file
+ */
+class ICM20X_Sim {
+public:
+  ICM20X_Sim(uint8_t chip_id = ICM20948_CHIP_ID);
+  ~ICM20X_Sim(void);
+  ICM20X_Sim(const ICM20X_Sim &) = delete;
+  ICM20X_Sim &operator=(const ICM20X_Sim &) = delete;
+
+  bool attachI2C(uint8_t address);
+  bool attachSPI(int8_t cs_pin);
+  void detach(void);
+  static ICM20X_Sim *findI2C(uint8_t address);
+  static ICM20X_Sim *findSPI(int8_t cs_pin);
+
+  void powerOn(void);
+  void setGenerator(icm20x_sim_generator_t generator);
+  void setSample(const icm20x_sim_sample_t *sample);
+  void setFreeRunning(bool free_running);
+  void sample(uint16_t count = 1);
+  uint32_t getSampleCount(void);
+
+  void setMagConnected(bool connected);
+  AK09916_Sim *getMag(void);
+  void setTimebaseCorrection(uint8_t pll);
+
+  void busRead(uint8_t reg, uint8_t *buffer, size_t len);
+  void busWrite(uint8_t reg, const uint8_t *buffer, size_t len);
+  void countTransfer(uint32_t bytes, uint32_t bus_us);
+
+  uint8_t getRegister(uint8_t bank, uint8_t reg);
+  void setRegister(uint8_t bank, uint8_t reg, uint8_t value);
+  uint8_t getBank(void);
+  uint16_t getFIFOCount(void);
+  bool pushFIFO(const uint8_t *data, uint16_t len);
+  const uint8_t *getDMPMemory(void);
+  uint32_t getDMPResetCount(void);
+
+  void getStats(icm20x_sim_stats_t *stats);
+  void resetStats(void);
+
+private:
+  uint8_t chip_id;      ///< WHOAMI value
+  uint8_t regs[4][128]; ///< Register file, by bank
+  uint8_t bank;         ///< Selected bank
+  uint8_t timebase_pll; ///< TIMEBASE_CORRECTION_PLL, kept over resets
+
+  uint8_t fifo[ICM20X_SIM_FIFO_SIZE]; ///< FIFO ring
+  uint16_t fifo_head;                 ///< Oldest FIFO byte
+  uint16_t fifo_count;                ///< Bytes in the FIFO
+
+  uint8_t dmp_memory[ICM20X_SIM_DMP_MEMORY_SIZE]; ///< DMP memory
+  uint32_t dmp_resets;                            ///< DMP_RST writes
+
+  AK09916_Sim mag;    ///< Magnetometer on the auxiliary bus
+  bool mag_connected; ///< Does the magnetometer answer
+
+  icm20x_sim_generator_t generator; ///< Makes samples, or NULL
+  icm20x_sim_sample_t fixed;        ///< Sample used without a generator
+  icm20x_sim_sample_t current;      ///< Latest sample
+  int16_t wom_reference[3];         ///< Accel sample wake on motion compares
+  bool free_running;                ///< Generate samples as time passes
+  uint32_t sample_count;            ///< Samples since power on
+  uint32_t period_us;               ///< Sample period of the last update
+  uint32_t next_sample_us;          ///< When the next sample is due
+
+  icm20x_sim_stats_t stats; ///< Bus traffic since `resetStats`
+
+  int8_t i2c_address; ///< Attached I2C address, or -1
+  int8_t spi_cs;      ///< Attached chip select, or -1
+
+  void resetRegisters(void);
+  void update(void);
+  uint32_t samplePeriodMicros(void);
+  void generateSample(void);
+  void checkWakeOnMotion(void);
+  uint8_t runSlaves(uint8_t *fifo_data);
+  void runSlave4(void);
+  bool auxRead(uint8_t address, uint8_t reg, uint8_t *value);
+  bool auxWrite(uint8_t address, uint8_t reg, uint8_t value);
+  void writeFIFO(const uint8_t *data, uint16_t len);
+  void resetFIFO(void);
+  uint8_t readRegister(uint8_t reg);
+  void writeRegister(uint8_t reg, uint8_t value);
+  bool autoIncrements(uint8_t reg);
+};
+
+#endif
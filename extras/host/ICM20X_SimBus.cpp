@@ -0,0 +1,311 @@
+/*!
+ *  @file ICM20X_SimBus.cpp
+ *
+ *  The BusIO I2C and SPI device stand-ins. Each transfer goes to the
+ *  simulated chip attached at the device's address or chip select, is added
+ *  to that chip's bus statistics and moves the simulated clock by the time
+ *  it would take at the bus clock
+ *
+ *  BSD license (see license.txt)
+ */
+
+#include "ICM20X_Sim.h"
+#include <Adafruit_I2CDevice.h>
+#include <Adafruit_SPIDevice.h>
+
+#define ICM20X_SIM_I2C_BITS_PER_BYTE 9 ///< 8 data bits and the ACK
+#define ICM20X_SIM_SPI_READ 0x80       ///< Read bit of the register address
+
+/*!
+ *    @brief  Record a transfer and let its time pass
+ *    @param  sim The chip on the other end
+ *    @param  bytes Bytes on the bus, including address bytes
+ *    @param  bits Clock cycles on the bus
+ *    @param  clock Bus clock in Hz
+ */
+static void finishTransfer(ICM20X_Sim *sim, uint32_t bytes, uint32_t bits,
+                           uint32_t clock) {
+  uint32_t bus_us = ((uint64_t)bits * 1000000 + clock - 1) / clock;
+  sim->countTransfer(bytes, bus_us);
+  hostAdvanceMicros(bus_us);
+}
+
+/*!
+ *    @brief  Create an I2C device
+ *    @param  addr The 7-bit address
+ *    @param  theWire The bus, which sets the clock
+ */
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire) {
+  _addr = addr;
+  _wire = theWire;
+  _begun = false;
+  _speed = 0;
+}
+
+/*!
+ *    @brief  Get the device address
+ *    @return The 7-bit address
+ */
+uint8_t Adafruit_I2CDevice::address(void) { return _addr; }
+
+/*!
+ *    @brief  Start using the device
+ *    @param  addr_detect Check that a chip answers at the address
+ *    @return True if a chip answers, or if detection was skipped
+ */
+bool Adafruit_I2CDevice::begin(bool addr_detect) {
+  _wire->begin();
+  _begun = true;
+  if (addr_detect) {
+    return detected();
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Stop using the device
+ */
+void Adafruit_I2CDevice::end(void) { _begun = false; }
+
+/*!
+ *    @brief  Address the device without data, as BusIO does to detect it
+ *    @return True if a chip acknowledged
+ */
+bool Adafruit_I2CDevice::detected(void) {
+  ICM20X_Sim *sim = ICM20X_Sim::findI2C(_addr);
+  if (!sim) {
+    return false;
+  }
+  finishTransfer(sim, 1, ICM20X_SIM_I2C_BITS_PER_BYTE + 2,
+                 _speed ? _speed : _wire->getClock());
+  return true;
+}
+
+/*!
+ *    @brief  Read without setting a register first. The simulated chips
+ *            need a register address in the same transfer, so this fails
+ *    @param  buffer Unused
+ *    @param  len Unused
+ *    @param  stop Unused
+ *    @return False
+ */
+bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+  (void)buffer;
+  (void)len;
+  (void)stop;
+  return false;
+}
+
+/*!
+ *    @brief  Write a register address followed by data
+ *    @param  buffer The data, or the register address when there is no
+ *            prefix
+ *    @param  len The number of bytes in `buffer`
+ *    @param  stop Unused, every transfer ends with a stop
+ *    @param  prefix_buffer Bytes to send first, usually the register address
+ *    @param  prefix_len The number of bytes in `prefix_buffer`
+ *    @return True if the chip acknowledged
+ */
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  (void)stop;
+  ICM20X_Sim *sim = ICM20X_Sim::findI2C(_addr);
+  if (!sim || prefix_len + len == 0) {
+    return false;
+  }
+
+  // the first byte is the register, the rest is written from there on
+  uint8_t reg;
+  if (prefix_len) {
+    reg = prefix_buffer[0];
+    sim->busWrite(reg, prefix_buffer + 1, prefix_len - 1);
+    sim->busWrite(reg + prefix_len - 1, buffer, len);
+  } else {
+    reg = buffer[0];
+    sim->busWrite(reg, buffer + 1, len - 1);
+  }
+
+  uint32_t bytes = 1 + prefix_len + len;
+  finishTransfer(sim, bytes, bytes * ICM20X_SIM_I2C_BITS_PER_BYTE + 2,
+                 _speed ? _speed : _wire->getClock());
+  return true;
+}
+
+/*!
+ *    @brief  Write a register address, then read from it after a repeated
+ *            start
+ *    @param  write_buffer The register address
+ *    @param  write_len The number of bytes in `write_buffer`
+ *    @param  read_buffer Where to store the data
+ *    @param  read_len The number of bytes to read
+ *    @param  stop Unused
+ *    @return True if the chip acknowledged
+ */
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len,
+                                         uint8_t *read_buffer, size_t read_len,
+                                         bool stop) {
+  (void)stop;
+  ICM20X_Sim *sim = ICM20X_Sim::findI2C(_addr);
+  if (!sim || write_len == 0) {
+    return false;
+  }
+
+  sim->busRead(write_buffer[0], read_buffer, read_len);
+
+  // two address bytes and a repeated start
+  uint32_t bytes = 2 + write_len + read_len;
+  finishTransfer(sim, bytes, bytes * ICM20X_SIM_I2C_BITS_PER_BYTE + 3,
+                 _speed ? _speed : _wire->getClock());
+  return true;
+}
+
+/*!
+ *    @brief  Set the clock for this device's transfers
+ *    @param  desiredclk The clock in Hz
+ *    @return True
+ */
+bool Adafruit_I2CDevice::setSpeed(uint32_t desiredclk) {
+  _speed = desiredclk;
+  return true;
+}
+
+/*!
+ *    @brief  Create a device on the hardware SPI bus
+ *    @param  cspin The chip select pin
+ *    @param  freq The clock in Hz
+ *    @param  dataOrder Unused
+ *    @param  dataMode Unused
+ *    @param  theSPI Unused
+ */
+Adafruit_SPIDevice::Adafruit_SPIDevice(int8_t cspin, uint32_t freq,
+                                       BusIOBitOrder dataOrder,
+                                       uint8_t dataMode, SPIClass *theSPI) {
+  (void)dataOrder;
+  (void)dataMode;
+  (void)theSPI;
+  _cs = cspin;
+  _freq = freq;
+  _begun = false;
+}
+
+/*!
+ *    @brief  Create a device on a software SPI bus
+ *    @param  cspin The chip select pin
+ *    @param  sck Unused
+ *    @param  miso Unused
+ *    @param  mosi Unused
+ *    @param  freq The clock in Hz
+ *    @param  dataOrder Unused
+ *    @param  dataMode Unused
+ */
+Adafruit_SPIDevice::Adafruit_SPIDevice(int8_t cspin, int8_t sck, int8_t miso,
+                                       int8_t mosi, uint32_t freq,
+                                       BusIOBitOrder dataOrder,
+                                       uint8_t dataMode) {
+  (void)sck;
+  (void)miso;
+  (void)mosi;
+  (void)dataOrder;
+  (void)dataMode;
+  _cs = cspin;
+  _freq = freq;
+  _begun = false;
+}
+
+/*!
+ *    @brief  Start using the device. SPI has no acknowledge, so this
+ *            succeeds whether or not a chip is attached
+ *    @return True
+ */
+bool Adafruit_SPIDevice::begin(void) {
+  _begun = true;
+  return true;
+}
+
+/*!
+ *    @brief  Clock in bytes without sending an address
+ *    @param  buffer Where to store the bytes, 0xFF as nothing drives MISO
+ *    @param  len The number of bytes
+ *    @param  sendvalue Unused
+ *    @return True
+ */
+bool Adafruit_SPIDevice::read(uint8_t *buffer, size_t len, uint8_t sendvalue) {
+  (void)sendvalue;
+  memset(buffer, 0xFF, len);
+  ICM20X_Sim *sim = ICM20X_Sim::findSPI(_cs);
+  if (sim) {
+    finishTransfer(sim, len, len * 8, _freq);
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Send a register address with the read bit clear, then the data
+ *            to write there
+ *    @param  buffer The data, or the address and data when there is no
+ *            prefix
+ *    @param  len The number of bytes in `buffer`
+ *    @param  prefix_buffer Bytes to send first, usually the address
+ *    @param  prefix_len The number of bytes in `prefix_buffer`
+ *    @return True
+ */
+bool Adafruit_SPIDevice::write(const uint8_t *buffer, size_t len,
+                               const uint8_t *prefix_buffer,
+                               size_t prefix_len) {
+  ICM20X_Sim *sim = ICM20X_Sim::findSPI(_cs);
+  if (!sim || prefix_len + len == 0) {
+    return true;
+  }
+
+  uint8_t reg = prefix_len ? prefix_buffer[0] : buffer[0];
+  if (!(reg & ICM20X_SIM_SPI_READ)) {
+    if (prefix_len) {
+      sim->busWrite(reg, prefix_buffer + 1, prefix_len - 1);
+      sim->busWrite(reg + prefix_len - 1, buffer, len);
+    } else {
+      sim->busWrite(reg, buffer + 1, len - 1);
+    }
+  }
+
+  uint32_t bytes = prefix_len + len;
+  finishTransfer(sim, bytes, bytes * 8, _freq);
+  return true;
+}
+
+/*!
+ *    @brief  Send a register address, then clock in data. With the read bit
+ *            set the chip returns its registers; without it `sendvalue` is
+ *            written to them
+ *    @param  write_buffer The register address
+ *    @param  write_len The number of bytes in `write_buffer`
+ *    @param  read_buffer Where to store the data
+ *    @param  read_len The number of bytes to read
+ *    @param  sendvalue What to send on MOSI while reading
+ *    @return True
+ */
+bool Adafruit_SPIDevice::write_then_read(const uint8_t *write_buffer,
+                                         size_t write_len,
+                                         uint8_t *read_buffer, size_t read_len,
+                                         uint8_t sendvalue) {
+  ICM20X_Sim *sim = ICM20X_Sim::findSPI(_cs);
+  if (!sim || write_len == 0) {
+    memset(read_buffer, 0xFF, read_len);
+    return true;
+  }
+
+  uint8_t reg = write_buffer[0];
+  if (reg & ICM20X_SIM_SPI_READ) {
+    sim->busRead(reg & ~ICM20X_SIM_SPI_READ, read_buffer, read_len);
+  } else {
+    for (size_t i = 0; i < read_len; i++) {
+      sim->busWrite(reg + i, &sendvalue, 1);
+      read_buffer[i] = 0xFF;
+    }
+  }
+
+  uint32_t bytes = write_len + read_len;
+  finishTransfer(sim, bytes, bytes * 8, _freq);
+  return true;
+}
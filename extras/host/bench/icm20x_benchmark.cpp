@@ -0,0 +1,335 @@
+// Times every read path of both chips over the simulated I2C and SPI buses,
+// at every accel and gyro range, and prints one CSV row per measurement.
+//
+// ns_per_sample is the host time for one read, including the time spent in
+// the simulated chip. The bus columns are the simulated traffic of one read:
+// bytes on the bus including address bytes, transfers, and the time those
+// transfers take at the bus clock, which is the time they take on a board.
+//
+// The telemetry rows time the encoder and decoder over the simulator's noisy
+// stream, captured from the ICM20948's FIFO beforehand, so they have no bus
+// traffic. encoded_bytes_per_sample is the size of the encoded stream; the
+// uncompressed samples are 24 bytes each.
+//
+// Usage: icm20x_benchmark [samples per row]
+
+#include "ICM20X_Sim.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+#include <Adafruit_ICM20X_Telemetry.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ICM_CS 10 ///< Chip select of the simulated SPI chip
+
+/*!
+ *    @brief  A chip with the raw read and the range registers made public
+ *    @tparam ICM The chip class
+ */
+template <class ICM> class BenchICM : public ICM {
+public:
+  bool readScaled(void) { return this->_read(ICM20X_SENSOR_ALL); }
+  void setRanges(uint8_t accel_range, uint8_t gyro_range) {
+    this->writeAccelRange(accel_range);
+    this->writeGyroRange(gyro_range);
+  }
+};
+
+/*!
+ *    @brief  Times a row of reads and prints it
+ */
+class Row {
+public:
+  /*!
+   *    @brief  Create a row
+   *    @param  sim The chip whose traffic is counted
+   *    @param  chip Chip column
+   *    @param  bus Bus column
+   *    @param  accel_range Accel range column
+   *    @param  gyro_range Gyro range column
+   *    @param  samples Reads per row
+   */
+  Row(ICM20X_Sim *sim, const char *chip, const char *bus, uint8_t accel_range,
+      uint8_t gyro_range, uint32_t samples) {
+    this->sim = sim;
+    this->chip = chip;
+    this->bus = bus;
+    this->accel_range = accel_range;
+    this->gyro_range = gyro_range;
+    this->samples = samples;
+  }
+
+  /*!
+   *    @brief  Get the number of reads to time
+   *    @return Reads per row
+   */
+  uint32_t getSamples(void) { return samples; }
+
+  /*!
+   *    @brief  Start timing a path
+   */
+  void start(void) {
+    sim->resetStats();
+    start_time = std::chrono::steady_clock::now();
+  }
+
+  /*!
+   *    @brief  Stop timing and print the row
+   *    @param  path The read path that was timed
+   *    @param  encoded_bytes Size of the encoded telemetry, 0 to leave the
+   *            column empty
+   */
+  void print(const char *path, uint32_t encoded_bytes = 0) {
+    std::chrono::nanoseconds elapsed =
+        std::chrono::steady_clock::now() - start_time;
+    icm20x_sim_stats_t stats;
+    sim->getStats(&stats);
+
+    printf("%s,%s,%s,%u,%u,%lu,%.1f,%.2f,%.2f,%.2f,", chip, bus, path,
+           accel_range, gyro_range, (unsigned long)samples,
+           (double)elapsed.count() / samples, (double)stats.bytes / samples,
+           (double)stats.transactions / samples,
+           (double)stats.bus_us / samples);
+    if (encoded_bytes) {
+      printf("%.2f", (double)encoded_bytes / samples);
+    }
+    printf("\n");
+  }
+
+private:
+  ICM20X_Sim *sim;     ///< The chip whose traffic is counted
+  const char *chip;    ///< Chip column
+  const char *bus;     ///< Bus column
+  uint8_t accel_range; ///< Accel range column
+  uint8_t gyro_range;  ///< Gyro range column
+  uint32_t samples;    ///< Reads per row
+
+  std::chrono::steady_clock::time_point start_time; ///< Start of the path
+};
+
+/*!
+ *    @brief  Time every read path at one range setting
+ *    @param  icm The chip, already started
+ *    @param  row The row to print into
+ *    @param  has_mag Does the chip have a magnetometer sub-object
+ *    @return False if the auxiliary bus read the wrong value
+ */
+template <class ICM>
+static bool benchmarkPaths(BenchICM<ICM> *icm, Row *row, bool has_mag) {
+  uint32_t samples = row->getSamples();
+  sensors_event_t accel, gyro, temp, mag;
+
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    icm->getEvent(&accel, &gyro, &temp, has_mag ? &mag : NULL);
+  }
+  row->print("getEvent");
+
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    icm->getAccelerometerSensor()->getEvent(&accel);
+  }
+  row->print("accel.getEvent");
+
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    icm->getGyroSensor()->getEvent(&gyro);
+  }
+  row->print("gyro.getEvent");
+
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    icm->getTemperatureSensor()->getEvent(&temp);
+  }
+  row->print("temp.getEvent");
+
+  if (has_mag) {
+    row->start();
+    for (uint32_t i = 0; i < samples; i++) {
+      icm->getMagnetometerSensor()->getEvent(&mag);
+    }
+    row->print("mag.getEvent");
+  }
+
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    icm->readScaled();
+  }
+  row->print("_read+scaleValues");
+
+  // a blocking read of the magnetometer's ID through slave 4
+  bool aux_ok = true;
+  row->start();
+  for (uint32_t i = 0; i < samples; i++) {
+    if (icm->readExternalRegister(AK09916_SIM_ADDRESS, AK09916_WIA2) !=
+        ICM20948_MAG_ID) {
+      aux_ok = false;
+    }
+  }
+  row->print("readExternalRegister");
+  return aux_ok;
+}
+
+/*!
+ *    @brief  Time every read path of one chip on one bus at every range
+ *    @param  chip_id The WHOAMI value of the simulated chip
+ *    @param  chip Chip column
+ *    @param  spi True for SPI, false for I2C
+ *    @param  samples Reads per row
+ *    @return True if the chip started and every read worked
+ */
+template <class ICM>
+static bool benchmarkChip(uint8_t chip_id, const char *chip, bool spi,
+                          uint32_t samples) {
+  ICM20X_Sim sim(chip_id);
+  // the ICM20649 has no magnetometer of its own, so one is wired to its
+  // auxiliary bus for the readExternalRegister rows
+  sim.setMagConnected(true);
+  BenchICM<ICM> icm;
+  if (spi) {
+    sim.attachSPI(ICM_CS);
+    if (!icm.begin_SPI(ICM_CS)) {
+      return false;
+    }
+  } else {
+    sim.attachI2C(chip_id == ICM20948_CHIP_ID ? ICM20948_I2CADDR_DEFAULT
+                                              : ICM20649_I2CADDR_DEFAULT);
+    if (!icm.begin_I2C()) {
+      return false;
+    }
+  }
+
+  if (chip_id == ICM20649_CHIP_ID) {
+    // begin only sets up the auxiliary bus on the chip with a magnetometer
+    icm.setI2CBypass(false);
+    icm.configureI2CMaster();
+    icm.enableI2CMaster(true);
+  }
+
+  bool ok = true;
+  for (uint8_t accel_range = 0; accel_range < 4; accel_range++) {
+    for (uint8_t gyro_range = 0; gyro_range < 4; gyro_range++) {
+      icm.setRanges(accel_range, gyro_range);
+      Row row(&sim, chip, spi ? "spi" : "i2c", accel_range, gyro_range,
+              samples);
+      if (!benchmarkPaths(&icm, &row, chip_id == ICM20948_CHIP_ID)) {
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+/*!
+ *    @brief  Time the telemetry encoder and decoder over a noisy stream
+ *            drained from the ICM20948's FIFO at 1125 Hz over SPI
+ *    @param  samples Samples per row
+ *    @return True if every sample decoded to the one encoded
+ */
+static bool benchmarkTelemetry(uint32_t samples) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachSPI(ICM_CS);
+  sim.setGenerator(icm20x_sim_noisy_sample);
+  Adafruit_ICM20948 icm;
+  if (!icm.begin_SPI(ICM_CS)) {
+    return false;
+  }
+  icm.setAccelRateDivisor(0);
+  icm.setGyroRateDivisor(0);
+  if (!icm.enableFIFO(true, true)) {
+    return false;
+  }
+
+  icm20x_telemetry_sample_t *sent = new icm20x_telemetry_sample_t[samples];
+  icm20x_telemetry_sample_t *received =
+      new icm20x_telemetry_sample_t[samples + ICM20X_TELEMETRY_MAX_BLOCK];
+  icm20x_raw_sample_t storage[64], raw;
+  Adafruit_ICM20X_SampleRing ring(storage, 64);
+  uint32_t captured = 0;
+  while (captured < samples) {
+    delay(10);
+    icm.readFIFO(&ring);
+    while (captured < samples && ring.pop(&raw)) {
+      icm20x_telemetry_sample_t *sample = &sent[captured++];
+      memcpy(sample->values, raw.accel, sizeof(raw.accel));
+      memcpy(sample->values + 3, raw.gyro, sizeof(raw.gyro));
+      sample->values[6] = raw.temperature;
+      memcpy(sample->values + 7, raw.mag, sizeof(raw.mag));
+      sample->timestamp_us = raw.timestamp_us;
+    }
+  }
+
+  // every block is kept so the decoder can be timed on its own
+  uint32_t block_count = samples / ICM20X_TELEMETRY_MAX_BLOCK + 1;
+  uint8_t *stream = new uint8_t[block_count * ICM20X_TELEMETRY_BUFFER_SIZE];
+  uint32_t stream_len = 0;
+  Adafruit_ICM20X_TelemetryEncoder encoder;
+  Row row(&sim, "ICM20948", "spi", icm.getAccelRange(), icm.getGyroRange(),
+          samples);
+  row.start();
+  for (uint32_t i = 0; i < samples; i++) {
+    stream_len += encoder.encode(&sent[i], stream + stream_len);
+  }
+  stream_len += encoder.flush(stream + stream_len);
+  row.print("telemetry.encode", stream_len);
+
+  Adafruit_ICM20X_TelemetryDecoder decoder;
+  uint32_t decoded = 0, offset = 0;
+  row.start();
+  while (offset < stream_len) {
+    uint16_t len = Adafruit_ICM20X_TelemetryDecoder::blockSize(
+        stream + offset, stream_len - offset);
+    if (!len) {
+      break;
+    }
+    decoded += decoder.decode(stream + offset, len, received + decoded,
+                              ICM20X_TELEMETRY_MAX_BLOCK);
+    offset += len;
+  }
+  row.print("telemetry.decode", stream_len);
+
+  bool ok = decoded == samples;
+  for (uint32_t i = 0; ok && i < samples; i++) {
+    ok = !memcmp(sent[i].values, received[i].values, sizeof(sent[i].values)) &&
+         sent[i].timestamp_us == received[i].timestamp_us;
+  }
+  delete[] stream;
+  delete[] received;
+  delete[] sent;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  uint32_t samples = 1000;
+  if (argc > 1) {
+    samples = strtoul(argv[1], NULL, 10);
+  }
+  if (samples == 0) {
+    fprintf(stderr, "usage: %s [samples per row]\n", argv[0]);
+    return 2;
+  }
+
+  printf("chip,bus,path,accel_range,gyro_range,samples,ns_per_sample,"
+         "bus_bytes_per_sample,bus_transactions_per_sample,"
+         "bus_us_per_sample,encoded_bytes_per_sample\n");
+
+  bool ok = true;
+  for (uint8_t spi = 0; spi < 2; spi++) {
+    if (!benchmarkChip<Adafruit_ICM20948>(ICM20948_CHIP_ID, "ICM20948", spi,
+                                          samples)) {
+      fprintf(stderr, "ICM20948 %s failed\n", spi ? "spi" : "i2c");
+      ok = false;
+    }
+    if (!benchmarkChip<Adafruit_ICM20649>(ICM20649_CHIP_ID, "ICM20649", spi,
+                                          samples)) {
+      fprintf(stderr, "ICM20649 %s failed\n", spi ? "spi" : "i2c");
+      ok = false;
+    }
+  }
+  if (!benchmarkTelemetry(samples)) {
+    fprintf(stderr, "telemetry failed\n");
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
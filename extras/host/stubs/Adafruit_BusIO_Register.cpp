@@ -0,0 +1,180 @@
+/*!
+ *  @file Adafruit_BusIO_Register.cpp
+ *
+ *  Host stand-in for the BusIO register helper
+ *
+ *  BSD license (see license.txt)
+ */
+
+#include "Adafruit_BusIO_Register.h"
+
+/*!
+ *    @brief  Create a register on an I2C or SPI device
+ *    @param  i2cdevice The I2C device, or NULL to use `spidevice`
+ *    @param  spidevice The SPI device, or NULL to use `i2cdevice`
+ *    @param  type How the read/write bit is set in the SPI address
+ *    @param  reg_addr The register address
+ *    @param  width The register width in bytes
+ *    @param  byteorder `LSBFIRST` or `MSBFIRST` for the value forms
+ *    @param  address_width Unused, addresses are one byte
+ */
+Adafruit_BusIO_Register::Adafruit_BusIO_Register(
+    Adafruit_I2CDevice *i2cdevice, Adafruit_SPIDevice *spidevice,
+    Adafruit_BusIO_SPIRegType type, uint16_t reg_addr, uint8_t width,
+    uint8_t byteorder, uint8_t address_width) {
+  (void)address_width;
+  _i2cdevice = i2cdevice;
+  _spidevice = spidevice;
+  _spiregtype = type;
+  _address = reg_addr;
+  _width = width;
+  _byteorder = byteorder;
+}
+
+/*!
+ *    @brief  Read bytes starting at the register
+ *    @param  buffer Where to store the bytes
+ *    @param  len The number of bytes
+ *    @return True on success
+ */
+bool Adafruit_BusIO_Register::read(uint8_t *buffer, uint8_t len) {
+  uint8_t addr = _address & 0xFF;
+  if (_i2cdevice) {
+    return _i2cdevice->write_then_read(&addr, 1, buffer, len);
+  }
+  if (!_spidevice) {
+    return false;
+  }
+  if (_spiregtype == ADDRBIT8_HIGH_TOREAD) {
+    addr |= 0x80;
+  } else if (_spiregtype == ADDRBIT8_HIGH_TOWRITE) {
+    addr &= ~0x80;
+  } else if (_spiregtype == AD8_HIGH_TOREAD_AD7_HIGH_TOINC) {
+    addr |= 0x80 | 0x40;
+  }
+  return _spidevice->write_then_read(&addr, 1, buffer, len);
+}
+
+/*!
+ *    @brief  Read the register into a byte
+ *    @param  value Where to store it
+ *    @return True on success
+ */
+bool Adafruit_BusIO_Register::read(uint8_t *value) { return read(value, 1); }
+
+/*!
+ *    @brief  Read a two byte register
+ *    @param  value Where to store it, combined in the register byte order
+ *    @return True on success
+ */
+bool Adafruit_BusIO_Register::read(uint16_t *value) {
+  uint8_t buffer[2];
+  if (!read(buffer, 2)) {
+    return false;
+  }
+  if (_byteorder == LSBFIRST) {
+    *value = buffer[1] << 8 | buffer[0];
+  } else {
+    *value = buffer[0] << 8 | buffer[1];
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Read the register as a number of `width` bytes
+ *    @return The value, or -1 on failure
+ */
+uint32_t Adafruit_BusIO_Register::read(void) {
+  uint8_t buffer[4];
+  if (_width > sizeof(buffer) || !read(buffer, _width)) {
+    return -1;
+  }
+
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < _width; i++) {
+    uint8_t index = (_byteorder == LSBFIRST) ? _width - 1 - i : i;
+    value = value << 8 | buffer[index];
+  }
+  return value;
+}
+
+/*!
+ *    @brief  Write bytes starting at the register
+ *    @param  buffer The bytes
+ *    @param  len The number of bytes
+ *    @return True on success
+ */
+bool Adafruit_BusIO_Register::write(uint8_t *buffer, uint8_t len) {
+  uint8_t addr = _address & 0xFF;
+  if (_i2cdevice) {
+    return _i2cdevice->write(buffer, len, true, &addr, 1);
+  }
+  if (!_spidevice) {
+    return false;
+  }
+  if (_spiregtype == ADDRBIT8_HIGH_TOREAD) {
+    addr &= ~0x80;
+  } else if (_spiregtype == ADDRBIT8_HIGH_TOWRITE) {
+    addr |= 0x80;
+  } else if (_spiregtype == AD8_HIGH_TOREAD_AD7_HIGH_TOINC) {
+    addr |= 0x40;
+  }
+  return _spidevice->write(buffer, len, &addr, 1);
+}
+
+/*!
+ *    @brief  Write the register as a number
+ *    @param  value The value
+ *    @param  numbytes The number of bytes, or 0 for the register width
+ *    @return True on success
+ */
+bool Adafruit_BusIO_Register::write(uint32_t value, uint8_t numbytes) {
+  uint8_t buffer[4];
+  if (numbytes == 0) {
+    numbytes = _width;
+  }
+  if (numbytes > sizeof(buffer)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < numbytes; i++) {
+    uint8_t index = (_byteorder == LSBFIRST) ? i : numbytes - 1 - i;
+    buffer[index] = value & 0xFF;
+    value >>= 8;
+  }
+  return write(buffer, numbytes);
+}
+
+/*!
+ *    @brief  Create a bit field
+ *    @param  reg The register holding it
+ *    @param  bits The width of the field
+ *    @param  shift The position of its lowest bit
+ */
+Adafruit_BusIO_RegisterBits::Adafruit_BusIO_RegisterBits(
+    Adafruit_BusIO_Register *reg, uint8_t bits, uint8_t shift) {
+  _register = reg;
+  _bits = bits;
+  _shift = shift;
+}
+
+/*!
+ *    @brief  Read the field
+ *    @return The field value
+ */
+uint32_t Adafruit_BusIO_RegisterBits::read(void) {
+  uint32_t value = _register->read();
+  return (value >> _shift) & ((1UL << _bits) - 1);
+}
+
+/*!
+ *    @brief  Change the field, leaving the other bits of the register alone
+ *    @param  value The new field value
+ *    @return True on success
+ */
+bool Adafruit_BusIO_RegisterBits::write(uint32_t value) {
+  uint32_t mask = ((1UL << _bits) - 1) << _shift;
+  uint32_t reg = _register->read();
+  reg = (reg & ~mask) | ((value << _shift) & mask);
+  return _register->write(reg, _register->width());
+}
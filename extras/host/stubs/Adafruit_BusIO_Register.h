@@ -0,0 +1,69 @@
+/*!
+ *  @file Adafruit_BusIO_Register.h
+ *
+ *  Host stand-in for the BusIO register helper, covering the calls the ICM20X
+ *  library makes
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_BUSIO_REGISTER_H
+#define _ICM20X_HOST_BUSIO_REGISTER_H
+
+#include <Adafruit_I2CDevice.h>
+#include <Adafruit_SPIDevice.h>
+
+/** How the register address is sent over SPI */
+typedef enum _Adafruit_BusIO_SPIRegType {
+  ADDRBIT8_HIGH_TOREAD = 0,
+  AD8_HIGH_TOREAD_AD7_HIGH_TOINC = 1,
+  ADDRBIT8_HIGH_TOWRITE = 2,
+  ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE = 3,
+} Adafruit_BusIO_SPIRegType;
+
+/*!
+ *    @brief  One or more registers starting at an address, on either an I2C
+ *            or an SPI device
+ */
+class Adafruit_BusIO_Register {
+public:
+  Adafruit_BusIO_Register(Adafruit_I2CDevice *i2cdevice,
+                          Adafruit_SPIDevice *spidevice,
+                          Adafruit_BusIO_SPIRegType type, uint16_t reg_addr,
+                          uint8_t width = 1, uint8_t byteorder = LSBFIRST,
+                          uint8_t address_width = 1);
+
+  bool read(uint8_t *buffer, uint8_t len);
+  bool read(uint8_t *value);
+  bool read(uint16_t *value);
+  uint32_t read(void);
+  bool write(uint8_t *buffer, uint8_t len);
+  bool write(uint32_t value, uint8_t numbytes = 0);
+  uint8_t width(void) { return _width; }
+
+private:
+  Adafruit_I2CDevice *_i2cdevice;        ///< I2C device, or NULL for SPI
+  Adafruit_SPIDevice *_spidevice;        ///< SPI device
+  Adafruit_BusIO_SPIRegType _spiregtype; ///< SPI read/write bit convention
+  uint16_t _address;                     ///< First register
+  uint8_t _width;                        ///< Bytes in the register
+  uint8_t _byteorder;                    ///< `LSBFIRST` or `MSBFIRST`
+};
+
+/*!
+ *    @brief  A bit field within a register
+ */
+class Adafruit_BusIO_RegisterBits {
+public:
+  Adafruit_BusIO_RegisterBits(Adafruit_BusIO_Register *reg, uint8_t bits,
+                              uint8_t shift);
+  bool write(uint32_t value);
+  uint32_t read(void);
+
+private:
+  Adafruit_BusIO_Register *_register; ///< Register holding the field
+  uint8_t _bits;                      ///< Width of the field
+  uint8_t _shift;                     ///< Position of the lowest bit
+};
+
+#endif
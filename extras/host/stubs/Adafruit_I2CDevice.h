@@ -0,0 +1,42 @@
+/*!
+ *  @file Adafruit_I2CDevice.h
+ *
+ *  Host stand-in for the BusIO I2C device. Transfers go to the simulated chip
+ *  attached at the device's address, see ICM20X_Sim.h
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_I2CDEVICE_H
+#define _ICM20X_HOST_I2CDEVICE_H
+
+#include <Wire.h>
+
+/*!
+ *    @brief  A device at one address on an I2C bus
+ */
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire);
+  uint8_t address(void);
+  bool begin(bool addr_detect = true);
+  void end(void);
+  bool detected(void);
+
+  bool read(uint8_t *buffer, size_t len, bool stop = true);
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false);
+  bool setSpeed(uint32_t desiredclk);
+  size_t maxBufferSize(void) { return 32; }
+
+private:
+  uint8_t _addr;   ///< 7-bit address
+  TwoWire *_wire;  ///< Bus the device is on
+  bool _begun;     ///< Has `begin` found the device
+  uint32_t _speed; ///< Bus clock in Hz
+};
+
+#endif
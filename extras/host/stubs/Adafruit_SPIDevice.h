@@ -0,0 +1,49 @@
+/*!
+ *  @file Adafruit_SPIDevice.h
+ *
+ *  Host stand-in for the BusIO SPI device. Transfers go to the simulated chip
+ *  attached to the device's chip select pin, see ICM20X_Sim.h
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_SPIDEVICE_H
+#define _ICM20X_HOST_SPIDEVICE_H
+
+#include <SPI.h>
+
+/** SPI bit order */
+typedef enum _BitOrder {
+  SPI_BITORDER_MSBFIRST = MSBFIRST,
+  SPI_BITORDER_LSBFIRST = LSBFIRST,
+} BusIOBitOrder;
+
+/*!
+ *    @brief  A device on an SPI bus, selected by its chip select pin
+ */
+class Adafruit_SPIDevice {
+public:
+  Adafruit_SPIDevice(int8_t cspin, uint32_t freq = 1000000,
+                     BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
+                     uint8_t dataMode = SPI_MODE0, SPIClass *theSPI = &SPI);
+  Adafruit_SPIDevice(int8_t cspin, int8_t sck, int8_t miso, int8_t mosi,
+                     uint32_t freq = 1000000,
+                     BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
+                     uint8_t dataMode = SPI_MODE0);
+  ~Adafruit_SPIDevice() {}
+
+  bool begin(void);
+  bool read(uint8_t *buffer, size_t len, uint8_t sendvalue = 0xFF);
+  bool write(const uint8_t *buffer, size_t len,
+             const uint8_t *prefix_buffer = NULL, size_t prefix_len = 0);
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       uint8_t sendvalue = 0xFF);
+
+private:
+  int8_t _cs;     ///< Chip select pin
+  uint32_t _freq; ///< Clock in Hz
+  bool _begun;    ///< Has `begin` found the device
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*!
+ *  @file Adafruit_Sensor.h
+ *
+ *  Host copy of the Adafruit Unified Sensor types the ICM20X library uses
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_SENSOR_H
+#define _ICM20X_HOST_SENSOR_H
+
+#include <stdint.h>
+
+#define SENSORS_GRAVITY_EARTH (9.80665F)   ///< Earth's gravity in m/s^2
+#define SENSORS_DPS_TO_RADS (0.017453293F) ///< Degrees/s to rad/s
+
+/** Sensor types */
+typedef enum {
+  SENSOR_TYPE_ACCELEROMETER = (1),
+  SENSOR_TYPE_MAGNETIC_FIELD = (2),
+  SENSOR_TYPE_ORIENTATION = (3),
+  SENSOR_TYPE_GYROSCOPE = (4),
+  SENSOR_TYPE_AMBIENT_TEMPERATURE = (13),
+} sensors_type_t;
+
+/** A three axis reading */
+typedef struct {
+  union {
+    float v[3]; ///< The axes as an array
+    struct {
+      float x; ///< X axis
+      float y; ///< Y axis
+      float z; ///< Z axis
+    };
+  };
+  int8_t status;       ///< Status byte
+  uint8_t reserved[3]; ///< Padding
+} sensors_vec_t;
+
+/** One sensor reading */
+typedef struct {
+  int32_t version;   ///< Size of the struct
+  int32_t sensor_id; ///< Unique sensor id
+  int32_t type;      ///< `sensors_type_t`
+  int32_t reserved0; ///< Reserved
+  int32_t timestamp; ///< Time in milliseconds
+  union {
+    float data[4];              ///< Raw data
+    sensors_vec_t acceleration; ///< Acceleration in m/s^2
+    sensors_vec_t magnetic;     ///< Magnetic field in uT
+    sensors_vec_t orientation;  ///< Orientation in degrees
+    sensors_vec_t gyro;         ///< Rotation in rad/s
+    float temperature;          ///< Temperature in degrees C
+  };
+} sensors_event_t;
+
+/** Sensor details */
+typedef struct {
+  char name[12];     ///< Sensor name
+  int32_t version;   ///< Driver version
+  int32_t sensor_id; ///< Unique sensor id
+  int32_t type;      ///< `sensors_type_t`
+  float max_value;   ///< Largest value in SI units
+  float min_value;   ///< Smallest value in SI units
+  float resolution;  ///< Smallest change in SI units
+  int32_t min_delay; ///< Microseconds between events, 0 when not constant
+} sensor_t;
+
+/*!
+ *    @brief  Common interface of Unified Sensor drivers
+ */
+class Adafruit_Sensor {
+public:
+  Adafruit_Sensor() {}
+  virtual ~Adafruit_Sensor() {}
+
+  virtual void enableAutoRange(bool enabled) { (void)enabled; }
+  virtual bool getEvent(sensors_event_t *) = 0;
+  virtual void getSensor(sensor_t *) = 0;
+  void printSensorDetails(void) {}
+};
+
+#endif
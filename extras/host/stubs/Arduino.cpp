@@ -0,0 +1,136 @@
+/*!
+ *  @file Arduino.cpp
+ *
+ *  Host Arduino core: a simulated clock and stdout serial ports
+ *
+ *  BSD license (see license.txt)
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Wire.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+TwoWire Wire;
+TwoWire Wire1;
+SPIClass SPI;
+
+static uint32_t host_us = 0;
+
+/*!
+ *    @brief  Move the simulated clock forward
+ *    @param  us The time that passed in microseconds
+ */
+void hostAdvanceMicros(uint32_t us) { host_us += us; }
+
+/*!
+ *    @brief  Set the simulated clock, which starts at 0
+ *    @param  us The new `micros()` value
+ */
+void hostSetMicros(uint32_t us) { host_us = us; }
+
+uint32_t micros(void) { return host_us; }
+uint32_t millis(void) { return host_us / 1000; }
+void delay(uint32_t ms) { host_us += ms * 1000; }
+void delayMicroseconds(uint32_t us) { host_us += us; }
+// busy waits spin on yield, so each one takes a little time
+void yield(void) { host_us++; }
+void noInterrupts(void) {}
+void interrupts(void) {}
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int interrupt, void (*isr)(void), int mode) {
+  (void)interrupt;
+  (void)isr;
+  (void)mode;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+/*!
+ *    @brief  Write a formatted number through `write`
+ *    @param  out The stream to write to
+ *    @param  text The formatted number
+ *    @param  len The length of `text`, or negative if formatting failed
+ *    @return The number of bytes written
+ */
+static size_t printText(Print *out, const char *text, int len) {
+  if (len <= 0) {
+    return 0;
+  }
+  return out->write((const uint8_t *)text, len);
+}
+
+size_t Print::print(const char *s) {
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(int value, int base) { return print((long)value, base); }
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  if (base == DEC) {
+    char text[24];
+    return printText(this, text, snprintf(text, sizeof(text), "%ld", value));
+  }
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  const char *format = (base == HEX) ? "%lX" : "%lu";
+  return printText(this, text, snprintf(text, sizeof(text), format, value));
+}
+
+size_t Print::print(double value, int digits) {
+  char text[48];
+  return printText(this, text,
+                   snprintf(text, sizeof(text), "%.*f", digits, value));
+}
+
+size_t Print::println(void) { return write('\r') + write('\n'); }
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(int value, int base) {
+  return print(value, base) + println();
+}
+size_t Print::println(unsigned int value, int base) {
+  return print(value, base) + println();
+}
+size_t Print::println(long value, int base) {
+  return print(value, base) + println();
+}
+size_t Print::println(unsigned long value, int base) {
+  return print(value, base) + println();
+}
+size_t Print::println(double value, int digits) {
+  return print(value, digits) + println();
+}
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+HardwareSerial::operator bool(void) { return true; }
+int HardwareSerial::available(void) { return 0; }
+int HardwareSerial::read(void) { return -1; }
+void HardwareSerial::flush(void) { fflush(stdout); }
+size_t HardwareSerial::write(uint8_t c) {
+  // the line ending is "\r\n" like the Arduino core; drop the '\r' on stdout
+  if (c != '\r') {
+    putchar(c);
+  }
+  return 1;
+}
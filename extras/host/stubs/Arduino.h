@@ -0,0 +1,96 @@
+/*!
+ *  @file Arduino.h
+ *
+ *  Just enough of the Arduino core to build the ICM20X library on a desktop.
+ *  Time is simulated: it only moves when the code waits, yields or uses the
+ *  bus, so host runs are repeatable
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_ARDUINO_H
+#define _ICM20X_HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define F(x) x
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+void noInterrupts(void);
+void interrupts(void);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalPinToInterrupt(int pin);
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+
+void hostAdvanceMicros(uint32_t us);
+void hostSetMicros(uint32_t us);
+
+/*!
+ *    @brief  Output stream, printing numbers the way the Arduino core does
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  virtual int availableForWrite(void) { return 0; }
+
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+  size_t println(void);
+  size_t println(const char *s);
+  size_t println(char c);
+  size_t println(int value, int base = DEC);
+  size_t println(unsigned int value, int base = DEC);
+  size_t println(long value, int base = DEC);
+  size_t println(unsigned long value, int base = DEC);
+  size_t println(double value, int digits = 2);
+};
+
+/*!
+ *    @brief  Serial port that writes to stdout
+ */
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  operator bool(void);
+  int available(void);
+  int read(void);
+  void flush(void);
+  size_t write(uint8_t c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
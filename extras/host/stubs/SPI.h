@@ -0,0 +1,27 @@
+/*!
+ *  @file SPI.h
+ *
+ *  Host stand-in for the Arduino SPI bus. Transfers go through
+ *  `Adafruit_SPIDevice` to the simulated chips
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_SPI_H
+#define _ICM20X_HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+
+/*!
+ *    @brief  Hardware SPI bus
+ */
+class SPIClass {};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,31 @@
+/*!
+ *  @file Wire.h
+ *
+ *  Host stand-in for the Arduino I2C bus. Transfers go through
+ *  `Adafruit_I2CDevice` to the simulated chips, this only holds the clock
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_HOST_WIRE_H
+#define _ICM20X_HOST_WIRE_H
+
+#include "Arduino.h"
+
+/*!
+ *    @brief  I2C bus with a clock rate, used to time simulated transfers
+ */
+class TwoWire {
+public:
+  void begin(void) {}
+  void setClock(uint32_t frequency) { clock = frequency; }
+  uint32_t getClock(void) { return clock; } ///< Host only
+
+private:
+  uint32_t clock = 100000; ///< Bus clock in Hz
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
@@ -0,0 +1,51 @@
+/*!
+ *  @file ICM20X_Test.h
+ *
+ *  Minimal checks for the host tests. Each failed check prints where it was
+ *  and what it compared; `main` returns `ICM20X_TEST_RESULT()`
+ *
+ *  BSD license (see license.txt)
+ */
+
+#ifndef _ICM20X_TEST_H
+#define _ICM20X_TEST_H
+
+#include <stdio.h>
+
+static int icm20x_test_failures = 0; ///< Failed checks so far
+
+/** Fail if `cond` is false */
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+      icm20x_test_failures++;                                                  \
+    }                                                                          \
+  } while (0)
+
+/** Fail if the integers `a` and `b` differ */
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long _a = (long long)(a), _b = (long long)(b);                        \
+    if (_a != _b) {                                                            \
+      printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__,       \
+             __LINE__, #a, #b, _a, _b);                                        \
+      icm20x_test_failures++;                                                  \
+    }                                                                          \
+  } while (0)
+
+/** Fail if `a` and `b` are further apart than `tolerance` */
+#define CHECK_NEAR(a, b, tolerance)                                            \
+  do {                                                                         \
+    double _a = (a), _b = (b);                                                 \
+    if (_a - _b > (tolerance) || _b - _a > (tolerance)) {                      \
+      printf("%s:%d: CHECK_NEAR(%s, %s) failed: %f != %f\n", __FILE__,         \
+             __LINE__, #a, #b, _a, _b);                                        \
+      icm20x_test_failures++;                                                  \
+    }                                                                          \
+  } while (0)
+
+/** The exit code for `main`: 0 if every check passed */
+#define ICM20X_TEST_RESULT() (icm20x_test_failures ? 1 : 0)
+
+#endif
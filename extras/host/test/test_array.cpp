@@ -0,0 +1,78 @@
+// Several chips read into one frame, with when each sample was taken
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+#include <Adafruit_ICM20X_Array.h>
+
+int main(void) {
+  // two on I2C, one on SPI; the array only sees the driver API
+  ICM20X_Sim sim_a(ICM20948_CHIP_ID), sim_b(ICM20649_CHIP_ID),
+      sim_c(ICM20948_CHIP_ID);
+  sim_a.attachI2C(0x68);
+  sim_b.attachI2C(0x69);
+  sim_c.attachSPI(10);
+  const icm20x_sim_sample_t sample_b = {
+      {1, 2, 1024}, {4, 5, 6}, 7, {0, 0, 0}};
+  sim_b.setSample(&sample_b);
+
+  Adafruit_ICM20948 a, c;
+  Adafruit_ICM20649 b;
+  CHECK(a.begin_I2C(0x68));
+  CHECK(b.begin_I2C(0x69));
+  CHECK(c.begin_SPI(10));
+  delay(20);
+
+  Adafruit_ICM20X_Array array;
+  CHECK(array.addDevice(&a));
+  CHECK(array.addDevice(&b));
+  CHECK(array.addDevice(&c));
+  CHECK_EQ(array.getDeviceCount(), 3);
+  CHECK(array.getDevice(1) == &b);
+
+  icm20x_array_frame_t frame;
+  CHECK(array.read(&frame));
+  sim_a.resetStats();
+  sim_b.resetStats();
+  CHECK(array.read(&frame));
+  CHECK_EQ(frame.count, 3);
+  CHECK_EQ(frame.valid, 0x07);
+  CHECK_EQ(frame.accel[2][0], 2048);
+  CHECK_EQ(frame.accel[2][1], 1024);
+  CHECK_EQ(frame.gyro[2][1], 6);
+  CHECK_EQ(frame.temperature[1], 7);
+  CHECK_EQ(frame.mag[0][2], 1000);
+  // the devices are read one after another in the order they were added, so
+  // each sample is skewed by the bus time of the reads before it
+  icm20x_sim_stats_t stats_a, stats_b;
+  sim_a.getStats(&stats_a);
+  sim_b.getStats(&stats_b);
+  CHECK_EQ(frame.offset_us[0], 0);
+  CHECK_EQ(frame.offset_us[1], stats_a.bus_us);
+  CHECK_EQ(frame.offset_us[2], stats_a.bus_us + stats_b.bus_us);
+
+  // a sample timed by its data ready edge can be older than the frame
+  CHECK(b.enableInterrupts(ICM20X_INT_DATA_READY));
+  b.handleInterrupt();
+  uint32_t edge_us = micros();
+  delay(5);
+  CHECK(array.read(&frame));
+  CHECK_EQ(frame.offset_us[1], (int32_t)(edge_us - frame.timestamp_us));
+  CHECK(frame.offset_us[1] <= -5000);
+  CHECK(b.enableInterrupts(0));
+
+  // each device keeps its own scale
+  icm20x_fixed_scale_t scale_a, scale_b;
+  array.getFixedScale(0, &scale_a);
+  array.getFixedScale(1, &scale_b);
+  CHECK_EQ(scale_b.accel, 2 * scale_a.accel);
+  CHECK_EQ(scale_b.mag, 0);
+
+  // a chip that stops answering is marked invalid, the rest still read
+  sim_b.detach();
+  CHECK(!array.read(&frame));
+  CHECK_EQ(frame.valid, 0x05);
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,98 @@
+// The auxiliary I2C master: blocking and queued transfers, NACKs and the
+// magnetometer rate
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+
+static uint8_t callbacks = 0;
+static uint8_t callback_value = 0;
+static bool callback_success = false;
+
+static void auxDone(uint8_t slv_addr, uint8_t reg_addr, uint8_t value,
+                    bool success) {
+  (void)slv_addr;
+  (void)reg_addr;
+  callbacks++;
+  callback_value = value;
+  callback_success = success;
+}
+
+int main(void) {
+  {
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+    Adafruit_ICM20948 icm;
+    CHECK(icm.begin_I2C());
+
+    // a blocking read through slave 4
+    CHECK_EQ(icm.readExternalRegister(AK09916_SIM_ADDRESS, AK09916_WIA2),
+             ICM20948_MAG_ID);
+    CHECK_EQ(icm.getAuxStatus(), ICM20X_AUX_IDLE);
+
+    // blocking rate changes reach the magnetometer
+    CHECK(icm.setMagDataRate(AK09916_MAG_DATARATE_10_HZ));
+    CHECK_EQ(sim.getMag()->getMode(), AK09916_MAG_DATARATE_10_HZ);
+    CHECK_EQ(icm.getMagDataRate(), AK09916_MAG_DATARATE_10_HZ);
+
+    // queued operations run one step per service call, between reads
+    icm.setAuxCallback(auxDone);
+    CHECK(icm.queueMagDataRate(AK09916_MAG_DATARATE_50_HZ));
+    sensors_event_t a, g, t, m;
+    uint8_t steps = 0;
+    while (icm.serviceAuxTransactions() == ICM20X_AUX_BUSY && steps < 100) {
+      icm.getEvent(&a, &g, &t, &m);
+      steps++;
+    }
+    CHECK(steps > 1);
+    CHECK_EQ(icm.getAuxStatus(), ICM20X_AUX_IDLE);
+    CHECK_EQ(sim.getMag()->getMode(), AK09916_MAG_DATARATE_50_HZ);
+    CHECK(callbacks > 0);
+    CHECK(callback_success);
+
+    callbacks = 0;
+    CHECK(icm.queueExternalRead(AK09916_SIM_ADDRESS, AK09916_WIA2));
+    while (icm.serviceAuxTransactions() == ICM20X_AUX_BUSY) {
+    }
+    CHECK_EQ(icm.getExternalReadValue(), ICM20948_MAG_ID);
+    CHECK_EQ(callbacks, 1);
+    CHECK_EQ(callback_value, ICM20948_MAG_ID);
+
+    // nothing at the address: the queue fails and is flushed
+    callbacks = 0;
+    CHECK(icm.queueExternalRead(0x1E, 0x00));
+    CHECK(icm.queueExternalRead(AK09916_SIM_ADDRESS, AK09916_WIA2));
+    while (icm.serviceAuxTransactions() == ICM20X_AUX_BUSY) {
+    }
+    CHECK_EQ(icm.getAuxStatus(), ICM20X_AUX_FAILED);
+    CHECK_EQ(callbacks, 1);
+    CHECK(!callback_success);
+    icm.setAuxCallback(NULL);
+
+    // the continuous measurements keep coming through slave 0
+    uint32_t measured = sim.getMag()->getMeasurementCount();
+    delay(100);
+    icm.getEvent(&a, &g, &t, &m);
+    CHECK_EQ(sim.getMag()->getMeasurementCount() - measured, 5);
+    CHECK(icm.getSampleFlags() & ICM20X_SAMPLE_MAG_NEW);
+
+    icm.resetI2CMaster();
+    CHECK_EQ(icm.getAuxStatus(), ICM20X_AUX_IDLE);
+    CHECK_EQ(icm.readExternalRegister(AK09916_SIM_ADDRESS, AK09916_WIA2),
+             ICM20948_MAG_ID);
+  }
+
+  // the ICM20649 master has nothing on its bus: reads are NACKed
+  {
+    ICM20X_Sim sim(ICM20649_CHIP_ID);
+    sim.attachI2C(ICM20649_I2CADDR_DEFAULT);
+    Adafruit_ICM20649 icm;
+    CHECK(icm.begin_I2C());
+    CHECK(icm.enableI2CMaster(true));
+    icm.readExternalRegister(AK09916_SIM_ADDRESS, AK09916_WIA2);
+    CHECK_EQ(icm.getAuxStatus(), ICM20X_AUX_FAILED);
+  }
+
+  return ICM20X_TEST_RESULT();
+}
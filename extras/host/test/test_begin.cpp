@@ -0,0 +1,136 @@
+// begin() on both chips over I2C and SPI, and the ways it can fail
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+
+#define SPI_CS 10
+
+// the state begin() leaves the chip in, whichever bus it used
+static void checkConfigured(ICM20X_Sim *sim, bool has_mag) {
+  CHECK_EQ(sim->getRegister(0, ICM20X_B0_PWR_MGMT_1) & 0x40, 0); // awake
+  CHECK_EQ((sim->getRegister(2, ICM20X_B2_ACCEL_CONFIG_1) >> 1) & 0x03, 3);
+  CHECK_EQ((sim->getRegister(2, ICM20X_B2_GYRO_CONFIG_1) >> 1) & 0x03, 3);
+  CHECK_EQ(sim->getRegister(2, ICM20X_B2_GYRO_SMPLRT_DIV), 10);
+  CHECK_EQ(sim->getRegister(2, ICM20X_B2_ACCEL_SMPLRT_DIV_2), 20);
+
+  if (has_mag) {
+    CHECK_EQ(sim->getRegister(0, ICM20X_B0_USER_CTRL) & 0x20, 0x20);
+    CHECK_EQ(sim->getRegister(3, ICM20X_B3_I2C_SLV0_ADDR), 0x8C);
+    CHECK_EQ(sim->getRegister(3, ICM20X_B3_I2C_SLV0_REG), AK09916_ST1);
+    CHECK_EQ(sim->getRegister(3, ICM20X_B3_I2C_SLV0_CTRL), 0x89);
+    CHECK_EQ(sim->getMag()->getMode(), AK09916_MAG_DATARATE_100_HZ);
+  }
+}
+
+// the default sample at the ranges begin() sets
+static void checkEvents(Adafruit_ICM20X *icm, float lsb_per_g, bool has_mag) {
+  sensors_event_t a, g, t, m;
+  delay(20); // the first magnetometer measurement takes 10ms at 100Hz
+  CHECK(icm->getEvent(&a, &g, &t, &m));
+  CHECK_NEAR(a.acceleration.x, 100 / lsb_per_g * SENSORS_GRAVITY_EARTH, 1e-3);
+  CHECK_NEAR(a.acceleration.y, -200 / lsb_per_g * SENSORS_GRAVITY_EARTH, 1e-3);
+  CHECK_NEAR(a.acceleration.z, 2048 / lsb_per_g * SENSORS_GRAVITY_EARTH, 1e-3);
+  CHECK_NEAR(t.temperature, 333 / 333.87 + 21, 1e-2);
+  if (has_mag) {
+    CHECK_NEAR(m.magnetic.x, 150, 1e-3);
+    CHECK_NEAR(m.magnetic.y, -75, 1e-3);
+    CHECK_NEAR(m.magnetic.z, 37.5, 1e-3);
+  }
+}
+
+int main(void) {
+  {
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+    Adafruit_ICM20948 icm;
+    CHECK(icm.begin_I2C());
+    checkConfigured(&sim, true);
+    checkEvents(&icm, 2048, true);
+    CHECK_EQ(icm.getAccelRange(), ICM20948_ACCEL_RANGE_16_G);
+    CHECK_EQ(icm.getMagDataRate(), AK09916_MAG_DATARATE_100_HZ);
+    CHECK(sim.getSampleCount() > 0);
+  }
+  {
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.attachSPI(SPI_CS);
+    Adafruit_ICM20948 icm;
+    CHECK(icm.begin_SPI(SPI_CS));
+    checkConfigured(&sim, true);
+    checkEvents(&icm, 2048, true);
+  }
+  {
+    ICM20X_Sim sim(ICM20649_CHIP_ID);
+    sim.attachI2C(ICM20649_I2CADDR_DEFAULT);
+    Adafruit_ICM20649 icm;
+    CHECK(icm.begin_I2C());
+    checkConfigured(&sim, false);
+    checkEvents(&icm, 1024, false);
+    CHECK_EQ(icm.getAccelRange(), ICM20649_ACCEL_RANGE_30_G);
+  }
+  {
+    ICM20X_Sim sim(ICM20649_CHIP_ID);
+    sim.attachSPI(SPI_CS);
+    Adafruit_ICM20649 icm;
+    CHECK(icm.begin_SPI(SPI_CS));
+    checkConfigured(&sim, false);
+    checkEvents(&icm, 1024, false);
+  }
+
+  // the sensor objects are part of the driver: there before begin, and the
+  // same ones after begin runs again
+  {
+    Adafruit_ICM20948 icm;
+    Adafruit_Sensor *accel = icm.getAccelerometerSensor();
+    sensor_t info;
+    accel->getSensor(&info);
+    CHECK_EQ(info.type, SENSOR_TYPE_ACCELEROMETER);
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+    CHECK(icm.begin_I2C());
+    CHECK(icm.begin_I2C());
+    CHECK(icm.getAccelerometerSensor() == accel);
+  }
+
+  // nothing at the address, or at a different one
+  {
+    Adafruit_ICM20948 icm;
+    CHECK(!icm.begin_I2C());
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.attachI2C(0x68);
+    Adafruit_ICM20948 other;
+    CHECK(!other.begin_I2C(0x69));
+    CHECK(other.begin_I2C(0x68));
+  }
+  // an SPI bus with nothing on it reads 0xFF, which is not a chip ID
+  {
+    Adafruit_ICM20948 icm;
+    CHECK(!icm.begin_SPI(SPI_CS));
+  }
+  // the wrong chip
+  {
+    ICM20X_Sim sim(0x12);
+    sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+    Adafruit_ICM20948 icm;
+    CHECK(!icm.begin_I2C());
+  }
+  // an ICM20948 whose magnetometer doesn't answer
+  {
+    ICM20X_Sim sim(ICM20948_CHIP_ID);
+    sim.setMagConnected(false);
+    sim.attachSPI(SPI_CS);
+    Adafruit_ICM20948 icm;
+    CHECK(!icm.begin_SPI(SPI_CS));
+  }
+  // two chips can't share an address
+  {
+    ICM20X_Sim first, second;
+    CHECK(first.attachI2C(0x69));
+    CHECK(!second.attachI2C(0x69));
+    first.detach();
+    CHECK(second.attachI2C(0x69));
+  }
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,88 @@
+// getBusStats() with ICM20X_BUS_STATS defined, against the simulated traffic,
+// by kind of transaction and by calling function
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+#include <string.h>
+
+// the entry for a driver function, or NULL if it made no transactions
+static const icm20x_bus_site_stats_t *findSite(const icm20x_bus_stats_t *stats,
+                                               const char *site) {
+  for (uint8_t i = 0; i < ICM20X_BUS_STATS_SITES && stats->site[i].site; i++) {
+    if (!strcmp(stats->site[i].site, site)) {
+      return &stats->site[i];
+    }
+  }
+  return NULL;
+}
+
+int main(void) {
+  ICM20X_Sim sim;
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+
+  icm20x_bus_stats_t stats;
+  CHECK(icm.getBusStats(&stats));
+
+  icm.resetBusStats();
+  sim.resetStats();
+  sensors_event_t a, g, t, m;
+  CHECK(icm.getEvent(&a, &g, &t, &m));
+  CHECK(icm.getBusStats(&stats));
+
+  // one burst of accel, gyro, temp and the 9 magnetometer bytes
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_DATA].transactions, 1);
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_DATA].bytes, 23);
+  CHECK(stats.op[ICM20X_BUS_OP_DATA].min_us > 0);
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_AUX].transactions, 0);
+
+  icm20x_sim_stats_t sim_stats;
+  sim.getStats(&sim_stats);
+  uint32_t counted = 0;
+  for (uint8_t i = 0; i < ICM20X_BUS_OP_COUNT; i++) {
+    counted += stats.op[i].transactions;
+  }
+  CHECK_EQ(counted, sim_stats.transactions);
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_BANK].transactions, sim_stats.bank_selects);
+
+  // the time recorded is the time the simulated transfer took
+  CHECK(stats.op[ICM20X_BUS_OP_DATA].total_us >= 23 * 9 * 1000000UL / 400000);
+
+  // every transaction is also counted against the function that issued it,
+  // bank selects included
+  uint32_t by_site = 0;
+  for (uint8_t i = 0; i < ICM20X_BUS_STATS_SITES && stats.site[i].site; i++) {
+    by_site += stats.site[i].transactions;
+  }
+  CHECK_EQ(by_site + stats.untracked, sim_stats.transactions);
+  const icm20x_bus_site_stats_t *burst = findSite(&stats, "_readRaw");
+  CHECK(burst != NULL);
+  if (burst) {
+    CHECK_EQ(burst->bytes, 23);
+  }
+
+  // the FIFO count is one site: a bank select, then one read per call
+  icm.setAccelRange(ICM20948_ACCEL_RANGE_4_G);
+  icm.resetBusStats();
+  icm.getFIFOCount();
+  icm.getFIFOCount();
+  CHECK(icm.getBusStats(&stats));
+  const icm20x_bus_site_stats_t *count = findSite(&stats, "getFIFOCount");
+  CHECK(count != NULL);
+  if (count) {
+    CHECK_EQ(count->transactions, 3);
+    CHECK_EQ(count->bytes, 1 + 2 + 2);
+  }
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_BANK].transactions, 1);
+  CHECK(stats.site[1].site == NULL);
+
+  icm.resetBusStats();
+  CHECK(icm.getBusStats(&stats));
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_DATA].transactions, 0);
+  CHECK_EQ(stats.op[ICM20X_BUS_OP_DATA].min_us, 0xFFFFFFFF);
+  CHECK(stats.site[0].site == NULL);
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+// DMP firmware load, output setup and decoding of the packets it writes to
+// the FIFO. The simulated DMP doesn't run, so the test writes its packets
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+
+// small enough to end before the settings the library writes into DMP memory
+static uint8_t firmware[20];
+
+static uint32_t dmpValue(ICM20X_Sim *sim, uint16_t address) {
+  const uint8_t *memory = sim->getDMPMemory();
+  return (uint32_t)memory[address] << 24 | (uint32_t)memory[address + 1] << 16 |
+         memory[address + 2] << 8 | memory[address + 3];
+}
+
+static uint16_t dmpValue16(ICM20X_Sim *sim, uint16_t address) {
+  const uint8_t *memory = sim->getDMPMemory();
+  return memory[address] << 8 | memory[address + 1];
+}
+
+// a Quat6 packet: header, three Q30 components and the footer
+static uint8_t quat6Packet(uint8_t *packet, int32_t x, int32_t y, int32_t z) {
+  const int32_t values[3] = {x, y, z};
+  packet[0] = ICM20948_DMP_HEADER_QUAT6 >> 8;
+  packet[1] = 0;
+  for (uint8_t c = 0; c < 3; c++) {
+    for (uint8_t b = 0; b < 4; b++) {
+      packet[2 + 4 * c + b] = (uint32_t)values[c] >> (24 - 8 * b);
+    }
+  }
+  packet[14] = 0;
+  packet[15] = 1;
+  return 16;
+}
+
+int main(void) {
+  for (uint16_t i = 0; i < sizeof(firmware); i++) {
+    firmware[i] = i * 7 + 3;
+  }
+
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+
+  CHECK(icm.beginDMP(firmware, sizeof(firmware)));
+  CHECK(memcmp(sim.getDMPMemory() + ICM20948_DMP_LOAD_START, firmware,
+               sizeof(firmware)) == 0);
+  CHECK_EQ(sim.getRegister(2, ICM20948_B2_PRGM_START_ADDRH) << 8 |
+               sim.getRegister(2, ICM20948_B2_PRGM_START_ADDRH + 1),
+           ICM20948_DMP_START_ADDRESS);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_USER_CTRL) & 0xC0, 0xC0);
+  CHECK(dmpValue(&sim, ICM20948_DMP_GYRO_SF) != 0);
+  CHECK(dmpValue(&sim, ICM20948_DMP_ACC_SCALE) != 0);
+
+  // the DMP writes its packets to the FIFO, so raw samples can't use it
+  icm20x_raw_sample_t storage[4];
+  Adafruit_ICM20X_SampleRing ring(storage, 4);
+  CHECK(!icm.enableFIFO(true));
+  CHECK(!icm.enableFIFO(false));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_USER_CTRL) & 0xC0, 0xC0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_FIFO_EN_2), 0);
+  CHECK_EQ(icm.readFIFO(&ring), 0);
+
+  // a firmware image that doesn't fit is refused
+  Adafruit_ICM20948 other;
+  ICM20X_Sim sim2(ICM20948_CHIP_ID);
+  sim2.attachI2C(0x68);
+  CHECK(other.begin_I2C(0x68));
+  CHECK(!other.beginDMP(firmware, 0));
+
+  uint32_t resets = sim.getDMPResetCount();
+  CHECK(icm.enableDMPOutput(ICM20948_DMP_QUAT6, true, 1));
+  CHECK_EQ(dmpValue16(&sim, ICM20948_DMP_DATA_OUT_CTL1),
+           ICM20948_DMP_HEADER_QUAT6);
+  CHECK_EQ(dmpValue16(&sim, ICM20948_DMP_ODR_QUAT6), 1);
+  CHECK(sim.getDMPResetCount() > resets);
+
+  // three packets and half of a fourth: the half stays for the next read
+  uint8_t packet[16];
+  const int32_t half = ICM20948_DMP_QUAT_ONE / 2;
+  for (uint8_t i = 0; i < 3; i++) {
+    quat6Packet(packet, i == 0 ? half : 0, 0, i == 1 ? half : 0);
+    CHECK(sim.pushFIFO(packet, sizeof(packet)));
+  }
+  quat6Packet(packet, 0, half, 0);
+  CHECK(sim.pushFIFO(packet, 9));
+
+  icm20948_quaternion_t quats[8];
+  CHECK_EQ(icm.readDMPQuaternions(quats, 2), 2);
+  CHECK_EQ(quats[0].output, ICM20948_DMP_QUAT6);
+  CHECK_NEAR((double)quats[0].x / ICM20948_DMP_QUAT_ONE, 0.5, 1e-6);
+  CHECK_NEAR((double)quats[0].w / ICM20948_DMP_QUAT_ONE, sqrt(0.75), 1e-4);
+  CHECK_NEAR((double)quats[1].z / ICM20948_DMP_QUAT_ONE, 0.5, 1e-6);
+  CHECK_EQ(icm.readDMPQuaternions(quats, 8), 1);
+  CHECK_EQ(icm.readDMPQuaternions(quats, 8), 0);
+  CHECK(sim.pushFIFO(packet + 9, sizeof(packet) - 9));
+  CHECK_EQ(icm.readDMPQuaternions(quats, 8), 1);
+  CHECK_NEAR((double)quats[0].y / ICM20948_DMP_QUAT_ONE, 0.5, 1e-6);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+
+  // an unknown header means the stream is lost: the FIFO starts over
+  const uint8_t garbage[4] = {0x00, 0x07, 1, 2};
+  CHECK(sim.pushFIFO(garbage, sizeof(garbage)));
+  CHECK_EQ(icm.readDMPQuaternions(quats, 8), 0);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+
+  // Quat9 also routes the magnetometer to the DMP through slave 0 and 1
+  CHECK(icm.enableDMPOutput(ICM20948_DMP_QUAT9, true));
+  CHECK_EQ(dmpValue16(&sim, ICM20948_DMP_DATA_OUT_CTL1),
+           ICM20948_DMP_HEADER_QUAT6 | ICM20948_DMP_HEADER_QUAT9);
+  CHECK(sim.getRegister(3, ICM20X_B3_I2C_SLV1_ADDR) != 0);
+  CHECK(icm.enableDMPOutput(ICM20948_DMP_QUAT9, false));
+  CHECK_EQ(dmpValue16(&sim, ICM20948_DMP_DATA_OUT_CTL1),
+           ICM20948_DMP_HEADER_QUAT6);
+
+  // begin resets the chip, which stops the DMP and frees the FIFO, on
+  // either bus
+  sim.detach();
+  sim.attachSPI(10);
+  CHECK(icm.begin_SPI(10));
+  CHECK(icm.enableFIFO(true));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_FIFO_EN_2), 0x1F);
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+// FIFO frames, with and without the magnetometer, overflow and timestamps
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+
+// accel X counts the samples so frames can be told apart
+static void countingSample(uint32_t index, icm20x_sim_sample_t *sample) {
+  const icm20x_sim_sample_t still = {
+      {0, 0, 2048}, {1, 2, 3}, 100, {300, 200, (int16_t)(100 + index / 10)}};
+  *sample = still;
+  sample->accel[0] = index;
+}
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+
+  // samples come only when the test asks, so counts are exact
+  sim.setFreeRunning(false);
+  sim.setGenerator(countingSample);
+
+  icm20x_raw_sample_t storage[64];
+  Adafruit_ICM20X_SampleRing ring(storage, 64);
+  icm20x_raw_sample_t sample;
+
+  CHECK(icm.enableFIFO(true));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_FIFO_EN_2), 0x1F);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+  uint32_t first = sim.getSampleCount() + 1;
+  sim.sample(5);
+  CHECK_EQ(sim.getFIFOCount(), 5 * ICM20X_FIFO_FRAME_SIZE);
+  CHECK_EQ(icm.getFIFOCount(), 5 * ICM20X_FIFO_FRAME_SIZE);
+  CHECK_EQ(icm.readFIFO(&ring), 5);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+  for (uint8_t i = 0; i < 5; i++) {
+    CHECK(ring.pop(&sample));
+    CHECK_EQ(sample.accel[0], first + i);
+    CHECK_EQ(sample.accel[2], 2048);
+    CHECK_EQ(sample.gyro[2], 3);
+    CHECK_EQ(sample.temperature, 100);
+  }
+  CHECK(!ring.pop(&sample));
+
+  // a partial frame stays in the FIFO for the next read
+  sim.sample(2);
+  uint8_t half[ICM20X_FIFO_FRAME_SIZE / 2] = {0};
+  CHECK(sim.pushFIFO(half, sizeof(half)));
+  CHECK_EQ(icm.readFIFO(&ring, 1), 1);
+  CHECK_EQ(icm.readFIFO(&ring), 1);
+  CHECK_EQ(sim.getFIFOCount(), sizeof(half));
+  icm.resetFIFO();
+  CHECK_EQ(sim.getFIFOCount(), 0);
+  ring.clear();
+
+  // frames are timestamped back from the read, one sample period apart
+  icm.setGyroRateDivisor(10);
+  icm.setAccelRateDivisor(10);
+  uint32_t period_ns = icm.getSamplePeriodNanos();
+  // the accelerometer's 102.3Hz is the faster of the two
+  CHECK_EQ(period_ns, 1000000000ULL * 11 / 1125);
+  sim.sample(4);
+  CHECK_EQ(icm.readFIFO(&ring), 4);
+  uint32_t read_us = micros();
+  icm20x_raw_sample_t frames[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    ring.pop(&frames[i]);
+  }
+  CHECK(frames[3].timestamp_us <= read_us);
+  for (uint8_t i = 1; i < 4; i++) {
+    CHECK_NEAR(frames[i].timestamp_us - frames[i - 1].timestamp_us,
+               period_ns / 1000.0, 1);
+  }
+
+  // a small factory clock error stretches the period
+  sim.setTimebaseCorrection(0x85); // -5 steps
+  ICM20X_Sim other(ICM20948_CHIP_ID);
+  other.setTimebaseCorrection(0x85);
+  other.attachI2C(0x68);
+  Adafruit_ICM20948 slow;
+  CHECK(slow.begin_I2C(0x68));
+  CHECK_EQ(slow.getTimebaseCorrection(), -5);
+  slow.setGyroRateDivisor(10);
+  slow.setAccelRateDivisor(10);
+  CHECK(slow.getSamplePeriodNanos() > period_ns);
+
+  // overflow: stream mode keeps the newest bytes, so frames no longer line
+  // up; the library counts it and starts over
+  uint16_t frames_fit = ICM20X_SIM_FIFO_SIZE / ICM20X_FIFO_FRAME_SIZE;
+  sim.sample(frames_fit + 3);
+  CHECK_EQ(sim.getFIFOCount(), ICM20X_SIM_FIFO_SIZE);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_INT_STATUS_2) & 0x01, 0x01);
+  CHECK_EQ(icm.readFIFO(&ring), 0);
+  CHECK_EQ(icm.getFIFOOverflowCount(), 1);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+  sim.sample(2);
+  CHECK_EQ(icm.readFIFO(&ring), 2);
+  ring.clear();
+
+  // with the magnetometer each frame carries the 9 slave 0 bytes
+  CHECK(icm.enableFIFO(true, true));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_FIFO_EN_1), 0x01);
+  delay(10);
+  sim.sample(3);
+  CHECK_EQ(sim.getFIFOCount(), 3 * ICM20X_FIFO_MAG_FRAME_SIZE);
+  CHECK_EQ(icm.readFIFO(&ring), 3);
+  CHECK(ring.pop(&sample));
+  CHECK_EQ(sample.mag[0], 300);
+  CHECK_EQ(sample.mag[1], 200);
+  CHECK(sample.flags & ICM20X_SAMPLE_MAG_NEW);
+  CHECK(ring.pop(&sample));
+  CHECK(!(sample.flags & ICM20X_SAMPLE_MAG_NEW)); // no new measurement yet
+  CHECK_EQ(sample.mag[0], 300);
+
+  CHECK(icm.enableFIFO(false));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_USER_CTRL) & 0x40, 0);
+  sim.sample(2);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+
+  return ICM20X_TEST_RESULT();
+}
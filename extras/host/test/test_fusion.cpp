@@ -0,0 +1,89 @@
+// Orientation from samples read off the simulated chip through the FIFO
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+#include <Adafruit_ICM20X_Fusion.h>
+
+#define DEG(rad) ((rad) * 180 / M_PI)
+
+static int16_t gyro_z = 0;
+
+// rolled 30 degrees (1g reads 2048 at the 16g range), the field 45 degrees
+// off north
+static void tiltedSample(uint32_t index, icm20x_sim_sample_t *sample) {
+  (void)index;
+  const icm20x_sim_sample_t tilted = {
+      {0, 1024, 1774}, {0, 0, 0}, 0, {100, -100, 0}};
+  *sample = tilted;
+  sample->gyro[2] = gyro_z;
+}
+
+// take samples into the FIFO, read them and run them through the filter
+static uint32_t run(Adafruit_ICM20948 *icm, ICM20X_Sim *sim,
+                    Adafruit_ICM20X_Fusion *fusion, uint16_t samples) {
+  icm20x_raw_sample_t storage[32], sample;
+  Adafruit_ICM20X_SampleRing ring(storage, 32);
+  uint32_t last_us = 0;
+  while (samples) {
+    uint16_t n = samples < 16 ? samples : 16;
+    delay(n * 10); // the time the samples take at 100Hz
+    sim->sample(n);
+    samples -= n;
+    icm->readFIFO(&ring);
+    while (ring.pop(&sample)) {
+      fusion->update(&sample);
+      last_us = sample.timestamp_us;
+    }
+  }
+  return last_us;
+}
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  sim.setGenerator(tiltedSample);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+  sim.setFreeRunning(false);
+  icm.setGyroDataRate(100);
+  icm.setAccelDataRate(100);
+  CHECK(icm.enableFIFO(true, true));
+
+  icm20x_fixed_scale_t scale;
+  icm.getFixedScale(&scale);
+
+#ifdef ICM20X_FUSION_FIXED
+  const icm20x_fusion_algorithm_t algorithms[] = {ICM20X_FUSION_MAHONY};
+#else
+  const icm20x_fusion_algorithm_t algorithms[] = {ICM20X_FUSION_MAHONY,
+                                                  ICM20X_FUSION_MADGWICK};
+#endif
+  for (uint8_t i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); i++) {
+    Adafruit_ICM20X_Fusion fusion(algorithms[i]);
+    fusion.setScale(&scale);
+    float roll, pitch, yaw;
+
+    // settles on the tilt and heading
+    gyro_z = 0;
+    uint32_t start_us = run(&icm, &sim, &fusion, 2000);
+    CHECK(fusion.getUpdateCount() > 1900);
+    fusion.getEuler(&roll, &pitch, &yaw);
+    CHECK_NEAR(DEG(roll), 30, 2);
+    CHECK_NEAR(DEG(pitch), 0, 2);
+
+    // turning at 90 degrees/s about the chip's Z axis for a short while;
+    // rolled 30 degrees, the heading moves cos(30) as fast
+    float start = DEG(yaw);
+    gyro_z = 90 * 16.4;
+    uint32_t end_us = run(&icm, &sim, &fusion, 20);
+    fusion.getEuler(&roll, &pitch, &yaw);
+    float turned = DEG(yaw) - start;
+    if (turned < -180) {
+      turned += 360;
+    }
+    CHECK_NEAR(turned, 90 * 0.8660254 * (end_us - start_us) / 1e6, 2);
+  }
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,126 @@
+// Interrupt routing, status decoding, servicing into a sample ring, and the
+// ring itself
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+
+// accel X is the sample number, so the order of samples can be checked
+static void countingSample(uint32_t index, icm20x_sim_sample_t *sample) {
+  const icm20x_sim_sample_t still = {
+      {0, 0, 2048}, {0, 0, 0}, 0, {100, 100, 100}};
+  *sample = still;
+  sample->accel[0] = (int16_t)index;
+}
+
+int main(void) {
+  // the ring keeps one slot free and wraps around its storage
+  {
+    icm20x_raw_sample_t storage[4], sample = {};
+    Adafruit_ICM20X_SampleRing ring(storage, 4);
+    CHECK_EQ(ring.available(), 0);
+    CHECK_EQ(ring.space(), 3);
+    CHECK(!ring.pop(&sample));
+    for (int16_t i = 0; i < 10; i++) {
+      sample.accel[0] = i;
+      CHECK(ring.push(&sample));
+      sample.accel[0] = i + 1;
+      CHECK(ring.push(&sample));
+      CHECK_EQ(ring.available(), 2);
+      CHECK(ring.pop(&sample));
+      CHECK_EQ(sample.accel[0], i);
+      CHECK(ring.pop(&sample));
+      CHECK_EQ(sample.accel[0], i + 1);
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+      CHECK(ring.push(&sample));
+    }
+    CHECK(!ring.push(&sample));
+    CHECK_EQ(ring.space(), 0);
+    ring.clear();
+    CHECK_EQ(ring.available(), 0);
+  }
+
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+  sim.setFreeRunning(false);
+  sim.setGenerator(countingSample);
+
+  // each source is routed to INT1 through its own enable register
+  CHECK(icm.enableInterrupts(ICM20X_INT_DATA_READY));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1) & 0x01, 0x01);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_2), 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_3), 0);
+  CHECK(icm.enableInterrupts(ICM20X_INT_FIFO_OVERFLOW));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1) & 0x01, 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_2), 0x1F);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_3), 0);
+  CHECK(icm.enableInterrupts(ICM20X_INT_FIFO_WATERMARK));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1) & 0x01, 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_2), 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_3), 0x1F);
+  CHECK(icm.enableInterrupts(ICM20X_INT_DATA_READY | ICM20X_INT_FIFO_OVERFLOW |
+                             ICM20X_INT_FIFO_WATERMARK));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1) & 0x01, 0x01);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_2), 0x1F);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_3), 0x1F);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE) & 0x08, 0);
+
+  // the INT2 pin settings share INT_ENABLE_1 and are left alone
+  icm.setInt2ActiveLow(true);
+  CHECK(icm.enableInterrupts(0));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1), 0xC0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_2), 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_3), 0);
+
+  // the status registers are decoded and cleared by reading them
+  sim.sample();
+  CHECK_EQ(icm.getInterruptStatus(), ICM20X_INT_DATA_READY);
+  CHECK_EQ(icm.getInterruptStatus(), 0);
+  sim.setRegister(0, ICM20X_B0_INT_STATUS_3, 0x01);
+  CHECK_EQ(icm.getInterruptStatus(), ICM20X_INT_FIFO_WATERMARK);
+  CHECK_EQ(icm.getInterruptStatus(), 0);
+
+  // without the FIFO each edge fetches the latest sample, and edges that
+  // arrive before servicing are fetched once
+  icm20x_raw_sample_t storage[4], sample;
+  Adafruit_ICM20X_SampleRing ring(storage, 4);
+  CHECK(icm.enableInterrupts(ICM20X_INT_DATA_READY));
+  CHECK_EQ(icm.serviceInterrupts(&ring), 0);
+  sim.sample();
+  icm.handleInterrupt();
+  sim.sample();
+  icm.handleInterrupt();
+  CHECK(icm.interruptPending());
+  CHECK_EQ(icm.serviceInterrupts(&ring), 1);
+  CHECK(!icm.interruptPending());
+  CHECK(ring.pop(&sample));
+  CHECK_EQ(sample.accel[0], (int16_t)sim.getSampleCount());
+  CHECK(!ring.pop(&sample));
+
+  // with the FIFO each edge drains every queued frame, oldest first, and
+  // what does not fit in the ring waits for the next edge
+  CHECK(icm.enableFIFO(true));
+  CHECK(icm.enableInterrupts(ICM20X_INT_FIFO_WATERMARK));
+  uint32_t first = sim.getSampleCount() + 1;
+  sim.sample(5);
+  icm.handleInterrupt();
+  CHECK_EQ(icm.serviceInterrupts(&ring), 3);
+  for (uint32_t i = 0; i < 3; i++) {
+    CHECK(ring.pop(&sample));
+    CHECK_EQ(sample.accel[0], (int16_t)(first + i));
+  }
+  CHECK_EQ(sim.getFIFOCount(), 2 * ICM20X_FIFO_FRAME_SIZE);
+  CHECK_EQ(icm.serviceInterrupts(&ring), 0);
+  icm.handleInterrupt();
+  CHECK_EQ(icm.serviceInterrupts(&ring), 2);
+  for (uint32_t i = 3; i < 5; i++) {
+    CHECK(ring.pop(&sample));
+    CHECK_EQ(sample.accel[0], (int16_t)(first + i));
+  }
+  CHECK_EQ(sim.getFIFOCount(), 0);
+
+  return ICM20X_TEST_RESULT();
+}
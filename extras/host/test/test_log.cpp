@@ -0,0 +1,182 @@
+// Record samples from the simulated chip and replay them through the
+// driver API
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+#include <Adafruit_ICM20X_Log.h>
+#include <string.h>
+
+#define FRAMES 6
+
+// a slowly turning chip, with a different value on every channel
+static void turningSample(uint32_t index, icm20x_sim_sample_t *sample) {
+  for (uint8_t i = 0; i < 3; i++) {
+    sample->accel[i] = 100 * i + index;
+    sample->gyro[i] = -50 * i - index;
+    sample->mag[i] = 300 + 10 * i + index;
+  }
+  sample->temperature = 1000 + index;
+}
+
+// a stream that takes at most `limit` bytes per write, and may say so
+class ShortSink : public Print {
+public:
+  uint8_t data[400];
+  uint32_t len = 0;
+  size_t limit = sizeof(data);
+  bool report_room = false;
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) {
+    if (size > limit) {
+      size = limit;
+    }
+    memcpy(data + len, buffer, size);
+    len += size;
+    return size;
+  }
+  int availableForWrite(void) { return report_room ? limit : 0; }
+};
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  sim.setGenerator(turningSample);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+
+  uint8_t log[400];
+  Adafruit_ICM20X_Recorder recorder(log, sizeof(log));
+  CHECK(recorder.begin(&icm));
+  CHECK_EQ(recorder.getByteCount(), ICM20X_LOG_HEADER_SIZE);
+
+  sensors_event_t a, g, t, m;
+  sensors_event_t live[FRAMES][4];
+  for (uint8_t i = 0; i < FRAMES; i++) {
+    if (i == 3) {
+      icm.setAccelRange(ICM20948_ACCEL_RANGE_2_G);
+    }
+    delay(7);
+    CHECK(icm.getEvent(&live[i][0], &live[i][1], &live[i][2], &live[i][3]));
+    CHECK(recorder.record());
+  }
+  CHECK_EQ(recorder.getFrameCount(), FRAMES);
+  CHECK_EQ(recorder.getDroppedCount(), 0);
+
+  // the replay gives back exactly what the chip gave, at the recorded ranges
+  Adafruit_ICM20X_Replay replay;
+  CHECK(replay.begin(log, recorder.getByteCount()));
+  for (uint8_t i = 0; i < FRAMES; i++) {
+    CHECK(replay.getEvent(&a, &g, &t, &m));
+    CHECK(a.acceleration.x == live[i][0].acceleration.x);
+    CHECK(a.acceleration.z == live[i][0].acceleration.z);
+    CHECK(g.gyro.y == live[i][1].gyro.y);
+    CHECK(t.temperature == live[i][2].temperature);
+    CHECK(m.magnetic.z == live[i][3].magnetic.z);
+    // milliseconds from the recorded microseconds, so they may round apart
+    CHECK_NEAR(a.timestamp, live[i][0].timestamp, 1);
+  }
+  CHECK(replay.atEnd());
+  CHECK_EQ(replay.getFrameCount(), FRAMES);
+  replay.rewind();
+  replay.getAccelerometerSensor()->getEvent(&a);
+  CHECK(a.acceleration.y == live[0][0].acceleration.y);
+
+  // a cut off log replays the frames that are whole
+  Adafruit_ICM20X_Replay cut;
+  CHECK(cut.begin(log, recorder.getByteCount() - 1));
+  icm20x_raw_sample_t raw;
+  uint8_t whole = 0;
+  while (cut.readRaw(&raw)) {
+    whole++;
+  }
+  CHECK_EQ(whole, FRAMES - 1);
+  log[4] = ICM20X_LOG_VERSION + 1;
+  CHECK(!cut.begin(log, recorder.getByteCount()));
+  log[4] = ICM20X_LOG_VERSION;
+
+  // a full buffer drops frames and counts them
+  uint8_t small[30];
+  Adafruit_ICM20X_Recorder full(small, sizeof(small));
+  CHECK(full.begin(&icm));
+  full.setSensors(ICM20X_SENSOR_ACCEL);
+  for (uint8_t i = 0; i < 5; i++) {
+    icm.readRaw(&raw);
+    full.record(&raw);
+  }
+  CHECK(full.getDroppedCount() > 0);
+  CHECK_EQ(full.getFrameCount() + full.getDroppedCount(), 5);
+  CHECK(full.getByteCount() <= sizeof(small));
+
+  // FIFO samples go through a ring
+  icm20x_raw_sample_t storage[8];
+  Adafruit_ICM20X_SampleRing ring(storage, 8);
+  CHECK(icm.enableFIFO(true));
+  sim.setFreeRunning(false);
+  sim.sample(3);
+  CHECK_EQ(icm.readFIFO(&ring), 3);
+  uint8_t fifo_log[200];
+  Adafruit_ICM20X_Recorder fifo_recorder(fifo_log, sizeof(fifo_log));
+  CHECK(fifo_recorder.begin(&icm));
+  fifo_recorder.setSensors(ICM20X_SENSOR_ACCEL | ICM20X_SENSOR_GYRO |
+                           ICM20X_SENSOR_TEMP);
+  CHECK_EQ(fifo_recorder.record(&ring), 3);
+  CHECK_EQ(ring.available(), 0);
+
+  // a stream that says it has no room for a frame drops it whole
+  ShortSink sink;
+  sink.limit = 10;
+  sink.report_room = true;
+  Adafruit_ICM20X_Recorder streamed(&sink);
+  CHECK(streamed.begin(&icm));
+  icm.readRaw(&raw);
+  CHECK(!streamed.record(&raw));
+  CHECK_EQ(streamed.getDroppedCount(), 1);
+  CHECK_EQ(sink.len, ICM20X_LOG_HEADER_SIZE);
+
+  // one that takes part of a frame anyway gets the rest before the next
+  // frame, or the next frame is dropped, so the frames stay whole
+  sink.report_room = false;
+  icm20x_raw_sample_t recorded[8];
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    icm.readRaw(&raw);
+    if (streamed.record(&raw)) {
+      recorded[kept++] = raw;
+    }
+  }
+  CHECK(streamed.getDroppedCount() > 1);
+  sink.limit = sizeof(sink.data);
+  CHECK(streamed.flush());
+  CHECK_EQ(kept, streamed.getFrameCount());
+  CHECK_EQ(sink.len, streamed.getByteCount());
+  Adafruit_ICM20X_Replay replay_sink;
+  CHECK(replay_sink.begin(sink.data, sink.len));
+  for (uint8_t i = 0; i < kept; i++) {
+    CHECK(replay_sink.readRaw(&raw));
+    CHECK_EQ(raw.accel[0], recorded[i].accel[0]);
+    CHECK_EQ(raw.mag[2], recorded[i].mag[2]);
+  }
+  CHECK(replay_sink.atEnd());
+
+  // an ICM20649 log carries its chip ID and replays at its scale
+  ICM20X_Sim sim2(ICM20649_CHIP_ID);
+  sim2.attachI2C(ICM20649_I2CADDR_DEFAULT);
+  Adafruit_ICM20649 icm2;
+  CHECK(icm2.begin_I2C());
+  uint8_t log2[100];
+  Adafruit_ICM20X_Recorder recorder2(log2, sizeof(log2));
+  CHECK(recorder2.begin(&icm2));
+  CHECK(icm2.getEvent(&a, &g, &t));
+  CHECK(recorder2.record());
+  Adafruit_ICM20X_Replay replay2;
+  sensors_event_t a2, g2, t2;
+  CHECK(replay2.begin(log2, recorder2.getByteCount()));
+  CHECK(replay2.getEvent(&a2, &g2, &t2));
+  CHECK(a.acceleration.z == a2.acceleration.z);
+  CHECK(g.gyro.z == g2.gyro.z);
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,141 @@
+// Sensor power, sleep, low power, wake on motion and interrupt handling
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+
+static bool moving = false;
+
+// still at 1g, or a sudden 0.5g on X at the 16g range
+static void motionSample(uint32_t index, icm20x_sim_sample_t *sample) {
+  (void)index;
+  const icm20x_sim_sample_t still = {
+      {0, 0, 2048}, {0, 0, 0}, 0, {100, 100, 100}};
+  *sample = still;
+  if (moving) {
+    sample->accel[0] = 1024;
+  }
+}
+
+static uint8_t interrupts_seen = 0;
+static void onInterrupt(void) { interrupts_seen++; }
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+  delay(20);
+
+  icm20x_sim_stats_t before, after;
+  sensors_event_t a, g, t, m;
+
+  CHECK_EQ(icm.getPoweredSensors(), ICM20X_SENSOR_ALL);
+  CHECK(!icm.isSleeping());
+  CHECK(!icm.isLowPowerEnabled());
+
+  // powered down sensors stop sampling and leave the burst
+  CHECK(icm.setPoweredSensors(ICM20X_SENSOR_ACCEL));
+  CHECK_EQ(icm.getPoweredSensors(), ICM20X_SENSOR_ACCEL);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_PWR_MGMT_2), 0x07);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_PWR_MGMT_1) & 0x08, 0x08);
+  CHECK_EQ(sim.getRegister(3, ICM20X_B3_I2C_SLV0_CTRL) & 0x80, 0);
+  CHECK_EQ(sim.getMag()->getMode(), AK09916_MAG_DATARATE_SHUTDOWN);
+  icm.getEvent(&a, &g, &t, &m);
+  sim.getStats(&before);
+  icm.getEvent(&a, &g, &t, &m);
+  sim.getStats(&after);
+  CHECK_EQ(after.bytes - before.bytes, 3 + 6);
+
+  // and come back where they were
+  CHECK(icm.setPoweredSensors(ICM20X_SENSOR_ALL));
+  CHECK_EQ(icm.getPoweredSensors(), ICM20X_SENSOR_ALL);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_PWR_MGMT_2), 0);
+  CHECK_EQ(sim.getMag()->getMode(), AK09916_MAG_DATARATE_100_HZ);
+  icm.getEvent(&a, &g, &t, &m);
+  sim.getStats(&before);
+  icm.getEvent(&a, &g, &t, &m);
+  sim.getStats(&after);
+  CHECK_EQ(after.bytes - before.bytes, 3 + 14 + 9);
+
+  // asleep, nothing is sampled
+  CHECK(icm.setSleep(true));
+  CHECK(icm.isSleeping());
+  uint32_t samples = sim.getSampleCount();
+  delay(100);
+  icm.getEvent(&a, &g, &t);
+  CHECK_EQ(sim.getSampleCount(), samples);
+  CHECK(icm.setSleep(false));
+  delay(100);
+  icm.getEvent(&a, &g, &t);
+  CHECK(sim.getSampleCount() > samples);
+
+  CHECK(icm.enableLowPower(true));
+  CHECK(icm.isLowPowerEnabled());
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_LP_CONFIG) & 0x30, 0x30);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_PWR_MGMT_1) & 0x20, 0x20);
+  CHECK(icm.enableLowPower(false));
+
+  // wake on motion
+  sim.setFreeRunning(false);
+  sim.setGenerator(motionSample);
+  CHECK(icm.enableWakeOnMotion(true, 200));
+  CHECK_EQ(sim.getRegister(2, ICM20X_B2_ACCEL_WOM_THR), 200 / 4);
+  CHECK_EQ(sim.getRegister(2, ICM20X_B2_ACCEL_INTEL_CTRL) & 0x03, 0x03);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE) & 0x08, 0x08);
+  sim.sample(3);
+  CHECK(!(icm.getInterruptStatus() & ICM20X_INT_WAKE_ON_MOTION));
+  moving = true;
+  sim.sample();
+  CHECK(icm.getInterruptStatus() & ICM20X_INT_WAKE_ON_MOTION);
+  // each sample is compared with the one before, so holding still is quiet
+  sim.sample();
+  CHECK(!(icm.getInterruptStatus() & ICM20X_INT_WAKE_ON_MOTION));
+  CHECK(icm.enableWakeOnMotion(false));
+  CHECK_EQ(sim.getRegister(2, ICM20X_B2_ACCEL_INTEL_CTRL) & 0x03, 0);
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE) & 0x08, 0);
+
+  // wake on motion needs the accelerometer
+  icm.setPoweredSensors(ICM20X_SENSOR_GYRO);
+  CHECK(!icm.enableWakeOnMotion(true));
+  icm.setPoweredSensors(ICM20X_SENSOR_ALL);
+
+  // data ready: the ISR only notes the edge, servicing reads the sample
+  icm20x_raw_sample_t storage[8], sample;
+  Adafruit_ICM20X_SampleRing ring(storage, 8);
+  CHECK(icm.enableInterrupts(ICM20X_INT_DATA_READY));
+  CHECK_EQ(sim.getRegister(0, ICM20X_B0_REG_INT_ENABLE_1) & 0x01, 0x01);
+  icm.setInterruptCallback(onInterrupt);
+  CHECK(!icm.interruptPending());
+  sim.sample();
+  icm.handleInterrupt();
+  uint32_t edge_us = micros();
+  CHECK_EQ(interrupts_seen, 1);
+  CHECK(icm.interruptPending());
+  delay(1);
+  CHECK_EQ(icm.serviceInterrupts(&ring), 1);
+  CHECK(!icm.interruptPending());
+  CHECK_EQ(icm.serviceInterrupts(&ring), 0);
+  CHECK(ring.pop(&sample));
+  CHECK_EQ(sample.accel[0], 1024);
+  CHECK_EQ(sample.timestamp_us, edge_us);
+
+  // an overflow reported through the status resets the FIFO
+  CHECK(icm.enableFIFO(true));
+  sim.sample(ICM20X_SIM_FIFO_SIZE / ICM20X_FIFO_FRAME_SIZE + 1);
+  CHECK(icm.getInterruptStatus() & ICM20X_INT_FIFO_OVERFLOW);
+  CHECK_EQ(icm.getFIFOOverflowCount(), 1);
+  CHECK_EQ(sim.getFIFOCount(), 0);
+
+  // the ICM20649 has no magnetometer to power
+  ICM20X_Sim sim2(ICM20649_CHIP_ID);
+  sim2.attachI2C(ICM20649_I2CADDR_DEFAULT);
+  Adafruit_ICM20649 icm2;
+  CHECK(icm2.begin_I2C());
+  CHECK_EQ(icm2.getPoweredSensors(),
+           ICM20X_SENSOR_ACCEL | ICM20X_SENSOR_GYRO | ICM20X_SENSOR_TEMP);
+  CHECK(icm2.setPoweredSensors(ICM20X_SENSOR_ALL));
+
+  return ICM20X_TEST_RESULT();
+}
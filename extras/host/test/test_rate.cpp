@@ -0,0 +1,62 @@
+// Output data rates, divisors and the sample period, checked against the
+// rate the simulated chip actually samples at
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+
+  CHECK_NEAR(icm.getGyroDataRate(), 100, 0.1);
+  CHECK_NEAR(icm.getAccelDataRate(), 1125 / 21.0, 0.1);
+
+  // the nearest divisor for each rate, clamped to what the divisors reach
+  const float targets[] = {2000, 1100, 500, 225, 100, 10, 4, 0.1};
+  for (uint8_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+    float gyro = icm.setGyroDataRate(targets[i]);
+    float accel = icm.setAccelDataRate(targets[i]);
+    CHECK_NEAR(gyro, 1100.0 / (1 + icm.getGyroRateDivisor()), 0.01);
+    CHECK_NEAR(accel, 1125.0 / (1 + icm.getAccelRateDivisor()), 0.01);
+    if (targets[i] <= 1100 && targets[i] >= 1100 / 256.0) {
+      CHECK_NEAR(gyro / targets[i], 1, 0.15);
+    }
+    if (targets[i] <= 1125 && targets[i] >= 1125 / 4096.0) {
+      CHECK_NEAR(accel / targets[i], 1, 0.15);
+    }
+  }
+  CHECK_EQ(icm.getGyroRateDivisor(), 255);
+  CHECK_EQ(icm.getAccelRateDivisor(), 4095);
+
+  // the chip samples at the faster of the two rates: 102.3Hz for the
+  // accelerometer's nearest divisor
+  icm.setGyroDataRate(100);
+  icm.setAccelDataRate(100);
+  sensors_event_t a, g, t;
+  icm.getEvent(&a, &g, &t);
+  uint32_t samples = sim.getSampleCount();
+  uint32_t start_us = micros();
+  delay(1000);
+  icm.getEvent(&a, &g, &t);
+  uint32_t period_us = icm.getSamplePeriodNanos() / 1000;
+  CHECK_NEAR(sim.getSampleCount() - samples,
+             (micros() - start_us) / (double)period_us, 1);
+
+  // with the gyro filter bypassed it runs at 9kHz
+  CHECK(icm.enableGyrolDLPF(false, ICM20X_GYRO_FREQ_196_6_HZ));
+  CHECK_NEAR(icm.getGyroDataRate(), 9000, 1);
+  CHECK(icm.getSamplePeriodNanos() < 112000);
+  samples = sim.getSampleCount();
+  start_us = micros();
+  delay(100);
+  icm.getEvent(&a, &g, &t);
+  // within the time of a transfer or two at either end
+  CHECK_NEAR((sim.getSampleCount() - samples) * 1e6 / 9000 /
+                 (micros() - start_us),
+             1, 0.05);
+
+  return ICM20X_TEST_RESULT();
+}
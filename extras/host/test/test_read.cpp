@@ -0,0 +1,143 @@
+// Bus traffic of each read path, the register shadow and the shared snapshot
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20649.h>
+#include <Adafruit_ICM20948.h>
+
+static ICM20X_Sim *sim;
+static icm20x_sim_stats_t before;
+
+static void mark(void) { sim->getStats(&before); }
+
+// I2C bytes since `mark`: each register transfer adds 3 address bytes
+static uint32_t bytesUsed(void) {
+  icm20x_sim_stats_t after;
+  sim->getStats(&after);
+  return after.bytes - before.bytes;
+}
+
+static uint32_t transactions(void) {
+  icm20x_sim_stats_t after;
+  sim->getStats(&after);
+  return after.transactions - before.transactions;
+}
+
+int main(void) {
+  ICM20X_Sim icm20948(ICM20948_CHIP_ID);
+  icm20948.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  sim = &icm20948;
+  Adafruit_ICM20948 icm;
+  CHECK(icm.begin_I2C());
+  delay(20);
+
+  sensors_event_t a, g, t, m;
+  // a burst covers only the sensors asked for
+  icm.getEvent(&a, &g, &t, &m);
+  mark();
+  icm.getEvent(&a, &g, &t, &m);
+  CHECK_EQ(transactions(), 1);
+  CHECK_EQ(bytesUsed(), 3 + 14 + 9);
+  mark();
+  icm.getEvent(&a, &g, &t);
+  CHECK_EQ(bytesUsed(), 3 + 14);
+  mark();
+  icm.getEvent(&a, NULL, NULL);
+  CHECK_EQ(bytesUsed(), 3 + 6);
+  mark();
+  icm.getEvent(NULL, &g, NULL);
+  CHECK_EQ(bytesUsed(), 3 + 6);
+  mark();
+  icm.getEvent(NULL, NULL, &t);
+  CHECK_EQ(bytesUsed(), 3 + 2);
+  mark();
+  icm.getEvent(NULL, NULL, NULL, &m);
+  CHECK_EQ(bytesUsed(), 3 + 9);
+  mark();
+  icm.getAccelerometerSensor()->getEvent(&a);
+  CHECK_EQ(bytesUsed(), 3 + 6);
+  mark();
+  icm.getMagnetometerSensor()->getEvent(&m);
+  CHECK_EQ(bytesUsed(), 3 + 9);
+  CHECK_NEAR(m.magnetic.x, 150, 1e-3);
+
+  // configuration comes from the shadow, unchanged values aren't written
+  mark();
+  icm.setAccelRange(ICM20948_ACCEL_RANGE_4_G);
+  CHECK_EQ((icm20948.getRegister(2, ICM20X_B2_ACCEL_CONFIG_1) >> 1) & 0x03, 1);
+  CHECK(transactions() > 0);
+  mark();
+  icm.setAccelRange(ICM20948_ACCEL_RANGE_4_G);
+  CHECK_EQ(icm.getAccelRange(), ICM20948_ACCEL_RANGE_4_G);
+  CHECK_EQ(transactions(), 0);
+
+  icm.getEvent(&a, &g, &t);
+  CHECK_NEAR(a.acceleration.z, 2048 / 8192.0 * SENSORS_GRAVITY_EARTH, 1e-4);
+
+  // batched configuration, written in one go
+  icm.beginConfig();
+  icm.setAccelRateDivisor(300);
+  icm.setGyroRateDivisor(7);
+  icm.setGyroRange(ICM20948_GYRO_RANGE_500_DPS);
+  mark();
+  CHECK(icm.commitConfig());
+  CHECK_EQ(icm20948.getRegister(2, ICM20X_B2_ACCEL_SMPLRT_DIV_1), 300 >> 8);
+  CHECK_EQ(icm20948.getRegister(2, ICM20X_B2_ACCEL_SMPLRT_DIV_2), 300 & 0xFF);
+  CHECK_EQ(icm20948.getRegister(2, ICM20X_B2_GYRO_SMPLRT_DIV), 7);
+  CHECK_EQ((icm20948.getRegister(2, ICM20X_B2_GYRO_CONFIG_1) >> 1) & 0x03, 1);
+  CHECK_EQ(icm.getAccelRateDivisor(), 300);
+  CHECK_EQ(icm.getGyroRateDivisor(), 7);
+
+  // accel offsets are split over two registers, 15 bits shifted by one
+  icm.setAccelOffset(0x1234, 0x5678, -2);
+  CHECK_EQ(icm.getAccelXOffset(), 0x1234);
+  CHECK_EQ(icm.getAccelYOffset(), 0x5678);
+  CHECK_EQ(icm.getAccelZOffset(), -2);
+
+  // sub-objects share one reading while it is fresh
+  icm.setSnapshotMaxAge(ICM20X_SNAPSHOT_DATA_PERIOD);
+  delay(20);
+  uint32_t generation = icm.getSnapshotGeneration();
+  mark();
+  icm.getAccelerometerSensor()->getEvent(&a);
+  icm.getGyroSensor()->getEvent(&g);
+  icm.getMagnetometerSensor()->getEvent(&m);
+  icm.getTemperatureSensor()->getEvent(&t);
+  CHECK_EQ(icm.getSnapshotGeneration(), generation + 1);
+  CHECK_EQ(icm20948.getBank(), 0);
+  delay(20);
+  icm.getAccelerometerSensor()->getEvent(&a);
+  CHECK_EQ(icm.getSnapshotGeneration(), generation + 2);
+  icm.setSnapshotMaxAge(0);
+
+  // the raw sample and its fixed point scale agree with the float events
+  icm20x_raw_sample_t raw;
+  icm20x_fixed_scale_t scale;
+  CHECK(icm.readRaw(&raw));
+  icm.getFixedScale(&scale);
+  CHECK_EQ(raw.accel[2], 2048);
+  CHECK_EQ(raw.mag[0], 1000);
+  icm.getEvent(&a, &g, &t, &m);
+  CHECK_NEAR(icm20x_raw_to_q16(raw.accel[2], scale.accel) / 65536.0,
+             a.acceleration.z, 1e-3);
+  CHECK_NEAR(icm20x_raw_to_q16(raw.gyro[2], scale.gyro) / 65536.0, g.gyro.z,
+             1e-4);
+  CHECK_NEAR(icm20x_raw_to_q16(raw.mag[0], scale.mag) / 65536.0,
+             m.magnetic.x, 1e-2);
+
+  // the ICM20649 has no magnetometer to read
+  ICM20X_Sim icm20649(ICM20649_CHIP_ID);
+  icm20649.attachI2C(ICM20649_I2CADDR_DEFAULT);
+  sim = &icm20649;
+  Adafruit_ICM20649 icm2;
+  CHECK(icm2.begin_I2C());
+  mark();
+  icm2.getEvent(&a, &g, &t);
+  CHECK_EQ(bytesUsed(), 3 + 14);
+  CHECK_NEAR(a.acceleration.z, 2048 / 1024.0 * SENSORS_GRAVITY_EARTH, 1e-3);
+  mark();
+  icm2.getMagnetometerSensor()->getEvent(&m);
+  CHECK_EQ(transactions(), 0);
+
+  return ICM20X_TEST_RESULT();
+}
@@ -0,0 +1,61 @@
+// begin() with warm start skips the reset of a chip that is already running
+// and only writes the settings that differ from a fresh begin()
+
+#include "ICM20X_Sim.h"
+#include "ICM20X_Test.h"
+#include <Adafruit_ICM20948.h>
+
+int main(void) {
+  ICM20X_Sim sim(ICM20948_CHIP_ID);
+  sim.attachI2C(ICM20948_I2CADDR_DEFAULT);
+  icm20x_sim_stats_t before, after;
+
+  uint32_t cold_us, cold_transactions;
+  {
+    Adafruit_ICM20948 icm;
+    sim.getStats(&before);
+    CHECK(icm.begin_I2C());
+    sim.getStats(&after);
+    CHECK(!icm.wasWarmStart());
+    cold_us = icm.getStartupMicros();
+    cold_transactions = after.transactions - before.transactions;
+    CHECK(icm.enableFIFO(true));
+    icm.setAccelRange(ICM20948_ACCEL_RANGE_2_G);
+  }
+
+  // a second begin, i.e. after the MCU resets: the chip ends up as a cold
+  // begin leaves it, with less traffic
+  {
+    Adafruit_ICM20948 icm;
+    icm.setWarmStart(true);
+    sim.getStats(&before);
+    CHECK(icm.begin_I2C());
+    sim.getStats(&after);
+    CHECK(icm.wasWarmStart());
+    CHECK(icm.getStartupMicros() < cold_us);
+    CHECK(after.transactions - before.transactions < cold_transactions);
+    CHECK_EQ(icm.getAccelRange(), ICM20948_ACCEL_RANGE_16_G);
+    CHECK_EQ((sim.getRegister(2, ICM20X_B2_ACCEL_CONFIG_1) >> 1) & 0x03, 3);
+    CHECK_EQ(sim.getRegister(0, ICM20X_B0_USER_CTRL) & 0x40, 0);
+    CHECK_EQ(sim.getRegister(0, ICM20X_B0_FIFO_EN_2), 0);
+    CHECK_EQ(sim.getMag()->getMode(), AK09916_MAG_DATARATE_100_HZ);
+
+    delay(20);
+    sensors_event_t a, g, t, m;
+    CHECK(icm.getEvent(&a, &g, &t, &m));
+    CHECK_NEAR(a.acceleration.z, 2048 / 2048.0 * SENSORS_GRAVITY_EARTH, 1e-3);
+    CHECK_NEAR(m.magnetic.x, 150, 1e-3);
+  }
+
+  // a chip that lost power is set up from scratch
+  sim.powerOn();
+  {
+    Adafruit_ICM20948 icm;
+    icm.setWarmStart(true);
+    CHECK(icm.begin_I2C());
+    CHECK(!icm.wasWarmStart());
+    CHECK_EQ(icm.getAccelRange(), ICM20948_ACCEL_RANGE_16_G);
+  }
+
+  return ICM20X_TEST_RESULT();
+}